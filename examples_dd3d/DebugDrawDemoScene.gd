@@ -312,6 +312,7 @@ func main_update(delta: float) -> void:
 
 func _text_tests():
 	DebugDraw2D.set_text("FPS", "%.2f" % Engine.get_frames_per_second(), 0, Color.GOLD)
+	DebugDraw2D.create_graph("FPS").add_sample(Engine.get_frames_per_second())
 	
 	if text_groups_show_examples:
 		if timer_text < 0:
@@ -323,7 +324,7 @@ func _text_tests():
 		DebugDraw2D.set_text("Text", "Value", 0, Color.AQUAMARINE)
 		DebugDraw2D.set_text("Text out of order", null, -1, Color.SILVER)
 		DebugDraw2D.begin_text_group("-- Second Group --", 1, Color.BEIGE)
-		DebugDraw2D.set_text("Rendered frames", Engine.get_frames_drawn())
+		DebugDraw2D.set_text_int("Rendered frames", Engine.get_frames_drawn())
 		DebugDraw2D.end_text_group()
 	
 	if text_groups_show_stats or text_groups_show_stats_2d:
@@ -350,6 +351,7 @@ func _text_tests():
 			
 			DebugDraw2D.set_text("Total Label3D", render_stats.nodes_label3d_exists_total, 33)
 			DebugDraw2D.set_text("Visible Label3D", render_stats.nodes_label3d_visible + render_stats.nodes_label3d_visible_physics, 34)
+			DebugDraw2D.set_text("Visible glyph text", render_stats.glyph_text_visible + render_stats.glyph_text_visible_physics, 35)
 			
 			DebugDraw2D.set_text("-----", null, 48)
 			
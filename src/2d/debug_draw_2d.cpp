@@ -2,6 +2,7 @@
 
 #include "config_2d.h"
 #include "debug_draw_manager.h"
+#include "graph_2d.h"
 #include "grouped_text.h"
 #include "stats_2d.h"
 #include "utils/utils.h"
@@ -35,8 +36,17 @@ void DebugDraw2D::_bind_methods() {
 	ClassDB::bind_method(D_METHOD(NAMEOF(begin_text_group), "group_title", "group_priority", "group_color", "show_title", "title_size", "text_size"), &DebugDraw2D::begin_text_group, 0, Colors::white_smoke, true, -1, -1);
 	ClassDB::bind_method(D_METHOD(NAMEOF(end_text_group)), &DebugDraw2D::end_text_group);
 	ClassDB::bind_method(D_METHOD(NAMEOF(set_text), "key", "value", "priority", "color_of_value", "duration"), &DebugDraw2D::set_text, Variant(), 0, Colors::empty_color, -1.0);
+	ClassDB::bind_method(D_METHOD(NAMEOF(set_text_int), "key", "value", "priority", "color_of_value", "duration"), &DebugDraw2D::set_text_int, 0, Colors::empty_color, -1.0);
+	ClassDB::bind_method(D_METHOD(NAMEOF(set_text_float), "key", "value", "priority", "color_of_value", "duration"), &DebugDraw2D::set_text_float, 0, Colors::empty_color, -1.0);
+	ClassDB::bind_method(D_METHOD(NAMEOF(set_text_vector3), "key", "value", "priority", "color_of_value", "duration"), &DebugDraw2D::set_text_vector3, 0, Colors::empty_color, -1.0);
 	ClassDB::bind_method(D_METHOD(NAMEOF(clear_texts)), &DebugDraw2D::clear_texts);
 
+	ClassDB::bind_method(D_METHOD(NAMEOF(create_graph), "title"), &DebugDraw2D::create_graph);
+	ClassDB::bind_method(D_METHOD(NAMEOF(get_graph), "title"), &DebugDraw2D::get_graph);
+	ClassDB::bind_method(D_METHOD(NAMEOF(get_graph_names)), &DebugDraw2D::get_graph_names);
+	ClassDB::bind_method(D_METHOD(NAMEOF(remove_graph), "title"), &DebugDraw2D::remove_graph);
+	ClassDB::bind_method(D_METHOD(NAMEOF(clear_graphs)), &DebugDraw2D::clear_graphs);
+
 #pragma endregion // Draw Functions
 
 	ClassDB::bind_method(D_METHOD(NAMEOF(get_render_stats)), &DebugDraw2D::get_render_stats);
@@ -58,6 +68,7 @@ void DebugDraw2D::init(DebugDrawManager *root) {
 #ifndef DISABLE_DEBUG_RENDERING
 	grouped_text = std::make_unique<GroupedText>();
 	grouped_text->init_text_groups(this);
+	graphs = std::make_unique<GraphsContainer>(this);
 #endif
 }
 
@@ -67,6 +78,7 @@ DebugDraw2D::~DebugDraw2D() {
 
 #ifndef DISABLE_DEBUG_RENDERING
 	grouped_text.reset();
+	graphs.reset();
 
 	Control *default_control = Object::cast_to<Control>(ObjectDB::get_instance(default_control_id));
 	Control *custom_control = Object::cast_to<Control>(ObjectDB::get_instance(custom_control_id));
@@ -116,6 +128,10 @@ void DebugDraw2D::process_end(double delta) {
 	// Clean texts
 	grouped_text->cleanup_text(delta);
 
+	// Add new samples and record the changed graphs
+	graphs->set_visible(_is_enabled_override());
+	graphs->update();
+
 	// Update overlay
 	_finish_frame_and_update();
 #endif
@@ -138,6 +154,10 @@ void DebugDraw2D::physics_process_end(double delta) {
 #ifndef DISABLE_DEBUG_RENDERING
 void DebugDraw2D::_finish_frame_and_update() {
 	ZoneScoped;
+	// A group begun in this frame must not receive the texts of the next one, even if nothing changed
+	if (grouped_text)
+		grouped_text->end_text_group();
+
 	if (_canvas_need_update) {
 		if (Control *custom_canvas = Object::cast_to<Control>(ObjectDB::get_instance(custom_control_id)); custom_canvas) {
 			custom_canvas->queue_redraw();
@@ -154,8 +174,6 @@ void DebugDraw2D::_finish_frame_and_update() {
 
 		// reset some values
 		_canvas_need_update = false;
-		if (grouped_text)
-			grouped_text->end_text_group();
 	} else {
 #ifdef TRACY_ENABLE
 		if (DebugDraw2D_frame_mark_2d_started) {
@@ -170,6 +188,11 @@ void DebugDraw2D::_clear_all_internal() {
 	ZoneScoped;
 	if (grouped_text)
 		grouped_text->clear_groups();
+	// The graphs are kept because scripts can still use them
+	if (graphs) {
+		graphs->clear_samples();
+		graphs->set_visible(_is_enabled_override());
+	}
 
 	mark_canvas_dirty();
 	_finish_frame_and_update();
@@ -206,6 +229,15 @@ void DebugDraw2D::_set_custom_canvas_internal(Control *_canvas) {
 
 		Utils::connect_safe(_canvas, "draw", call_canvas_item_draw_cache, 0, nullptr, create_custom);
 	}
+
+	// The text is kept in separate canvas items, so it must be moved to the new canvas
+	if (grouped_text) {
+		grouped_text->detach_canvas_items();
+		mark_canvas_dirty();
+	}
+	if (graphs) {
+		graphs->detach_canvas_items();
+	}
 }
 #endif
 
@@ -216,6 +248,7 @@ void DebugDraw2D::_on_canvas_item_draw(Control *ci) {
 	Vector2 vp_size = ci->has_meta("UseParentSize") ? Object::cast_to<Control>(ci->get_parent())->get_rect().size : ci->get_rect().size;
 
 	grouped_text->draw(ci, _font, vp_size);
+	graphs->set_canvas(ci, config->get_text_custom_font().is_null() ? _font : config->get_text_custom_font(), vp_size);
 #endif
 
 #ifdef TRACY_ENABLE
@@ -364,12 +397,64 @@ void DebugDraw2D::set_text(String key, Variant value, int priority, Color color_
 	CALL_TO_2D(grouped_text, set_text, key, value, priority, color_of_value, duration);
 }
 
+void DebugDraw2D::set_text_int(String key, int64_t value, int priority, Color color_of_value, real_t duration) {
+	ZoneScoped;
+	CALL_TO_2D(grouped_text, set_text_int, key, value, priority, color_of_value, duration);
+}
+
+void DebugDraw2D::set_text_float(String key, double value, int priority, Color color_of_value, real_t duration) {
+	ZoneScoped;
+	CALL_TO_2D(grouped_text, set_text_float, key, value, priority, color_of_value, duration);
+}
+
+void DebugDraw2D::set_text_vector3(String key, Vector3 value, int priority, Color color_of_value, real_t duration) {
+	ZoneScoped;
+	CALL_TO_2D(grouped_text, set_text_vector3, key, value, priority, color_of_value, duration);
+}
+
 void DebugDraw2D::clear_texts() {
 	ZoneScoped;
 	FORCE_CALL_TO_2D(grouped_text, clear_groups);
 }
 
 #pragma endregion // Text
+
+#pragma region Graphs
+
+Ref<DebugDraw2DGraph> DebugDraw2D::create_graph(const StringName &title) {
+	ZoneScoped;
+#ifndef DISABLE_DEBUG_RENDERING
+	FORCE_CALL_TO_2D_RET(graphs, create_graph, Ref<DebugDraw2DGraph>(), title);
+#else
+	// Return a graph that is not drawn, so that scripts work the same way
+	Ref<DebugDraw2DGraph> graph;
+	graph.instantiate();
+	graph->_set_title(title);
+	return graph;
+#endif
+}
+
+Ref<DebugDraw2DGraph> DebugDraw2D::get_graph(const StringName &title) {
+	ZoneScoped;
+	FORCE_CALL_TO_2D_RET(graphs, get_graph, Ref<DebugDraw2DGraph>(), title);
+}
+
+PackedStringArray DebugDraw2D::get_graph_names() {
+	ZoneScoped;
+	FORCE_CALL_TO_2D_RET(graphs, get_graph_names, PackedStringArray());
+}
+
+void DebugDraw2D::remove_graph(const StringName &title) {
+	ZoneScoped;
+	FORCE_CALL_TO_2D(graphs, remove_graph, title);
+}
+
+void DebugDraw2D::clear_graphs() {
+	ZoneScoped;
+	FORCE_CALL_TO_2D(graphs, clear_graphs);
+}
+
+#pragma endregion // Graphs
 #pragma endregion // 2D
 
 #pragma endregion // Draw Functions
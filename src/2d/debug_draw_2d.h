@@ -13,7 +13,9 @@ using namespace godot;
 
 class DebugDrawManager;
 class DebugDraw2DConfig;
+class DebugDraw2DGraph;
 class DebugDraw2DStats;
+class GraphsContainer;
 class GroupedText;
 
 /**
@@ -43,6 +45,7 @@ private:
 
 #ifndef DISABLE_DEBUG_RENDERING
 	std::unique_ptr<GroupedText> grouped_text;
+	std::unique_ptr<GraphsContainer> graphs;
 #endif
 
 #ifndef DISABLE_DEBUG_RENDERING
@@ -167,11 +170,54 @@ public:
 	 * @param duration Expiration time
 	 */
 	void set_text(String key, Variant value = Variant(), int priority = 0, Color color_of_value = Colors::empty_color, real_t duration = -1);
+	/**
+	 * Same as DebugDraw2D.set_text, but for an integer value.
+	 *
+	 * The value is formatted without creating a Variant, and the overlay is not redrawn if the text has not changed.
+	 */
+	void set_text_int(String key, int64_t value, int priority = 0, Color color_of_value = Colors::empty_color, real_t duration = -1);
+	/**
+	 * Same as DebugDraw2D.set_text_int, but for a float value.
+	 */
+	void set_text_float(String key, double value, int priority = 0, Color color_of_value = Colors::empty_color, real_t duration = -1);
+	/**
+	 * Same as DebugDraw2D.set_text_int, but for a Vector3 value.
+	 */
+	void set_text_vector3(String key, Vector3 value, int priority = 0, Color color_of_value = Colors::empty_color, real_t duration = -1);
 
 	/**
 	 * Clear all text
 	 */
 	void clear_texts();
 #pragma endregion // Text
+
+#pragma region Graphs
+	/**
+	 * Create a new graph or get the existing graph with the same title.
+	 *
+	 * Samples are added with DebugDraw2DGraph.add_sample or read from DebugDraw3DStats every frame with DebugDraw2DGraph.set_stats_field.
+	 *
+	 * A new graph is placed below the graphs that already exist in the top right corner.
+	 *
+	 * @param title Graph title and ID
+	 */
+	Ref<DebugDraw2DGraph> create_graph(const StringName &title);
+	/**
+	 * Get the graph with the title or null.
+	 */
+	Ref<DebugDraw2DGraph> get_graph(const StringName &title);
+	/**
+	 * Get the titles of all graphs.
+	 */
+	PackedStringArray get_graph_names();
+	/**
+	 * Remove the graph with the title.
+	 */
+	void remove_graph(const StringName &title);
+	/**
+	 * Remove all graphs.
+	 */
+	void clear_graphs();
+#pragma endregion // Graphs
 #pragma endregion // Exposed Draw Functions
 };
@@ -0,0 +1,609 @@
+#include "graph_2d.h"
+#include "debug_draw_2d.h"
+#include "utils/utils.h"
+
+#ifndef DISABLE_DEBUG_RENDERING
+#include "3d/debug_draw_3d.h"
+#include "3d/stats_3d.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+GODOT_WARNING_DISABLE()
+#include <godot_cpp/classes/rendering_server.hpp>
+GODOT_WARNING_RESTORE()
+
+#define GRAPH_LOCK() LOCK_GUARD(datalock)
+#else
+#define GRAPH_LOCK()
+#endif
+
+void DebugDraw2DGraph::_bind_methods() {
+#define REG_CLASS_NAME DebugDraw2DGraph
+
+	ClassDB::bind_method(D_METHOD(NAMEOF(get_title)), &DebugDraw2DGraph::get_title);
+	ADD_PROPERTY(PropertyInfo(Variant::STRING_NAME, "title", PROPERTY_HINT_NONE, "", PROPERTY_USAGE_NONE), "", NAMEOF(get_title));
+
+	REG_PROP_BOOL(enabled);
+	REG_PROP_BOOL(show_title);
+	REG_PROP(buffer_size, Variant::INT);
+	REG_PROP(size, Variant::VECTOR2I);
+	REG_PROP(position, Variant::INT);
+	REG_PROP(offset, Variant::VECTOR2I);
+	REG_PROP(line_color, Variant::COLOR);
+	REG_PROP(line_width, Variant::FLOAT);
+	REG_PROP(background_color, Variant::COLOR);
+	REG_PROP(text_color, Variant::COLOR);
+	REG_PROP(text_size, Variant::INT);
+	REG_PROP(stats_field, Variant::STRING_NAME);
+
+	REG_METHOD(add_sample, "value");
+	REG_METHOD(clear_samples);
+	REG_METHOD(get_min);
+	REG_METHOD(get_max);
+	REG_METHOD(get_avg);
+	REG_METHOD(get_percentile, "percentile");
+
+#undef REG_CLASS_NAME
+}
+
+DebugDraw2DGraph::DebugDraw2DGraph() {
+#ifndef DISABLE_DEBUG_RENDERING
+	samples.resize(buffer_size);
+#endif
+}
+
+DebugDraw2DGraph::~DebugDraw2DGraph() {
+#ifndef DISABLE_DEBUG_RENDERING
+	_free_canvas_item();
+#endif
+}
+
+void DebugDraw2DGraph::_set_title(const StringName &p_title) {
+	GRAPH_LOCK();
+	title = p_title;
+#ifndef DISABLE_DEBUG_RENDERING
+	is_title_shaped = false;
+#endif
+	_mark_dirty();
+}
+
+void DebugDraw2DGraph::_mark_dirty() {
+#ifndef DISABLE_DEBUG_RENDERING
+	LOCK_GUARD(datalock);
+	is_dirty = true;
+#endif
+}
+
+#ifndef DISABLE_DEBUG_RENDERING
+void DebugDraw2DGraph::_record(const Ref<Font> &p_font) {
+	ZoneScoped;
+	LOCK_GUARD(datalock);
+	RenderingServer *rs = RenderingServer::get_singleton();
+
+	rs->canvas_item_clear(canvas_item);
+	rs->canvas_item_set_visible(canvas_item, enabled);
+	is_dirty = false;
+	if (!enabled)
+		return;
+
+	const Vector2 graph_size = size;
+	rs->canvas_item_add_rect(canvas_item, Rect2(Vector2(), graph_size), background_color);
+
+	const size_t count = samples.size();
+	const double min_val = samples.get_min();
+	const double max_val = samples.get_max();
+
+	// Polyline of all samples. The newest sample is on the right edge.
+	if (count > 1) {
+		const double range = max_val - min_val;
+		const real_t step_x = graph_size.x / (real_t)(Math::max(samples.window_size(), (size_t)2) - 1);
+		const real_t start_x = graph_size.x - step_x * (real_t)(count - 1);
+
+		points.resize((int64_t)count);
+		Vector2 *points_w = points.ptrw();
+		const CircularBuffer<double> &buf = samples.get_samples();
+		for (size_t i = 0; i < count; i++) {
+			const real_t t = range > 0 ? (real_t)((buf.get(i) - min_val) / range) : 0.5f;
+			points_w[i] = Vector2(start_x + step_x * (real_t)i, graph_size.y * (1 - t));
+		}
+		rs->canvas_item_add_polyline(canvas_item, points, PackedColorArray(Array::make(line_color)), line_width);
+	}
+
+	if (p_font.is_null())
+		return;
+
+	auto shape = [&p_font, this](Ref<TextLine> &r_line, const String &p_text) {
+		if (r_line.is_null()) {
+			r_line.instantiate();
+		}
+		r_line->clear();
+		r_line->add_string(p_text, p_font, text_size);
+	};
+
+	auto format = [](char *r_buf, size_t p_size, const double &p_value) {
+		snprintf(r_buf, p_size, "%.2f", p_value);
+		return r_buf;
+	};
+	char buf[64];
+
+	// Labels of the axes
+	if (count) {
+		if (!is_axes_shaped || shown_min != min_val || shown_max != max_val) {
+			shape(min_line, format(buf, sizeof(buf), min_val));
+			shape(max_line, format(buf, sizeof(buf), max_val));
+			shown_min = min_val;
+			shown_max = max_val;
+			is_axes_shaped = true;
+		}
+
+		max_line->draw(canvas_item, Vector2(graph_size.x - max_line->get_size().x - 2, 0).floor(), text_color);
+		min_line->draw(canvas_item, Vector2(graph_size.x - min_line->get_size().x - 2, graph_size.y - min_line->get_size().y).floor(), text_color);
+	}
+
+	if (show_title) {
+		// Shaped again only when the shown text changes, not with every sample
+		format(buf, sizeof(buf), count ? samples.get_samples().get(count - 1) : 0);
+		if (!is_title_shaped || strcmp(buf, shown_title_value) != 0) {
+			shape(title_line, String(title) + ": " + String(buf));
+			memcpy(shown_title_value, buf, sizeof(shown_title_value));
+			is_title_shaped = true;
+		}
+		title_line->draw(canvas_item, Vector2(2, 0), text_color);
+	}
+}
+
+void DebugDraw2DGraph::_update_transform(const Vector2 &p_vp_size) {
+	LOCK_GUARD(datalock);
+	if (!canvas_item.is_valid())
+		return;
+
+	const Vector2 graph_size = size;
+	const Vector2 graph_offset = offset;
+	Vector2 pos;
+	switch (position) {
+		case DebugDraw2DConfig::BlockPosition::POSITION_LEFT_TOP:
+			pos = graph_offset;
+			break;
+		case DebugDraw2DConfig::BlockPosition::POSITION_RIGHT_TOP:
+			pos = Vector2(p_vp_size.x - graph_offset.x - graph_size.x, graph_offset.y);
+			break;
+		case DebugDraw2DConfig::BlockPosition::POSITION_LEFT_BOTTOM:
+			pos = Vector2(graph_offset.x, p_vp_size.y - graph_offset.y - graph_size.y);
+			break;
+		case DebugDraw2DConfig::BlockPosition::POSITION_RIGHT_BOTTOM:
+			pos = p_vp_size - graph_offset - graph_size;
+			break;
+	}
+
+	RenderingServer::get_singleton()->canvas_item_set_transform(canvas_item, Transform2D(0, pos.floor()));
+}
+
+void DebugDraw2DGraph::_free_canvas_item() {
+	LOCK_GUARD(datalock);
+	if (canvas_item.is_valid()) {
+		RenderingServer::get_singleton()->free_rid(canvas_item);
+		canvas_item = RID();
+	}
+	is_dirty = true;
+}
+#endif
+
+StringName DebugDraw2DGraph::get_title() const {
+	GRAPH_LOCK();
+	return title;
+}
+
+void DebugDraw2DGraph::set_enabled(const bool &_state) {
+	GRAPH_LOCK();
+	if (enabled != _state)
+		_mark_dirty();
+	enabled = _state;
+}
+
+bool DebugDraw2DGraph::is_enabled() const {
+	GRAPH_LOCK();
+	return enabled;
+}
+
+void DebugDraw2DGraph::set_show_title(const bool &_state) {
+	GRAPH_LOCK();
+	if (show_title != _state)
+		_mark_dirty();
+	show_title = _state;
+}
+
+bool DebugDraw2DGraph::is_show_title() const {
+	GRAPH_LOCK();
+	return show_title;
+}
+
+void DebugDraw2DGraph::set_buffer_size(const int &_size) {
+	GRAPH_LOCK();
+	int new_size = Math::clamp(_size, 2, 65536);
+	if (buffer_size != new_size) {
+		buffer_size = new_size;
+#ifndef DISABLE_DEBUG_RENDERING
+		samples.resize(buffer_size);
+#endif
+		_mark_dirty();
+	}
+}
+
+int DebugDraw2DGraph::get_buffer_size() const {
+	GRAPH_LOCK();
+	return buffer_size;
+}
+
+void DebugDraw2DGraph::set_size(const Vector2i &_size) {
+	GRAPH_LOCK();
+	if (size != _size)
+		_mark_dirty();
+	size = _size;
+}
+
+Vector2i DebugDraw2DGraph::get_size() const {
+	GRAPH_LOCK();
+	return size;
+}
+
+void DebugDraw2DGraph::set_position(DebugDraw2DConfig::BlockPosition _position) {
+	GRAPH_LOCK();
+	if (position != _position)
+		_mark_dirty();
+	position = _position;
+}
+
+DebugDraw2DConfig::BlockPosition DebugDraw2DGraph::get_position() const {
+	GRAPH_LOCK();
+	return position;
+}
+
+void DebugDraw2DGraph::set_offset(const Vector2i &_offset) {
+	GRAPH_LOCK();
+	if (offset != _offset)
+		_mark_dirty();
+	offset = _offset;
+}
+
+Vector2i DebugDraw2DGraph::get_offset() const {
+	GRAPH_LOCK();
+	return offset;
+}
+
+void DebugDraw2DGraph::set_line_color(const Color &_new_color) {
+	GRAPH_LOCK();
+	if (line_color != _new_color)
+		_mark_dirty();
+	line_color = _new_color;
+}
+
+Color DebugDraw2DGraph::get_line_color() const {
+	GRAPH_LOCK();
+	return line_color;
+}
+
+void DebugDraw2DGraph::set_line_width(const real_t &_width) {
+	GRAPH_LOCK();
+	if (line_width != _width)
+		_mark_dirty();
+	line_width = _width;
+}
+
+real_t DebugDraw2DGraph::get_line_width() const {
+	GRAPH_LOCK();
+	return line_width;
+}
+
+void DebugDraw2DGraph::set_background_color(const Color &_new_color) {
+	GRAPH_LOCK();
+	if (background_color != _new_color)
+		_mark_dirty();
+	background_color = _new_color;
+}
+
+Color DebugDraw2DGraph::get_background_color() const {
+	GRAPH_LOCK();
+	return background_color;
+}
+
+void DebugDraw2DGraph::set_text_color(const Color &_new_color) {
+	GRAPH_LOCK();
+	if (text_color != _new_color)
+		_mark_dirty();
+	text_color = _new_color;
+}
+
+Color DebugDraw2DGraph::get_text_color() const {
+	GRAPH_LOCK();
+	return text_color;
+}
+
+void DebugDraw2DGraph::set_text_size(const int &_size) {
+	GRAPH_LOCK();
+	if (text_size != _size) {
+#ifndef DISABLE_DEBUG_RENDERING
+		is_axes_shaped = false;
+		is_title_shaped = false;
+#endif
+		_mark_dirty();
+	}
+	text_size = _size;
+}
+
+int DebugDraw2DGraph::get_text_size() const {
+	GRAPH_LOCK();
+	return text_size;
+}
+
+void DebugDraw2DGraph::set_stats_field(const StringName &_field) {
+	GRAPH_LOCK();
+	stats_field = _field;
+}
+
+StringName DebugDraw2DGraph::get_stats_field() const {
+	GRAPH_LOCK();
+	return stats_field;
+}
+
+void DebugDraw2DGraph::add_sample(const double &value) {
+#ifndef DISABLE_DEBUG_RENDERING
+	if (!std::isfinite(value)) {
+		PRINT_ERROR("Only finite samples can be added to the graph '{0}'.", title);
+		return;
+	}
+
+	LOCK_GUARD(datalock);
+	samples.add(value);
+	is_dirty = true;
+#endif
+}
+
+void DebugDraw2DGraph::clear_samples() {
+#ifndef DISABLE_DEBUG_RENDERING
+	LOCK_GUARD(datalock);
+	samples.reset();
+	is_dirty = true;
+#endif
+}
+
+double DebugDraw2DGraph::get_min() const {
+#ifndef DISABLE_DEBUG_RENDERING
+	LOCK_GUARD(datalock);
+	return samples.get_min();
+#else
+	return 0;
+#endif
+}
+
+double DebugDraw2DGraph::get_max() const {
+#ifndef DISABLE_DEBUG_RENDERING
+	LOCK_GUARD(datalock);
+	return samples.get_max();
+#else
+	return 0;
+#endif
+}
+
+double DebugDraw2DGraph::get_avg() const {
+#ifndef DISABLE_DEBUG_RENDERING
+	LOCK_GUARD(datalock);
+	return samples.get_avg();
+#else
+	return 0;
+#endif
+}
+
+double DebugDraw2DGraph::get_percentile(const double &percentile) const {
+#ifndef DISABLE_DEBUG_RENDERING
+	LOCK_GUARD(datalock);
+	return samples.get_percentile(percentile);
+#else
+	return 0;
+#endif
+}
+
+#ifndef DISABLE_DEBUG_RENDERING
+GraphsContainer::GraphsContainer(DebugDraw2D *p_owner) {
+	owner = p_owner;
+}
+
+GraphsContainer::~GraphsContainer() {
+	clear_graphs();
+}
+
+Ref<DebugDraw2DGraph> GraphsContainer::create_graph(const StringName &p_title) {
+	ZoneScoped;
+	LOCK_GUARD(datalock);
+
+	Ref<DebugDraw2DGraph> graph = get_graph(p_title);
+	if (graph.is_valid())
+		return graph;
+
+	graph.instantiate();
+	graph->_set_title(p_title);
+
+	// New graphs are stacked below the graphs that are in the same corner
+	int bottom = 0;
+	for (const auto &g : graphs) {
+		LOCK_GUARD(g->datalock);
+		if (g->position == graph->position && g->offset.x == graph->offset.x) {
+			bottom = Math::max(bottom, g->offset.y + g->size.y);
+		}
+	}
+	if (bottom) {
+		graph->offset.y = bottom + GRAPHS_SPACING;
+	}
+
+	graphs.push_back(graph);
+
+	// The canvas of the overlay is needed to show the graph
+	owner->mark_canvas_dirty();
+	return graph;
+}
+
+Ref<DebugDraw2DGraph> GraphsContainer::get_graph(const StringName &p_title) {
+	LOCK_GUARD(datalock);
+	for (const auto &g : graphs) {
+		if (g->get_title() == p_title)
+			return g;
+	}
+	return Ref<DebugDraw2DGraph>();
+}
+
+void GraphsContainer::remove_graph(const StringName &p_title) {
+	ZoneScoped;
+	LOCK_GUARD(datalock);
+	for (auto it = graphs.begin(); it != graphs.end(); it++) {
+		if ((*it)->get_title() == p_title) {
+			// The graph can still be referenced by scripts, so it must be hidden now
+			(*it)->_free_canvas_item();
+			graphs.erase(it);
+			return;
+		}
+	}
+}
+
+void GraphsContainer::clear_graphs() {
+	ZoneScoped;
+	LOCK_GUARD(datalock);
+	for (const auto &g : graphs) {
+		g->_free_canvas_item();
+	}
+	graphs.clear();
+}
+
+void GraphsContainer::clear_samples() {
+	ZoneScoped;
+	LOCK_GUARD(datalock);
+	for (const auto &g : graphs) {
+		g->clear_samples();
+	}
+}
+
+PackedStringArray GraphsContainer::get_graph_names() {
+	LOCK_GUARD(datalock);
+	PackedStringArray res;
+	for (const auto &g : graphs) {
+		res.push_back(g->get_title());
+	}
+	return res;
+}
+
+size_t GraphsContainer::get_graphs_count() {
+	LOCK_GUARD(datalock);
+	return graphs.size();
+}
+
+void GraphsContainer::update() {
+	ZoneScoped;
+	LOCK_GUARD(datalock);
+	if (graphs.empty() || !is_visible)
+		return;
+
+	Ref<DebugDraw3DStats> stats_3d;
+	for (const auto &g : graphs) {
+		const StringName field = g->get_stats_field();
+		if (field.is_empty())
+			continue;
+
+		if (stats_3d.is_null()) {
+			stats_3d = DebugDraw3D::get_singleton()->get_render_stats();
+			if (stats_3d.is_null())
+				break;
+		}
+
+		bool is_valid = false;
+		Variant value = stats_3d->get(field);
+		switch (value.get_type()) {
+			case Variant::INT:
+			case Variant::FLOAT:
+				is_valid = true;
+				break;
+			default:
+				break;
+		}
+
+		if (is_valid) {
+			g->add_sample(value);
+		} else {
+			PRINT_ERROR("The field '{0}' of DebugDraw3DStats cannot be used in the graph '{1}'.", field, g->get_title());
+			g->set_stats_field(StringName());
+		}
+	}
+
+	RenderingServer *rs = RenderingServer::get_singleton();
+	for (const auto &g : graphs) {
+		LOCK_GUARD(g->datalock);
+		if (!g->is_dirty)
+			continue;
+
+		if (!g->canvas_item.is_valid()) {
+			g->canvas_item = rs->canvas_item_create();
+			rs->canvas_item_set_parent(g->canvas_item, parent_canvas_item);
+		}
+
+		g->_record(font);
+		g->_update_transform(viewport_size);
+	}
+}
+
+void GraphsContainer::set_canvas(CanvasItem *p_ci, const Ref<Font> &p_font, const Vector2 &p_vp_size) {
+	ZoneScoped;
+	LOCK_GUARD(datalock);
+	RenderingServer *rs = RenderingServer::get_singleton();
+
+	const RID ci_rid = p_ci->get_canvas_item();
+	const bool is_parent_changed = parent_canvas_item != ci_rid;
+	const bool is_font_changed = font != p_font;
+	parent_canvas_item = ci_rid;
+	font = p_font;
+	viewport_size = p_vp_size;
+
+	for (const auto &g : graphs) {
+		LOCK_GUARD(g->datalock);
+		if (is_parent_changed && g->canvas_item.is_valid())
+			rs->canvas_item_set_parent(g->canvas_item, parent_canvas_item);
+
+		if (is_font_changed) {
+			g->is_axes_shaped = false;
+			g->is_title_shaped = false;
+			g->is_dirty = true;
+		}
+
+		if (is_visible)
+			g->_update_transform(viewport_size);
+	}
+}
+
+void GraphsContainer::detach_canvas_items() {
+	ZoneScoped;
+	LOCK_GUARD(datalock);
+	RenderingServer *rs = RenderingServer::get_singleton();
+
+	parent_canvas_item = RID();
+	for (const auto &g : graphs) {
+		LOCK_GUARD(g->datalock);
+		if (g->canvas_item.is_valid())
+			rs->canvas_item_set_parent(g->canvas_item, RID());
+	}
+}
+
+void GraphsContainer::set_visible(bool p_visible) {
+	LOCK_GUARD(datalock);
+	if (is_visible == p_visible)
+		return;
+
+	ZoneScoped;
+	is_visible = p_visible;
+	RenderingServer *rs = RenderingServer::get_singleton();
+	for (const auto &g : graphs) {
+		LOCK_GUARD(g->datalock);
+		// Recorded again with the actual state when shown
+		g->is_dirty = true;
+		if (!is_visible && g->canvas_item.is_valid())
+			rs->canvas_item_set_visible(g->canvas_item, false);
+	}
+}
+#endif
@@ -0,0 +1,236 @@
+#pragma once
+
+#include "common/colors.h"
+#include "config_2d.h"
+#include "utils/compiler.h"
+#include "utils/profiler.h"
+
+#ifndef DISABLE_DEBUG_RENDERING
+#include "common/rolling_stats.h"
+
+#include <mutex>
+#include <vector>
+#endif
+
+GODOT_WARNING_DISABLE()
+#include <godot_cpp/classes/canvas_item.hpp>
+#include <godot_cpp/classes/font.hpp>
+#include <godot_cpp/classes/ref_counted.hpp>
+#include <godot_cpp/classes/text_line.hpp>
+GODOT_WARNING_RESTORE()
+using namespace godot;
+
+/**
+ * @brief
+ * A graph of the last samples drawn on the DebugDraw2D overlay.
+ *
+ * Use DebugDraw2D.create_graph to create a graph, then add samples with add_sample
+ * or let the graph read a field of DebugDraw3DStats every frame with set_stats_field.
+ *
+ * The vertical axis always fits the minimum and maximum of the samples in the buffer.
+ */
+class DebugDraw2DGraph : public RefCounted {
+	GDCLASS(DebugDraw2DGraph, RefCounted)
+
+	friend class GraphsContainer;
+	friend class DebugDraw2D;
+
+private:
+	StringName title;
+	bool enabled = true;
+	bool show_title = true;
+	int buffer_size = 256;
+	Vector2i size = Vector2i(256, 64);
+	DebugDraw2DConfig::BlockPosition position = DebugDraw2DConfig::BlockPosition::POSITION_RIGHT_TOP;
+	Vector2i offset = Vector2i(8, 8);
+	Color line_color = Colors::orange;
+	real_t line_width = 1;
+	Color background_color = Colors::gray_bg;
+	Color text_color = Colors::white;
+	int text_size = 12;
+	StringName stats_field;
+
+#ifndef DISABLE_DEBUG_RENDERING
+	// Properties can be changed from any thread
+	mutable ProfiledMutex(std::recursive_mutex, datalock, "Graph lock");
+
+	RollingStats<double> samples;
+	bool is_dirty = true;
+
+	RID canvas_item;
+	PackedVector2Array points;
+	Ref<TextLine> title_line;
+	Ref<TextLine> min_line;
+	Ref<TextLine> max_line;
+	// Labels of the axes are shaped again only when these values change
+	double shown_min = 0;
+	double shown_max = 0;
+	bool is_axes_shaped = false;
+	// The title is shaped again only when the formatted last sample changes
+	char shown_title_value[64] = {};
+	bool is_title_shaped = false;
+
+	void _record(const Ref<Font> &p_font);
+	void _update_transform(const Vector2 &p_vp_size);
+	void _free_canvas_item();
+#endif
+
+	void _set_title(const StringName &p_title);
+	void _mark_dirty();
+
+protected:
+	/// @private
+	static void _bind_methods();
+
+public:
+	DebugDraw2DGraph();
+	~DebugDraw2DGraph();
+
+	/**
+	 * Name of the graph. It is set in DebugDraw2D.create_graph.
+	 */
+	StringName get_title() const;
+
+	/**
+	 * Set whether the graph is visible. Samples are still collected when it is hidden.
+	 */
+	void set_enabled(const bool &_state);
+	bool is_enabled() const;
+
+	/**
+	 * Set whether the title with the last sample is drawn.
+	 */
+	void set_show_title(const bool &_state);
+	bool is_show_title() const;
+
+	/**
+	 * Number of the last samples shown on the graph. Changing it removes all samples.
+	 */
+	void set_buffer_size(const int &_size);
+	int get_buffer_size() const;
+
+	/**
+	 * Size of the graph in pixels.
+	 */
+	void set_size(const Vector2i &_size);
+	Vector2i get_size() const;
+
+	/**
+	 * Corner of the overlay where the graph is placed.
+	 */
+	void set_position(DebugDraw2DConfig::BlockPosition _position);
+	DebugDraw2DConfig::BlockPosition get_position() const;
+
+	/**
+	 * Offset from the corner selected in 'set_position'.
+	 * New graphs are placed below the existing graphs in the default corner, so they do not overlap.
+	 * Graphs that are moved later must be given their own offsets.
+	 */
+	void set_offset(const Vector2i &_offset);
+	Vector2i get_offset() const;
+
+	/**
+	 * Color of the graph line.
+	 */
+	void set_line_color(const Color &_new_color);
+	Color get_line_color() const;
+
+	/**
+	 * Width of the graph line.
+	 */
+	void set_line_width(const real_t &_width);
+	real_t get_line_width() const;
+
+	/**
+	 * Background color of the graph.
+	 */
+	void set_background_color(const Color &_new_color);
+	Color get_background_color() const;
+
+	/**
+	 * Color of the title and the axis labels.
+	 */
+	void set_text_color(const Color &_new_color);
+	Color get_text_color() const;
+
+	/**
+	 * Font size of the title and the axis labels.
+	 */
+	void set_text_size(const int &_size);
+	int get_text_size() const;
+
+	/**
+	 * Name of the DebugDraw3DStats property that is added as a sample every frame, e.g. `total_visible`.
+	 * Set an empty name to add samples only with add_sample.
+	 */
+	void set_stats_field(const StringName &_field);
+	StringName get_stats_field() const;
+
+	/**
+	 * Add a new sample. The oldest sample is removed if the buffer is full.
+	 * Infinite and NaN values are rejected with an error.
+	 */
+	void add_sample(const double &value);
+	/**
+	 * Remove all samples.
+	 */
+	void clear_samples();
+
+	/**
+	 * Minimum of the samples in the buffer.
+	 */
+	double get_min() const;
+	/**
+	 * Maximum of the samples in the buffer.
+	 */
+	double get_max() const;
+	/**
+	 * Average of the samples in the buffer.
+	 */
+	double get_avg() const;
+	/**
+	 * Approximate percentile of the samples in the buffer, from 0 to 100.
+	 */
+	double get_percentile(const double &percentile) const;
+};
+
+#ifndef DISABLE_DEBUG_RENDERING
+/// @private
+class GraphsContainer {
+	/// Vertical space between the graphs stacked by `create_graph`.
+	static constexpr int GRAPHS_SPACING = 8;
+
+	class DebugDraw2D *owner = nullptr;
+	std::vector<Ref<DebugDraw2DGraph> > graphs;
+
+	RID parent_canvas_item;
+	Ref<Font> font;
+	Vector2 viewport_size;
+	// False when DebugDraw2D is disabled
+	bool is_visible = true;
+
+	ProfiledMutex(std::recursive_mutex, datalock, "Graphs lock");
+
+public:
+	GraphsContainer(class DebugDraw2D *p_owner);
+	~GraphsContainer();
+
+	Ref<DebugDraw2DGraph> create_graph(const StringName &p_title);
+	Ref<DebugDraw2DGraph> get_graph(const StringName &p_title);
+	void remove_graph(const StringName &p_title);
+	void clear_graphs();
+	/// Removes the samples of all graphs, but keeps the graphs.
+	void clear_samples();
+	PackedStringArray get_graph_names();
+	size_t get_graphs_count();
+
+	/// Adds the samples of the stats fields and records the changed graphs.
+	void update();
+	/// Attaches the graphs to the canvas of the overlay.
+	void set_canvas(CanvasItem *p_ci, const Ref<Font> &p_font, const Vector2 &p_vp_size);
+	/// Hides the graphs until the next `set_canvas`.
+	void detach_canvas_items();
+	/// Hidden graphs are not sampled and not recorded.
+	void set_visible(bool p_visible);
+};
+#endif
@@ -3,6 +3,13 @@
 #include "debug_draw_2d.h"
 #include "utils/utils.h"
 
+#include <cinttypes>
+#include <cstdio>
+
+GODOT_WARNING_DISABLE()
+#include <godot_cpp/classes/rendering_server.hpp>
+#include <godot_cpp/templates/hashfuncs.hpp>
+GODOT_WARNING_RESTORE()
 using namespace godot;
 
 #ifndef DISABLE_DEBUG_RENDERING
@@ -18,7 +25,12 @@ TextGroupItem::TextGroupItem(const double &p_expiration_time, const String &p_ke
 }
 
 bool TextGroupItem::update(const double &p_expiration_time, const String &p_key, const String &p_text, const int &p_priority, const Color &p_color) {
-	bool dirty = expiration_time != p_expiration_time || key != p_key || text != p_text || priority != p_priority || value_color != p_color;
+	// The expiration time is not drawn, so it does not make the canvas dirty
+	bool is_text_changed = key != p_key || text != p_text;
+	bool dirty = is_text_changed || priority != p_priority || value_color != p_color;
+
+	if (is_text_changed)
+		layout.is_valid = false;
 
 	expiration_time = p_expiration_time;
 	key = p_key;
@@ -34,9 +46,45 @@ bool TextGroupItem::is_expired() {
 	return expiration_time > 0 ? false : !second_chance;
 }
 
+const TextGroupItem::Layout &TextGroupItem::get_layout(const Ref<Font> &p_font, const int &p_font_size) {
+	if (layout.is_valid && layout.font == p_font && layout.font_size == p_font_size)
+		return layout;
+
+	ZoneScoped;
+	static const String separator = " : ";
+
+	layout.is_valid = true;
+	layout.font = p_font;
+	layout.font_size = p_font_size;
+	layout.is_title_only = text.is_empty();
+
+	if (layout.key_line.is_null()) {
+		layout.key_line.instantiate();
+	}
+	layout.key_line->clear();
+	layout.key_line->add_string(layout.is_title_only ? key : key + separator, p_font, p_font_size);
+	layout.size = layout.key_line->get_size();
+
+	if (layout.is_title_only) {
+		layout.value_line.unref();
+	} else {
+		if (layout.value_line.is_null()) {
+			layout.value_line.instantiate();
+		}
+		layout.value_line->clear();
+		layout.value_line->add_string(text, p_font, p_font_size);
+
+		Vector2 value_size = layout.value_line->get_size();
+		layout.size = Vector2(layout.size.x + value_size.x, Math::max(layout.size.y, value_size.y));
+	}
+	return layout;
+}
+
 void TextGroup::set_group_priority(int p_val) {
-	if (group_priority != p_val)
+	if (group_priority != p_val) {
 		owner->mark_canvas_dirty();
+		is_dirty = true;
+	}
 	group_priority = p_val;
 }
 
@@ -45,8 +93,10 @@ int TextGroup::get_group_priority() {
 }
 
 void TextGroup::set_show_title(bool p_val) {
-	if (show_title != p_val)
+	if (show_title != p_val) {
 		owner->mark_canvas_dirty();
+		is_dirty = true;
+	}
 	show_title = p_val;
 }
 
@@ -55,8 +105,10 @@ bool TextGroup::is_show_title() {
 }
 
 void TextGroup::set_group_color(Color p_val) {
-	if (group_color != p_val)
+	if (group_color != p_val) {
 		owner->mark_canvas_dirty();
+		is_dirty = true;
+	}
 	group_color = p_val;
 }
 
@@ -65,8 +117,10 @@ Color TextGroup::get_group_color() {
 }
 
 void TextGroup::set_title_size(int p_val) {
-	if (title_size != p_val)
+	if (title_size != p_val) {
 		owner->mark_canvas_dirty();
+		is_dirty = true;
+	}
 	title_size = p_val;
 }
 
@@ -75,8 +129,10 @@ int TextGroup::get_title_size() {
 }
 
 void TextGroup::set_text_size(int p_val) {
-	if (text_size != p_val)
+	if (text_size != p_val) {
 		owner->mark_canvas_dirty();
+		is_dirty = true;
+	}
 	text_size = p_val;
 }
 
@@ -89,6 +145,8 @@ TextGroup::TextGroup(DebugDraw2D *p_owner, const String &p_title, const int &p_p
 
 	owner = p_owner;
 	title = p_title;
+	title_item = std::make_shared<TextGroupItem>(0.0, p_title, "", 0, Colors::empty_color);
+	title_item->is_group_title = true;
 	group_priority = p_priority;
 	show_title = p_show_title;
 	group_color = p_group_color;
@@ -96,6 +154,12 @@ TextGroup::TextGroup(DebugDraw2D *p_owner, const String &p_title, const int &p_p
 	text_size = p_text_size;
 }
 
+TextGroup::~TextGroup() {
+	if (canvas_item.is_valid()) {
+		RenderingServer::get_singleton()->free_rid(canvas_item);
+	}
+}
+
 void TextGroup::cleanup_texts(const std::function<void()> &p_update, const double &p_delta) {
 	ZoneScoped;
 	size_t old_size = Texts.size();
@@ -112,8 +176,63 @@ void TextGroup::cleanup_texts(const std::function<void()> &p_update, const doubl
 						}),
 			Texts.end());
 
-	if (old_size != Texts.size() && p_update)
-		p_update();
+	if (old_size != Texts.size()) {
+		is_dirty = true;
+		_rebuild_key_index();
+		if (p_update)
+			p_update();
+	}
+}
+
+void TextGroup::_insert_key(TextGroupItem *p_item) {
+	const size_t mask = key_index.size() - 1;
+	size_t i = hash_fmix32(p_item->key_hash) & mask;
+	while (key_index[i].item) {
+		i = (i + 1) & mask;
+	}
+	key_index[i] = { p_item->key_hash, p_item };
+}
+
+void TextGroup::_rebuild_key_index() {
+	ZoneScoped;
+	// Keep the load factor below 0.5
+	size_t capacity = 16;
+	while (capacity < Texts.size() * 2) {
+		capacity *= 2;
+	}
+
+	key_index.assign(capacity, { 0, nullptr });
+	for (const auto &t : Texts) {
+		_insert_key(t.get());
+	}
+}
+
+TextGroupItem *TextGroup::find_text(const String &p_key, const uint32_t &p_key_hash) {
+	if (key_index.empty())
+		return nullptr;
+
+	const size_t mask = key_index.size() - 1;
+	size_t i = hash_fmix32(p_key_hash) & mask;
+	while (key_index[i].item) {
+		const KeyBucket &b = key_index[i];
+		if (b.hash == p_key_hash && b.item->key == p_key)
+			return b.item;
+		i = (i + 1) & mask;
+	}
+	return nullptr;
+}
+
+void TextGroup::add_text(const TextGroupItem_ptr &p_item, const uint32_t &p_key_hash) {
+	p_item->key_hash = p_key_hash;
+	Texts.push_back(p_item);
+	is_texts_order_dirty = true;
+	is_dirty = true;
+
+	if (Texts.size() * 2 > key_index.size()) {
+		_rebuild_key_index();
+	} else {
+		_insert_key(p_item.get());
+	}
 }
 
 void GroupedText::_create_new_default_group_if_needed() {
@@ -122,14 +241,19 @@ void GroupedText::_create_new_default_group_if_needed() {
 	if (!_current_text_group) {
 		_current_text_group = std::make_shared<TextGroup>(owner, "", 0, false, owner->get_config()->get_text_foreground_color(), 0, owner->get_config()->get_text_default_size());
 		_text_groups.push_back(_current_text_group);
+		is_groups_order_dirty = true;
 	}
 }
 
+void GroupedText::_set_group_priority(const TextGroup_ptr &p_group, const int &p_priority) {
+	if (p_group->get_group_priority() != p_priority)
+		is_groups_order_dirty = true;
+	p_group->set_group_priority(p_priority);
+}
+
 void GroupedText::init_text_groups(DebugDraw2D *p_owner) {
 	owner = p_owner;
 	_current_text_group = nullptr;
-	item_for_title_of_groups = std::make_shared<TextGroupItem>(0.0f, "", "", 0, Colors::empty_color);
-	item_for_title_of_groups->is_group_title = true;
 }
 
 void GroupedText::clear_groups() {
@@ -177,7 +301,7 @@ void GroupedText::begin_text_group(const String &p_group_title, const int &p_gro
 
 	if (newGroup) {
 		newGroup->set_show_title(p_show_title);
-		newGroup->set_group_priority(p_group_priority);
+		_set_group_priority(newGroup, p_group_priority);
 		newGroup->set_group_color(p_group_color);
 		newGroup->set_title_size(new_title_size);
 		newGroup->set_text_size(new_text_size);
@@ -185,6 +309,7 @@ void GroupedText::begin_text_group(const String &p_group_title, const int &p_gro
 	} else {
 		newGroup = std::make_shared<TextGroup>(owner, p_group_title, p_group_priority, p_show_title, p_group_color, new_title_size, new_text_size);
 		_text_groups.push_back(newGroup);
+		is_groups_order_dirty = true;
 		owner->mark_canvas_dirty();
 	}
 
@@ -200,7 +325,7 @@ void GroupedText::end_text_group() {
 		if (g->title == "") {
 			_current_text_group = g;
 			_current_text_group->set_show_title(false);
-			_current_text_group->set_group_priority(0);
+			_set_group_priority(_current_text_group, 0);
 			_current_text_group->set_group_color(owner->get_config()->get_text_foreground_color());
 			_current_text_group->set_title_size(owner->get_config()->get_text_default_size());
 			_current_text_group->set_text_size(owner->get_config()->get_text_default_size());
@@ -209,13 +334,75 @@ void GroupedText::end_text_group() {
 	}
 }
 
-void GroupedText::set_text(const String &p_key, const Variant &p_value, const int &p_priority, const Color &p_color_of_value, const double &p_duration) {
+static bool _is_same_text(const String &p_text, const char *p_ascii, const int &p_length) {
+	if (p_text.length() != p_length)
+		return false;
+
+	const char32_t *t = p_text.ptr();
+	for (int i = 0; i < p_length; i++) {
+		if (t[i] != (char32_t)p_ascii[i])
+			return false;
+	}
+	return true;
+}
+
+// Writes a number with the same precision as `real_t` and returns the length
+static int _format_real(char *r_buf, const size_t &p_size, const double &p_value, const bool &p_is_double) {
+	int len = snprintf(r_buf, p_size, p_is_double ? "%.14g" : "%.6g", p_value);
+	if (len < 0 || (size_t)len + 2 >= p_size)
+		return len;
+
+	// Whole numbers are written as "1.0" like `String::num_real`
+	for (int i = 0; i < len; i++) {
+		const char c = r_buf[i];
+		if (c == '.' || c == 'e' || c == 'n' || c == 'i')
+			return len;
+	}
+	r_buf[len++] = '.';
+	r_buf[len++] = '0';
+	r_buf[len] = 0;
+	return len;
+}
+
+void GroupedText::_set_text(const String &p_key, const String &p_value, const char *p_formatted, const int &p_formatted_length, const int &p_priority, const Color &p_color_of_value, const double &p_duration) {
 	ZoneScoped;
 	double new_duration = p_duration;
 	if (new_duration < 0) {
 		new_duration = owner->get_config()->get_text_default_duration();
 	}
 
+	const uint32_t key_hash = p_key.hash();
+
+	LOCK_GUARD(datalock);
+
+	_create_new_default_group_if_needed();
+
+	TextGroupItem *item = _current_text_group->find_text(p_key, key_hash);
+	if (item) {
+		if (item->priority != p_priority)
+			_current_text_group->is_texts_order_dirty = true;
+
+		bool is_dirty;
+		if (!p_formatted) {
+			is_dirty = item->update(new_duration, p_key, p_value, p_priority, p_color_of_value);
+		} else if (_is_same_text(item->text, p_formatted, p_formatted_length)) {
+			is_dirty = item->update(new_duration, p_key, item->text, p_priority, p_color_of_value);
+		} else {
+			is_dirty = item->update(new_duration, p_key, String(p_formatted), p_priority, p_color_of_value);
+		}
+
+		if (is_dirty) {
+			_current_text_group->is_dirty = true;
+			owner->mark_canvas_dirty();
+		}
+	} else {
+		_current_text_group->add_text(std::make_shared<TextGroupItem>(new_duration, p_key, p_formatted ? String(p_formatted) : p_value, p_priority, p_color_of_value), key_hash);
+		owner->mark_canvas_dirty();
+	}
+}
+
+void GroupedText::set_text(const String &p_key, const Variant &p_value, const int &p_priority, const Color &p_color_of_value, const double &p_duration) {
+	ZoneScoped;
 	String _strVal;
 	{
 		ZoneScopedN("stringify");
@@ -223,108 +410,145 @@ void GroupedText::set_text(const String &p_key, const Variant &p_value, const in
 			_strVal = p_value.stringify();
 	}
 
-	{
-		LOCK_GUARD(datalock);
+	_set_text(p_key, _strVal, nullptr, 0, p_priority, p_color_of_value, p_duration);
+}
 
-		_create_new_default_group_if_needed();
+void GroupedText::set_text_int(const String &p_key, const int64_t &p_value, const int &p_priority, const Color &p_color_of_value, const double &p_duration) {
+	ZoneScoped;
+	char buf[32];
+	int len = snprintf(buf, sizeof(buf), "%" PRId64, p_value);
+	_set_text(p_key, String(), buf, len, p_priority, p_color_of_value, p_duration);
+}
 
-		TextGroupItem_ptr item;
+void GroupedText::set_text_float(const String &p_key, const double &p_value, const int &p_priority, const Color &p_color_of_value, const double &p_duration) {
+	ZoneScoped;
+	char buf[32];
+	int len = _format_real(buf, sizeof(buf), p_value, true);
+	_set_text(p_key, String(), buf, len, p_priority, p_color_of_value, p_duration);
+}
+
+void GroupedText::set_text_vector3(const String &p_key, const Vector3 &p_value, const int &p_priority, const Color &p_color_of_value, const double &p_duration) {
+	ZoneScoped;
+#ifdef REAL_T_IS_DOUBLE
+	const bool is_double = true;
+#else
+	const bool is_double = false;
+#endif
 
-		for (const auto &d : _current_text_group->Texts) {
-			if (d->key == p_key) {
-				item = d;
-				break;
-			}
+	char buf[96];
+	int len = 0;
+	buf[len++] = '(';
+	for (int i = 0; i < 3; i++) {
+		if (i) {
+			buf[len++] = ',';
+			buf[len++] = ' ';
 		}
+		len += _format_real(buf + len, sizeof(buf) - len, p_value[i], is_double);
+	}
+	buf[len++] = ')';
+	buf[len] = 0;
 
-		if (item.get()) {
-			if (item->update(new_duration, p_key, _strVal, p_priority, p_color_of_value))
-				owner->mark_canvas_dirty();
-		} else {
-			_current_text_group->Texts.push_back(std::make_shared<TextGroupItem>(new_duration, p_key, _strVal, p_priority, p_color_of_value));
-			owner->mark_canvas_dirty();
+	_set_text(p_key, String(), buf, len, p_priority, p_color_of_value, p_duration);
+}
+
+void GroupedText::_record_group(TextGroup &p_group) {
+	ZoneScoped;
+	RenderingServer *rs = RenderingServer::get_singleton();
+	if (!p_group.canvas_item.is_valid()) {
+		p_group.canvas_item = rs->canvas_item_create();
+		rs->canvas_item_set_parent(p_group.canvas_item, parent_canvas_item);
+	}
+	rs->canvas_item_clear(p_group.canvas_item);
+
+	const RecordOptions &opts = record_options;
+	real_t pos_y = 0;
+
+	auto add_line = [&](TextGroupItem &t) {
+		const int font_size = t.is_group_title ? p_group.get_title_size() : p_group.get_text_size();
+		const TextGroupItem::Layout &l = t.get_layout(opts.font, font_size);
+
+		real_t size_right_revert = (l.size.x + opts.text_padding.x * 2) * opts.right_side_multiplier;
+		rs->canvas_item_add_rect(p_group.canvas_item,
+				Rect2(Vector2(size_right_revert, pos_y).floor(), Vector2(l.size.x + opts.text_padding.x * 2, l.size.y + opts.text_padding.y * 2).floor()),
+				opts.background_color);
+
+		// Draw colored string
+		const Vector2 text_pos = Vector2(size_right_revert + opts.text_padding.x, pos_y + opts.text_padding.y).floor();
+		l.key_line->draw(p_group.canvas_item, text_pos, p_group.get_group_color());
+		if (!l.is_title_only) {
+			const Color &value_color = t.value_color == Colors::empty_color ? p_group.get_group_color() : t.value_color;
+			l.value_line->draw(p_group.canvas_item, Vector2(text_pos.x + l.key_line->get_size().x, text_pos.y).floor(), value_color);
 		}
+		pos_y += l.size.y + opts.text_padding.y * 2;
+	};
+
+	if (p_group.is_show_title()) {
+		add_line(*p_group.title_item);
+	}
+
+	for (const TextGroupItem_ptr &t : p_group.Texts) {
+		add_line(*t);
 	}
+
+	p_group.height = pos_y;
+	p_group.is_dirty = false;
 }
 
 void GroupedText::draw(CanvasItem *p_ci, const Ref<Font> &p_font, const Vector2 &p_vp_size) {
 	ZoneScoped;
 	LOCK_GUARD(datalock);
-	static const String separator = " : ";
+	RenderingServer *rs = RenderingServer::get_singleton();
 
-	std::vector<DrawRectInstance> backgrounds;
-	std::vector<DrawTextInstance> text_parts;
-
-	real_t groups_height = 0;
-	{
-		Ref<Font> draw_font = owner->get_config()->get_text_custom_font().is_null() ? p_font : owner->get_config()->get_text_custom_font();
-		Vector2 pos;
-		real_t right_side_multiplier = 0;
-
-		switch (owner->get_config()->get_text_block_position()) {
-			case DebugDraw2DConfig::BlockPosition::POSITION_RIGHT_TOP:
-			case DebugDraw2DConfig::BlockPosition::POSITION_RIGHT_BOTTOM:
-				right_side_multiplier = -1;
-				break;
-			default:
-				break;
+	// The groups are drawn by their own canvas items, which are kept between redraws of `p_ci`
+	RID ci_rid = p_ci->get_canvas_item();
+	if (parent_canvas_item != ci_rid) {
+		parent_canvas_item = ci_rid;
+		for (const TextGroup_ptr &g : _text_groups) {
+			if (g->canvas_item.is_valid())
+				rs->canvas_item_set_parent(g->canvas_item, parent_canvas_item);
 		}
+	}
 
-		std::sort(_text_groups.begin(), _text_groups.end(),
-				[](TextGroup_ptr const &a, TextGroup_ptr const &b) { return a->get_group_priority() < b->get_group_priority(); });
+	RecordOptions new_opts;
+	new_opts.font = owner->get_config()->get_text_custom_font().is_null() ? p_font : owner->get_config()->get_text_custom_font();
+	new_opts.text_padding = owner->get_config()->get_text_padding();
+	new_opts.background_color = owner->get_config()->get_text_background_color();
 
-		for (const TextGroup_ptr &g : _text_groups) {
-			std::vector<TextGroupItem_ptr> group_items(g->Texts.begin(), g->Texts.end());
+	switch (owner->get_config()->get_text_block_position()) {
+		case DebugDraw2DConfig::BlockPosition::POSITION_RIGHT_TOP:
+		case DebugDraw2DConfig::BlockPosition::POSITION_RIGHT_BOTTOM:
+			new_opts.right_side_multiplier = -1;
+			break;
+		default:
+			break;
+	}
 
-			std::sort(group_items.begin(), group_items.end(), [](TextGroupItem_ptr const &a, TextGroupItem_ptr const &b) {
+	const bool is_all_dirty = !(new_opts == record_options);
+	record_options = new_opts;
+
+	// Removing items does not change the order, so the lists are sorted only when items are added or priorities are changed
+	if (is_groups_order_dirty) {
+		ZoneScopedN("Sort groups");
+		std::stable_sort(_text_groups.begin(), _text_groups.end(),
+				[](TextGroup_ptr const &a, TextGroup_ptr const &b) { return a->get_group_priority() < b->get_group_priority(); });
+		is_groups_order_dirty = false;
+	}
+
+	real_t groups_height = 0;
+	for (const TextGroup_ptr &g : _text_groups) {
+		if (g->is_texts_order_dirty) {
+			ZoneScopedN("Sort texts");
+			std::sort(g->Texts.begin(), g->Texts.end(), [](TextGroupItem_ptr const &a, TextGroupItem_ptr const &b) {
 				return a->priority < b->priority || (a->priority == b->priority && a->key.naturalnocasecmp_to(b->key) < 0);
 			});
-
-			// Add title to the list
-			if (g->is_show_title()) {
-				item_for_title_of_groups->key = g->title;
-				group_items.insert(group_items.begin(), item_for_title_of_groups);
-			}
-
-			for (const TextGroupItem_ptr &t : group_items) {
-				const String keyText = t->key;
-				const bool is_title_only = !t.get() || t->text == "";
-				const String text = is_title_only ? keyText : keyText + separator + t->text;
-
-				const int font_size = t->is_group_title ? g->get_title_size() : g->get_text_size();
-				const Vector2 size = draw_font->get_string_size(text, HORIZONTAL_ALIGNMENT_LEFT, -1, font_size);
-				const Vector2 text_padding = owner->get_config()->get_text_padding();
-				const Vector2 font_offset = Vector2(0, (real_t)draw_font->get_ascent(font_size)) + text_padding;
-
-				real_t size_right_revert = (size.x + text_padding.x * 2) * right_side_multiplier;
-				backgrounds.push_back(DrawRectInstance(
-						Rect2(Vector2(pos.x + size_right_revert, pos.y).floor(), Vector2(size.x + text_padding.x * 2, size.y + text_padding.y * 2).floor()),
-						owner->get_config()->get_text_background_color()));
-
-				// Draw colored string
-				if ((t.get() && t->value_color == Colors::empty_color) || is_title_only) {
-					// Both parts with same color
-					text_parts.push_back(DrawTextInstance(text, draw_font, font_size,
-							Vector2(pos.x + font_offset.x + size_right_revert, pos.y + font_offset.y).floor(),
-							g->get_group_color()));
-				} else {
-					// Both parts with different colors
-					String textSep = keyText + separator;
-					int64_t _keyLength = textSep.length();
-
-					text_parts.push_back(DrawTextInstance(text.substr(0, _keyLength), draw_font, font_size,
-							Vector2(pos.x + font_offset.x + size_right_revert, pos.y + font_offset.y).floor(),
-							g->get_group_color()));
-
-					text_parts.push_back(DrawTextInstance(text.substr(_keyLength, text.length() - _keyLength), draw_font, font_size,
-							Vector2(pos.x + font_offset.x + size_right_revert + draw_font->get_string_size(textSep, HORIZONTAL_ALIGNMENT_LEFT, -1, font_size).x, pos.y + font_offset.y).floor(),
-							t->value_color));
-				}
-				pos.y += size.y + text_padding.y * 2;
-			}
+			g->is_texts_order_dirty = false;
+			g->is_dirty = true;
 		}
 
-		groups_height = pos.y;
+		if (g->is_dirty || is_all_dirty) {
+			_record_group(*g);
+		}
+		groups_height += g->height;
 	}
 
 	Vector2 text_block_offset = owner->get_config()->get_text_block_offset();
@@ -350,14 +574,22 @@ void GroupedText::draw(CanvasItem *p_ci, const Ref<Font> &p_font, const Vector2
 			break;
 	}
 
-	for (auto &bg : backgrounds) {
-		bg.rect.position += pos;
-		p_ci->draw_rect(bg.rect, bg.color);
+	// Only the positions of the groups are updated on each redraw
+	for (const TextGroup_ptr &g : _text_groups) {
+		rs->canvas_item_set_transform(g->canvas_item, Transform2D(0, pos.floor()));
+		pos.y += g->height;
 	}
+}
 
-	for (auto &tp : text_parts) {
-		tp.position += pos;
-		p_ci->draw_string(tp.font, tp.position, tp.text, godot::HORIZONTAL_ALIGNMENT_LEFT, -1, tp.font_size, tp.color);
+void GroupedText::detach_canvas_items() {
+	ZoneScoped;
+	LOCK_GUARD(datalock);
+	RenderingServer *rs = RenderingServer::get_singleton();
+
+	parent_canvas_item = RID();
+	for (const TextGroup_ptr &g : _text_groups) {
+		if (g->canvas_item.is_valid())
+			rs->canvas_item_set_parent(g->canvas_item, RID());
 	}
 }
 
@@ -1,6 +1,7 @@
 #pragma once
 #ifndef DISABLE_DEBUG_RENDERING
 
+#include "common/colors.h"
 #include "utils/compiler.h"
 #include "utils/profiler.h"
 
@@ -12,12 +13,14 @@
 GODOT_WARNING_DISABLE()
 #include <godot_cpp/classes/canvas_item.hpp>
 #include <godot_cpp/classes/font.hpp>
+#include <godot_cpp/classes/text_line.hpp>
 GODOT_WARNING_RESTORE()
 using namespace godot;
 
 class TextGroupItem {
 public:
 	String key;
+	uint32_t key_hash = 0;
 	String text;
 	int priority;
 	double expiration_time;
@@ -29,10 +32,24 @@ public:
 	// It is necessary to avoid the endless re - creation of these objects.
 	bool second_chance = true;
 
+	/// Shaped line. It is shaped again only when the text, the font or the font size changes.
+	struct Layout {
+		bool is_valid = false;
+		Ref<Font> font;
+		int font_size = 0;
+
+		bool is_title_only = false;
+		// The whole line if `is_title_only`, otherwise the key with the separator
+		Ref<TextLine> key_line;
+		Ref<TextLine> value_line;
+		Vector2 size;
+	} layout;
+
 	TextGroupItem(const double &p_expirationTime, const String &p_key, const String &p_text, const int &p_priority, const Color &p_color);
 
 	bool update(const double &p_expirationTime, const String &p_key, const String &p_text, const int &p_priority, const Color &p_color);
 	bool is_expired();
+	const Layout &get_layout(const Ref<Font> &p_font, const int &p_font_size);
 };
 
 using TextGroupItem_ptr = std::shared_ptr<TextGroupItem>;
@@ -45,10 +62,29 @@ private:
 	int title_size;
 	int text_size;
 
+	/// Bucket of the open addressing index of Texts.
+	struct KeyBucket {
+		uint32_t hash;
+		// nullptr for empty buckets
+		TextGroupItem *item;
+	};
+	std::vector<KeyBucket> key_index;
+
+	void _insert_key(TextGroupItem *p_item);
+	void _rebuild_key_index();
+
 public:
+	// Canvas item with the recorded lines of this group. It is recorded again only when the group is dirty.
+	RID canvas_item;
+	bool is_dirty = true;
+	real_t height = 0;
+
 	bool is_used_one_time = false;
 	String title;
+	TextGroupItem_ptr title_item;
 	std::vector<TextGroupItem_ptr> Texts;
+	// Texts need to be sorted again before drawing
+	bool is_texts_order_dirty = false;
 	class DebugDraw2D *owner;
 
 	void set_group_priority(int p_val);
@@ -69,46 +105,48 @@ public:
 			title_size(14),
 			text_size(12),
 			title(""),
-			owner(nullptr){};
+			title_item(std::make_shared<TextGroupItem>(0.0, "", "", 0, Colors::empty_color)),
+			owner(nullptr) {
+		title_item->is_group_title = true;
+	};
 	TextGroup(class DebugDraw2D *p_owner, const String &p_title, const int &p_priority, const bool &p_show_title, const Color &p_group_color, const int &p_title_size, const int &p_text_size);
+	~TextGroup();
 	void cleanup_texts(const std::function<void()> &p_update, const double &p_delta);
+
+	TextGroupItem *find_text(const String &p_key, const uint32_t &p_key_hash);
+	void add_text(const TextGroupItem_ptr &p_item, const uint32_t &p_key_hash);
 };
 
 using TextGroup_ptr = std::shared_ptr<TextGroup>;
 
 class GroupedText {
-	struct DrawRectInstance {
-		Rect2 rect;
-		Color color;
-		bool filled;
-		DrawRectInstance(const Rect2 &p_rect, const Color &p_col, const bool &p_filled = true) :
-				rect(p_rect),
-				color(p_col),
-				filled(p_filled){};
-	};
-
-	struct DrawTextInstance {
-		String text;
+	// Options that affect all recorded groups
+	struct RecordOptions {
 		Ref<Font> font;
-		int font_size;
-		Vector2 position;
-		Color color;
-		DrawTextInstance(const String &p_text, const Ref<Font> &p_font, const int &p_font_size, const Vector2 &p_pos, const Color &p_col) :
-				text(p_text),
-				font(p_font),
-				font_size(p_font_size),
-				position(p_pos),
-				color(p_col){};
+		Vector2 text_padding;
+		Color background_color;
+		real_t right_side_multiplier = 0;
+
+		bool operator==(const RecordOptions &p_other) const {
+			return font == p_other.font && text_padding == p_other.text_padding && background_color == p_other.background_color && right_side_multiplier == p_other.right_side_multiplier;
+		}
 	};
 
-	TextGroupItem_ptr item_for_title_of_groups;
 	std::vector<TextGroup_ptr> _text_groups;
 	TextGroup_ptr _current_text_group;
+	// Groups need to be sorted again before drawing
+	bool is_groups_order_dirty = false;
+	RecordOptions record_options;
+	RID parent_canvas_item;
 	class DebugDraw2D *owner = nullptr;
 
 	ProfiledMutex(std::recursive_mutex, datalock, "Text lock");
 
 	void _create_new_default_group_if_needed();
+	void _set_group_priority(const TextGroup_ptr &p_group, const int &p_priority);
+	void _record_group(TextGroup &p_group);
+	/// `p_formatted` is used instead of `p_value` if it is not null. A new String is created from it only if the text has changed.
+	void _set_text(const String &p_key, const String &p_value, const char *p_formatted, const int &p_formatted_length, const int &p_priority, const Color &p_color_of_value, const double &p_duration);
 
 public:
 	void init_text_groups(class DebugDraw2D *p_owner);
@@ -117,7 +155,12 @@ public:
 	void begin_text_group(const String &p_group_title, const int &p_group_priority, const Color &p_group_color, const bool &p_show_title, const int &p_title_size, const int &p_text_size);
 	void end_text_group();
 	void set_text(const String &p_key, const Variant &p_value, const int &p_priority, const Color &p_color_of_value, const double &p_duration);
+	void set_text_int(const String &p_key, const int64_t &p_value, const int &p_priority, const Color &p_color_of_value, const double &p_duration);
+	void set_text_float(const String &p_key, const double &p_value, const int &p_priority, const Color &p_color_of_value, const double &p_duration);
+	void set_text_vector3(const String &p_key, const Vector3 &p_value, const int &p_priority, const Color &p_color_of_value, const double &p_duration);
 	void draw(CanvasItem *p_ci, const Ref<Font> &p_font, const Vector2 &p_vp_size);
+	/// Hides the recorded groups until the next `draw`, e.g. when the canvas is changed.
+	void detach_canvas_items();
 
 	size_t get_text_group_count();
 	size_t get_text_line_total_count();
@@ -13,6 +13,8 @@ void DebugDraw3DConfig::_bind_methods() {
 	REG_PROP_BOOL(use_frustum_culling);
 	REG_PROP(frustum_length_scale, Variant::FLOAT);
 	REG_PROP_BOOL(force_use_camera_from_scene);
+	REG_PROP_BOOL(use_glyph_atlas_for_text);
+	REG_PROP(text_max_distance, Variant::FLOAT);
 	REG_PROP(geometry_render_layers, Variant::INT);
 	REG_PROP(line_hit_color, Variant::COLOR);
 	REG_PROP(line_after_hit_color, Variant::COLOR);
@@ -61,6 +63,22 @@ bool DebugDraw3DConfig::is_force_use_camera_from_scene() const {
 	return force_use_camera_from_scene;
 }
 
+void DebugDraw3DConfig::set_use_glyph_atlas_for_text(const bool &_state) {
+	use_glyph_atlas_for_text = _state;
+}
+
+bool DebugDraw3DConfig::is_use_glyph_atlas_for_text() const {
+	return use_glyph_atlas_for_text;
+}
+
+void DebugDraw3DConfig::set_text_max_distance(const real_t &_distance) {
+	text_max_distance = Math::max(_distance, (real_t)0.0);
+}
+
+real_t DebugDraw3DConfig::get_text_max_distance() const {
+	return text_max_distance;
+}
+
 void DebugDraw3DConfig::set_geometry_render_layers(const int32_t &_layers) {
 	geometry_render_layers = _layers;
 }
@@ -24,6 +24,8 @@ private:
 	bool use_frustum_culling = true;
 	real_t frustum_length_scale = 0;
 	bool force_use_camera_from_scene = false;
+	bool use_glyph_atlas_for_text = false;
+	real_t text_max_distance = 0;
 	Color line_hit_color = Colors::red;
 	Color line_after_hit_color = Colors::green;
 
@@ -68,6 +70,26 @@ public:
 	void set_force_use_camera_from_scene(const bool &_state);
 	bool is_force_use_camera_from_scene() const;
 
+	/**
+	 * Set whether DebugDraw3D.draw_text draws glyphs from the font cache as instanced quads instead of creating Label3D nodes.
+	 *
+	 * @note
+	 * Text is always centered and is not shaped, so ligatures and complex scripts are not supported.
+	 * Fonts with multichannel signed distance fields are still drawn with Label3D.
+	 */
+	void set_use_glyph_atlas_for_text(const bool &_state);
+	bool is_use_glyph_atlas_for_text() const;
+
+	/**
+	 * Set the maximum distance from the cameras at which DebugDraw3D.draw_text creates labels.
+	 * Set to 0 to disable the distance limit.
+	 *
+	 * @note
+	 * Like the frustum culling of the text, it is applied only to labels with zero duration.
+	 */
+	void set_text_max_distance(const real_t &_distance);
+	real_t get_text_max_distance() const;
+
 	/**
 	 * Set the visibility layer on which the 3D geometry will be drawn.
 	 * Similar to using VisualInstance3D.layers.
@@ -1,5 +1,7 @@
 #include "config_scope_3d.h"
 
+#include "common/pooled_allocators.h"
+#include "debug_draw_3d.h"
 #include "utils/utils.h"
 
 GODOT_WARNING_DISABLE()
@@ -47,7 +49,7 @@ void DebugDraw3DScopeConfig::_manual_unregister() {
 }
 
 Ref<DebugDraw3DScopeConfig> DebugDraw3DScopeConfig::set_thickness(real_t _value) const {
-	data->thickness = Math::clamp(_value, (real_t)0, (real_t)100);
+	data->set_thickness(_value);
 	return Ref<DebugDraw3DScopeConfig>(this);
 }
 
@@ -56,7 +58,7 @@ real_t DebugDraw3DScopeConfig::get_thickness() const {
 }
 
 Ref<DebugDraw3DScopeConfig> DebugDraw3DScopeConfig::set_center_brightness(real_t _value) const {
-	data->center_brightness = Math::clamp(_value, (real_t)0, (real_t)1);
+	data->set_center_brightness(_value);
 	return Ref<DebugDraw3DScopeConfig>(this);
 }
 
@@ -83,12 +85,7 @@ real_t DebugDraw3DScopeConfig::get_plane_size() const {
 }
 
 Ref<DebugDraw3DScopeConfig> DebugDraw3DScopeConfig::set_text_outline_color(Color _value) const {
-	data->text_outline_color = _value;
-	uint32_t hash = hash_murmur3_one_float(_value.r);
-	hash = hash_murmur3_one_float(_value.g, hash);
-	hash = hash_murmur3_one_float(_value.b, hash);
-	data->text_outline_color_hash = hash_murmur3_one_float(_value.a, hash);
-
+	data->set_text_outline_color(_value);
 	return Ref<DebugDraw3DScopeConfig>(this);
 }
 
@@ -115,8 +112,7 @@ Ref<Font> DebugDraw3DScopeConfig::get_text_font() const {
 }
 
 Ref<DebugDraw3DScopeConfig> DebugDraw3DScopeConfig::set_viewport(Viewport *_value) const {
-	data->dcd.viewport = _value;
-	data->dcd.viewport_id = _value ? _value->get_instance_id() : 0;
+	data->set_viewport(_value);
 	return Ref<DebugDraw3DScopeConfig>(this);
 }
 
@@ -138,7 +134,7 @@ DebugDraw3DScopeConfig::DebugDraw3DScopeConfig() {
 	thread_id = 0;
 	guard_id = 0;
 
-	data = std::make_shared<Data>();
+	data = std::allocate_shared<Data>(ThreadCachedAllocator<Data>());
 }
 
 DebugDraw3DScopeConfig::DebugDraw3DScopeConfig(const uint64_t &p_thread_id, const uint64_t &p_guard_id, const DebugDraw3DScopeConfig::Data *p_parent, const unregister_func p_unreg) {
@@ -147,7 +143,7 @@ DebugDraw3DScopeConfig::DebugDraw3DScopeConfig(const uint64_t &p_thread_id, cons
 	thread_id = p_thread_id;
 	guard_id = p_guard_id;
 
-	data = std::make_shared<Data>(p_parent);
+	data = std::allocate_shared<Data>(ThreadCachedAllocator<Data>(), p_parent);
 }
 
 DebugDraw3DScopeConfig::~DebugDraw3DScopeConfig() {
@@ -180,3 +176,87 @@ DebugDraw3DScopeConfig::Data::Data(const Data *p_parent) :
 		text_font(p_parent->text_font),
 		dcd(p_parent->dcd) {
 }
+
+void DebugDraw3DScopeConfig::Data::set_thickness(real_t p_value) {
+	thickness = Math::clamp(p_value, (real_t)0, (real_t)100);
+}
+
+void DebugDraw3DScopeConfig::Data::set_center_brightness(real_t p_value) {
+	center_brightness = Math::clamp(p_value, (real_t)0, (real_t)1);
+}
+
+void DebugDraw3DScopeConfig::Data::set_text_outline_color(const Color &p_value) {
+	text_outline_color = p_value;
+	uint32_t hash = hash_murmur3_one_float(p_value.r);
+	hash = hash_murmur3_one_float(p_value.g, hash);
+	hash = hash_murmur3_one_float(p_value.b, hash);
+	text_outline_color_hash = hash_murmur3_one_float(p_value.a, hash);
+}
+
+void DebugDraw3DScopeConfig::Data::set_viewport(Viewport *p_value) {
+	dcd.viewport = p_value;
+	dcd.viewport_id = p_value ? p_value->get_instance_id() : 0;
+}
+
+DebugDraw3DScope::DebugDraw3DScope() {
+#ifndef DISABLE_DEBUG_RENDERING
+	if (DebugDraw3D *dd = DebugDraw3D::get_singleton()) {
+		dd->_push_native_scope(this);
+	}
+#endif
+}
+
+DebugDraw3DScope::~DebugDraw3DScope() {
+#ifndef DISABLE_DEBUG_RENDERING
+	if (guard_id) {
+		if (DebugDraw3D *dd = DebugDraw3D::get_singleton()) {
+			dd->_unregister_scoped_config(thread_id, guard_id);
+		}
+	}
+#endif
+}
+
+DebugDraw3DScope &DebugDraw3DScope::set_thickness(real_t p_value) {
+	data.set_thickness(p_value);
+	return *this;
+}
+
+DebugDraw3DScope &DebugDraw3DScope::set_center_brightness(real_t p_value) {
+	data.set_center_brightness(p_value);
+	return *this;
+}
+
+DebugDraw3DScope &DebugDraw3DScope::set_hd_sphere(bool p_value) {
+	data.hd_sphere = p_value;
+	return *this;
+}
+
+DebugDraw3DScope &DebugDraw3DScope::set_plane_size(real_t p_value) {
+	data.plane_size = p_value;
+	return *this;
+}
+
+DebugDraw3DScope &DebugDraw3DScope::set_text_outline_color(const Color &p_value) {
+	data.set_text_outline_color(p_value);
+	return *this;
+}
+
+DebugDraw3DScope &DebugDraw3DScope::set_text_outline_size(int32_t p_value) {
+	data.text_outline_size = p_value;
+	return *this;
+}
+
+DebugDraw3DScope &DebugDraw3DScope::set_text_font(const Ref<Font> &p_value) {
+	data.text_font = p_value;
+	return *this;
+}
+
+DebugDraw3DScope &DebugDraw3DScope::set_viewport(Viewport *p_value) {
+	data.set_viewport(p_value);
+	return *this;
+}
+
+DebugDraw3DScope &DebugDraw3DScope::set_no_depth_test(bool p_value) {
+	data.dcd.no_depth_test = p_value;
+	return *this;
+}
@@ -67,7 +67,8 @@ private:
 	uint64_t thread_id;
 	uint64_t guard_id;
 
-	using unregister_func = std::function<void(const uint64_t &, const uint64_t &)>;
+	// A plain function is used instead of a closure to avoid an allocation for each config
+	using unregister_func = void (*)(const uint64_t &, const uint64_t &);
 	unregister_func unregister_action;
 
 public:
@@ -93,6 +94,12 @@ public:
 
 		Data();
 		Data(const Data *parent);
+
+		// Setters with additional logic, shared by DebugDraw3DScopeConfig and DebugDraw3DScope
+		void set_thickness(real_t p_value);
+		void set_center_brightness(real_t p_value);
+		void set_text_outline_color(const Color &p_value);
+		void set_viewport(Viewport *p_value);
 	};
 	/// @private
 	std::shared_ptr<Data> data = nullptr;
@@ -198,3 +205,54 @@ public:
 	DebugDraw3DScopeConfig(const uint64_t &p_thread_id, const uint64_t &p_guard_id, const DebugDraw3DScopeConfig::Data *p_parent, const unregister_func p_unreg);
 	~DebugDraw3DScopeConfig();
 };
+
+/**
+ * Scoped config for C++ code that does not create a DebugDraw3DScopeConfig.
+ *
+ * The parameters are copied from the current scope of this thread and the new scope is active until the object is destroyed.
+ * It must be created on the stack and only on the thread that uses it.
+ *
+ * ```cpp
+ * {
+ * 	DebugDraw3DScope s;
+ * 	s.set_thickness(0.1f).set_no_depth_test(true);
+ * 	DebugDraw3D::get_singleton()->draw_box_xf(xf);
+ * }
+ * ```
+ */
+class DebugDraw3DScope {
+	friend class DebugDraw3D;
+
+	uint64_t thread_id = 0;
+	uint64_t guard_id = 0;
+	DebugDraw3DScopeConfig::Data data;
+
+public:
+	DebugDraw3DScope();
+	~DebugDraw3DScope();
+	DebugDraw3DScope(const DebugDraw3DScope &) = delete;
+	DebugDraw3DScope &operator=(const DebugDraw3DScope &) = delete;
+
+	/// Same as DebugDraw3DScopeConfig.set_thickness
+	DebugDraw3DScope &set_thickness(real_t p_value);
+	/// Same as DebugDraw3DScopeConfig.set_center_brightness
+	DebugDraw3DScope &set_center_brightness(real_t p_value);
+	/// Same as DebugDraw3DScopeConfig.set_hd_sphere
+	DebugDraw3DScope &set_hd_sphere(bool p_value);
+	/// Same as DebugDraw3DScopeConfig.set_plane_size
+	DebugDraw3DScope &set_plane_size(real_t p_value);
+	/// Same as DebugDraw3DScopeConfig.set_text_outline_color
+	DebugDraw3DScope &set_text_outline_color(const Color &p_value);
+	/// Same as DebugDraw3DScopeConfig.set_text_outline_size
+	DebugDraw3DScope &set_text_outline_size(int32_t p_value);
+	/// Same as DebugDraw3DScopeConfig.set_text_font
+	DebugDraw3DScope &set_text_font(const Ref<Font> &p_value);
+	/// Same as DebugDraw3DScopeConfig.set_viewport
+	DebugDraw3DScope &set_viewport(Viewport *p_value);
+	/// Same as DebugDraw3DScopeConfig.set_no_depth_test
+	DebugDraw3DScope &set_no_depth_test(bool p_value);
+
+	_FORCE_INLINE_ const DebugDraw3DScopeConfig::Data &get_data() const {
+		return data;
+	}
+};
@@ -9,13 +9,15 @@
 #include "stats_3d.h"
 #include "utils/utils.h"
 
+#include <algorithm>
+
 GODOT_WARNING_DISABLE()
 #include <godot_cpp/classes/camera3d.hpp>
-#include <godot_cpp/classes/os.hpp>
 #include <godot_cpp/classes/world3d.hpp>
 
 #ifndef DISABLE_DEBUG_RENDERING
 #include <godot_cpp/classes/rendering_server.hpp>
+#include <godot_cpp/classes/worker_thread_pool.hpp>
 
 // save meshes
 #if !defined(DISABLE_DEBUG_RENDERING) && defined(DEV_ENABLED)
@@ -29,6 +31,46 @@ GODOT_WARNING_RESTORE()
 #define NEED_LEAVE (!_is_enabled_override())
 
 #ifndef DISABLE_DEBUG_RENDERING
+/// Temporary storage for generated lines. The lines are copied into the geometry pool, so the next call can reuse it.
+static Vector3 *_get_temp_lines(size_t p_count) {
+	thread_local std::vector<Vector3> temp_lines;
+	if (temp_lines.size() < p_count) {
+		temp_lines.resize(p_count);
+	}
+	return temp_lines.data();
+}
+
+/// Generations of the scoped config stacks are unique across all DebugDraw3D instances.
+static uint64_t _next_scoped_configs_generation() {
+	static std::atomic<uint64_t> generations_counter = 0;
+	return ++generations_counter;
+}
+
+/// Arrays of per-item values in batch calls can be empty, contain one value for all items or one value for each item.
+static bool _is_batch_array_size_valid(int64_t p_size, int64_t p_items_count, const char *p_name) {
+	if (p_size > 1 && p_size != p_items_count) {
+		PRINT_ERROR("The size of the '{0}' array must be 0, 1 or {1}. Received {2}.", p_name, p_items_count, p_size);
+		return false;
+	}
+	return true;
+}
+
+static _FORCE_INLINE_ const Color &_get_batch_color(const Color *p_colors, int64_t p_colors_count, int64_t p_idx, const Color &p_default) {
+	if (!p_colors_count)
+		return p_default;
+	const Color &c = p_colors[p_colors_count == 1 ? 0 : p_idx];
+	return c == Colors::empty_color ? p_default : c;
+}
+
+/// Reads a transform stored as in MultiMesh.buffer.
+static _FORCE_INLINE_ Transform3D _get_batch_transform(const float *p_data) {
+	return Transform3D(
+			p_data[0], p_data[1], p_data[2],
+			p_data[4], p_data[5], p_data[6],
+			p_data[8], p_data[9], p_data[10],
+			p_data[3], p_data[7], p_data[11]);
+}
+
 void _DD3D_WorldWatcher::_process(double p_delta) {
 	set_process(false);
 	if (!m_owner) {
@@ -93,6 +135,10 @@ const char *DebugDraw3D::s_default_plane_size = "volumetric_defaults/plane_size"
 const char *DebugDraw3D::s_render_priority = "rendering/render_priority";
 const char *DebugDraw3D::s_render_mode = "rendering/render_mode";
 const char *DebugDraw3D::s_render_fog_disabled = "rendering/disable_fog";
+const char *DebugDraw3D::s_geometry_fill_threads = "rendering/geometry_fill_threads";
+#ifdef DEV_ENABLED
+const char *DebugDraw3D::s_dev_benchmark_culling = "dev/benchmark_culling_on_startup";
+#endif
 
 void DebugDraw3D::_bind_methods() {
 #define REG_CLASS_NAME DebugDraw3D
@@ -117,6 +163,7 @@ void DebugDraw3D::_bind_methods() {
 
 	ClassDB::bind_method(D_METHOD(NAMEOF(draw_sphere), "position", "radius", "color", "duration"), &DebugDraw3D::draw_sphere, 0.5f, Colors::empty_color, 0);
 	ClassDB::bind_method(D_METHOD(NAMEOF(draw_sphere_xf), "transform", "color", "duration"), &DebugDraw3D::draw_sphere_xf, Colors::empty_color, 0);
+	ClassDB::bind_method(D_METHOD(NAMEOF(draw_spheres), "positions", "radii", "colors", "duration"), &DebugDraw3D::draw_spheres, PackedFloat32Array(), PackedColorArray(), 0);
 
 	ClassDB::bind_method(D_METHOD(NAMEOF(draw_cylinder), "transform", "color", "duration"), &DebugDraw3D::draw_cylinder, Colors::empty_color, 0);
 	ClassDB::bind_method(D_METHOD(NAMEOF(draw_cylinder_ab), "a", "b", "radius", "color", "duration"), &DebugDraw3D::draw_cylinder_ab, 0.5f, Colors::empty_color, 0);
@@ -124,6 +171,7 @@ void DebugDraw3D::_bind_methods() {
 	ClassDB::bind_method(D_METHOD(NAMEOF(draw_box), "position", "rotation", "size", "color", "is_box_centered", "duration"), &DebugDraw3D::draw_box, Colors::empty_color, false, 0);
 	ClassDB::bind_method(D_METHOD(NAMEOF(draw_box_ab), "a", "b", "up", "color", "is_ab_diagonal", "duration"), &DebugDraw3D::draw_box_ab, Vector3(0, 1, 0), Colors::empty_color, true, 0);
 	ClassDB::bind_method(D_METHOD(NAMEOF(draw_box_xf), "transform", "color", "is_box_centered", "duration"), &DebugDraw3D::draw_box_xf, Colors::empty_color, true, 0);
+	ClassDB::bind_method(D_METHOD(NAMEOF(draw_boxes), "transforms", "colors", "is_box_centered", "duration"), &DebugDraw3D::draw_boxes, PackedColorArray(), true, 0);
 	ClassDB::bind_method(D_METHOD(NAMEOF(draw_aabb), "aabb", "color", "duration"), &DebugDraw3D::draw_aabb, Colors::empty_color, 0);
 	ClassDB::bind_method(D_METHOD(NAMEOF(draw_aabb_ab), "a", "b", "color", "duration"), &DebugDraw3D::draw_aabb_ab, Colors::empty_color, 0);
 
@@ -139,6 +187,7 @@ void DebugDraw3D::_bind_methods() {
 
 	ClassDB::bind_method(D_METHOD(NAMEOF(draw_arrow), "a", "b", "color", "arrow_size", "is_absolute_size", "duration"), &DebugDraw3D::draw_arrow, Colors::empty_color, 0.5f, false, 0);
 	ClassDB::bind_method(D_METHOD(NAMEOF(draw_arrow_ray), "origin", "direction", "length", "color", "arrow_size", "is_absolute_size", "duration"), &DebugDraw3D::draw_arrow_ray, Colors::empty_color, 0.5f, false, 0);
+	ClassDB::bind_method(D_METHOD(NAMEOF(draw_arrows), "lines", "colors", "arrow_size", "is_absolute_size", "duration"), &DebugDraw3D::draw_arrows, PackedColorArray(), 0.5f, false, 0);
 	ClassDB::bind_method(D_METHOD(NAMEOF(draw_arrow_path), "path", "color", "arrow_size", "is_absolute_size", "duration"), &DebugDraw3D::draw_arrow_path, Colors::empty_color, 0.75f, true, 0);
 
 	ClassDB::bind_method(D_METHOD(NAMEOF(draw_point_path), "path", "type", "size", "points_color", "lines_color", "duration"), &DebugDraw3D::draw_point_path, PointType::POINT_TYPE_SQUARE, 0.25f, Colors::empty_color, Colors::empty_color, 0);
@@ -152,6 +201,7 @@ void DebugDraw3D::_bind_methods() {
 	ClassDB::bind_method(D_METHOD(NAMEOF(draw_camera_frustum_planes), "camera_frustum", "color", "duration"), &DebugDraw3D::draw_camera_frustum_planes, Colors::empty_color, 0);
 
 	ClassDB::bind_method(D_METHOD(NAMEOF(draw_position), "transform", "color", "duration"), &DebugDraw3D::draw_position, Colors::empty_color, 0);
+	ClassDB::bind_method(D_METHOD(NAMEOF(draw_positions), "transforms", "colors", "duration"), &DebugDraw3D::draw_positions, PackedColorArray(), 0);
 
 	ClassDB::bind_method(D_METHOD(NAMEOF(draw_gizmo), "transform", "color", "is_centered", "duration"), &DebugDraw3D::draw_gizmo, Colors::empty_color, false, 0);
 
@@ -175,6 +225,13 @@ void DebugDraw3D::_bind_methods() {
 
 DebugDraw3D::DebugDraw3D() {
 	ASSIGN_SINGLETON(DebugDraw3D);
+
+#ifndef DISABLE_DEBUG_RENDERING
+	// Used to invalidate the thread buffers of the previous instances
+	static std::atomic<uint64_t> instances_counter = 0;
+	thread_buffers_generation = ++instances_counter;
+	scoped_configs_generation = _next_scoped_configs_generation();
+#endif
 }
 
 void DebugDraw3D::init(DebugDrawManager *p_root) {
@@ -182,6 +239,10 @@ void DebugDraw3D::init(DebugDrawManager *p_root) {
 	root_node = p_root;
 	set_config(nullptr);
 
+#ifndef DISABLE_DEBUG_RENDERING
+	main_thread_id = std::this_thread::get_id();
+#endif
+
 	root_settings_section = String(Utils::root_settings_section) + "3d/";
 	DEFINE_SETTING(root_settings_section + s_add_bevel_to_volumetric, true, Variant::BOOL);
 	DEFINE_SETTING(root_settings_section + s_use_icosphere, false, Variant::BOOL);
@@ -196,6 +257,23 @@ void DebugDraw3D::init(DebugDrawManager *p_root) {
 	DEFINE_SETTING(root_settings_section + s_render_priority, 0, Variant::INT);
 	DEFINE_SETTING_HINT(root_settings_section + s_render_mode, 0, Variant::INT, PROPERTY_HINT_ENUM, "Default,Forced Transparent,Forced Opaque");
 	DEFINE_SETTING(root_settings_section + s_render_fog_disabled, true, Variant::BOOL);
+	DEFINE_SETTING_HINT(root_settings_section + s_geometry_fill_threads, 0, Variant::INT, PROPERTY_HINT_RANGE, "0,64");
+
+#ifdef DEV_ENABLED
+	DEFINE_SETTING_AND_GET(bool dev_benchmark_culling, root_settings_section + s_dev_benchmark_culling, false, Variant::BOOL);
+#endif
+
+#ifndef DISABLE_DEBUG_RENDERING
+	geometry_fill_threads = PS()->get_setting(root_settings_section + s_geometry_fill_threads);
+
+#ifdef DEV_ENABLED
+	if (dev_benchmark_culling) {
+		CullingKernel::dev_benchmark();
+	} else {
+		CullingKernel::dev_self_check();
+	}
+#endif
+#endif
 
 	default_scoped_config.instantiate();
 
@@ -213,6 +291,10 @@ DebugDraw3D::~DebugDraw3D() {
 	ZoneScoped;
 	UNASSIGN_SINGLETON(DebugDraw3D);
 
+#ifndef DISABLE_DEBUG_RENDERING
+	_untrack_viewports();
+	_untrack_fonts();
+#endif
 	root_node = nullptr;
 }
 
@@ -230,6 +312,10 @@ void DebugDraw3D::process_end(double p_delta) {
 	FrameMarkStart("3D Update");
 	LOCK_GUARD(datalock);
 
+	// Before the containers access the Viewports
+	_remove_deleted_viewports();
+	merge_thread_command_buffers();
+
 	// Update 3D debug
 	for (const auto &p : debug_containers) {
 		for (const auto &dgc : p.second.dgcs) {
@@ -244,9 +330,14 @@ void DebugDraw3D::process_end(double p_delta) {
 		}
 	}
 
+#ifdef TRACY_ENABLE
+	if (TracyIsConnected) {
+		get_render_stats()->plot_breakdown();
+	}
+#endif
+
 	_clear_scoped_configs();
-	// Reset viewport cache after frame
-	viewport_to_world_cache.clear();
+	world_cache_frame++;
 	FrameMarkEnd("3D Update");
 #endif
 }
@@ -257,6 +348,7 @@ void DebugDraw3D::physics_process_start(double p_delta) {
 	FrameMarkStart("3D Physics Step");
 
 	LOCK_GUARD(datalock);
+	_remove_deleted_viewports();
 	for (const auto &p : debug_containers) {
 		for (const auto &dgc : p.second.dgcs) {
 			if (dgc) {
@@ -295,54 +387,95 @@ void DebugDraw3D::physics_process_end(double p_delta) {
 }
 
 #ifndef DISABLE_DEBUG_RENDERING
-const DebugDraw3DScopeConfig::Data *DebugDraw3D::scoped_config_for_current_thread() {
-	ZoneScoped;
-	LOCK_GUARD(datalock);
-	uint64_t thread = OS::get_singleton()->get_thread_caller_id();
+DebugDraw3D::ScopedConfigStack *DebugDraw3D::get_thread_scoped_config_stack(bool p_create) {
+	thread_local std::shared_ptr<ScopedConfigStack> stack;
+
+	if (!stack || stack->generation != scoped_configs_generation) {
+		if (!p_create)
+			return nullptr;
+
+		ZoneScopedN("Register scoped config stack");
+		static std::atomic<uint64_t> stacks_counter = 0;
+		stack = std::make_shared<ScopedConfigStack>();
+		stack->id = ++stacks_counter;
 
-	if (const auto &it = cached_scoped_configs.find(thread); it != cached_scoped_configs.cend()) {
-		return it->second.get();
+		LOCK_GUARD(datalock);
+		stack->generation = scoped_configs_generation;
+		scoped_config_stacks.push_back(stack);
 	}
 
-	if (const auto &it = scoped_configs.find(thread); it != scoped_configs.cend()) {
-		const auto &cfgs = it->second;
-		if (!cfgs.empty()) {
-			DebugDraw3DScopeConfig *tmp = cfgs.back().scfg;
-			cached_scoped_configs[thread] = tmp->data;
-			return tmp->data.get();
+	if (stack->has_pending_removals) {
+		std::vector<uint64_t> removals;
+		{
+			LOCK_GUARD(stack->pending_removals_lock);
+			removals.swap(stack->pending_removals);
+			stack->has_pending_removals = false;
+		}
+
+		for (const uint64_t &id : removals) {
+			_remove_scoped_config_from_stack(stack.get(), id);
 		}
 	}
 
-	cached_scoped_configs[thread] = default_scoped_config.ptr()->data;
+	return stack.get();
+}
+
+void DebugDraw3D::_remove_scoped_config_from_stack(ScopedConfigStack *p_stack, uint64_t p_guard_id) {
+	auto &cfgs = p_stack->configs;
+	auto res = std::find_if(cfgs.rbegin(), cfgs.rend(), [&p_guard_id](const ScopedPairIdConfig &i) { return i.id == p_guard_id; });
+
+	if (res != cfgs.rend()) {
+		cfgs.erase(--res.base());
+		p_stack->configs_count = cfgs.size();
+	}
+}
+
+const DebugDraw3DScopeConfig::Data *DebugDraw3D::scoped_config_for_current_thread() {
+	ScopedConfigStack *stack = get_thread_scoped_config_stack(false);
+	if (stack && !stack->configs.empty()) {
+		return stack->configs.back().data;
+	}
 	return default_scoped_config.ptr()->data.get();
 }
 
+void DebugDraw3D::_push_scoped_config(ScopedConfigStack *p_stack, uint64_t p_guard_id, const DebugDraw3DScopeConfig::Data *p_data, const std::shared_ptr<DebugDraw3DScopeConfig::Data> &p_owned_data) {
+	p_stack->configs.push_back(ScopedPairIdConfig(p_guard_id, p_data, p_owned_data));
+	p_stack->configs_count = p_stack->configs.size();
+	created_scoped_configs++;
+}
+
 void DebugDraw3D::_register_scoped_config(uint64_t p_thread_id, uint64_t p_guard_id, DebugDraw3DScopeConfig *p_cfg) {
 	ZoneScoped;
-	LOCK_GUARD(datalock);
+	_push_scoped_config(get_thread_scoped_config_stack(true), p_guard_id, p_cfg->data.get(), p_cfg->data);
+}
 
-	uint64_t thread = OS::get_singleton()->get_thread_caller_id();
-	scoped_configs[p_thread_id].push_back(ScopedPairIdConfig(p_guard_id, p_cfg));
+void DebugDraw3D::_push_native_scope(DebugDraw3DScope *p_scope) {
+	ScopedConfigStack *stack = get_thread_scoped_config_stack(true);
+	p_scope->data = DebugDraw3DScopeConfig::Data(scoped_config_for_current_thread());
+	p_scope->thread_id = stack->id;
+	p_scope->guard_id = ++scoped_configs_guards_counter;
 
-	// Update cached value
-	cached_scoped_configs[thread] = p_cfg->data;
+	_push_scoped_config(stack, p_scope->guard_id, &p_scope->data, nullptr);
 }
 
-void DebugDraw3D::_unregister_scoped_config(uint64_t thread_id, uint64_t guard_id) {
+void DebugDraw3D::_unregister_scoped_config(uint64_t p_thread_id, uint64_t p_guard_id) {
 	ZoneScoped;
-	LOCK_GUARD(datalock);
-
-	auto &cfgs = scoped_configs[thread_id];
-	auto res = std::find_if(cfgs.rbegin(), cfgs.rend(), [&guard_id](const ScopedPairIdConfig &i) { return i.id == guard_id; });
-
-	if (res != cfgs.rend()) {
-		cfgs.erase(--res.base());
+	// `p_thread_id` is the id of the stack that the config was registered in
+	ScopedConfigStack *stack = get_thread_scoped_config_stack(false);
+	if (stack && stack->id == p_thread_id) {
+		_remove_scoped_config_from_stack(stack, p_guard_id);
+		return;
+	}
 
-		// Update cached value
-		if (!cfgs.empty()) {
-			cached_scoped_configs[thread_id] = cfgs.back().scfg->data;
-		} else {
-			cached_scoped_configs[thread_id] = default_scoped_config.ptr()->data;
+	// The config is released by another thread, e.g. by the garbage collector.
+	// The stack is not found if it was already cleared at the end of the frame.
+	LOCK_GUARD(datalock);
+	for (const auto &s : scoped_config_stacks) {
+		if (s->id == p_thread_id) {
+			LOCK_GUARD(s->pending_removals_lock);
+			s->pending_removals.push_back(p_guard_id);
+			s->has_pending_removals = true;
+			return;
 		}
 	}
 }
@@ -352,26 +485,109 @@ void DebugDraw3D::_clear_scoped_configs() {
 	LOCK_GUARD(datalock);
 
 	uint64_t orphans = 0;
-	for (auto &p : scoped_configs) {
-		orphans += p.second.size();
+	for (const auto &s : scoped_config_stacks) {
+		LOCK_GUARD(s->pending_removals_lock);
+		size_t count = s->configs_count;
+		size_t pending = s->pending_removals.size();
+		orphans += count > pending ? count - pending : 0;
 	}
 
-	scoped_stats_3d.created = created_scoped_configs;
+	scoped_stats_3d.created = created_scoped_configs.exchange(0);
 	scoped_stats_3d.orphans = orphans;
 
-	created_scoped_configs = 0;
-
-	cached_scoped_configs.clear();
-	scoped_configs.clear();
+	// Each thread will create a new stack on the next use
+	scoped_config_stacks.clear();
+	scoped_configs_generation = _next_scoped_configs_generation();
 
 	if (orphans)
 		PRINT_ERROR("{0} scoped configs weren't freed. Do not save scoped configurations anywhere other than function bodies.", orphans);
 }
 
+void DebugDraw3D::merge_thread_command_buffers() {
+	ZoneScoped;
+	LOCK_GUARD(datalock);
+
+	DebugDraw3DScopeConfig::Data cfg;
+	uint64_t last_valid_viewport_id = 0;
+
+	for (auto it = thread_command_buffers.begin(); it != thread_command_buffers.end();) {
+		// Only this array owns the buffer, so its thread has been finished.
+		bool is_orphaned = it->use_count() == 1;
+
+		ThreadCommandBuffer *buffer = it->get();
+		buffer->commands.consume([this, buffer, &cfg, &last_valid_viewport_id](DeferredDrawCommand &cmd) {
+			// The vertices of the previous commands are no longer needed
+			if (cmd.lines_chunk) {
+				buffer->lines.release_before(cmd.lines_chunk);
+			}
+
+			// The Viewport could have been deleted after the command was recorded.
+			if (cmd.dcd.viewport_id != last_valid_viewport_id) {
+				// Tracked viewports are removed as soon as they leave the tree
+				if (tracked_viewports.find(cmd.dcd.viewport_id) == tracked_viewports.end() && !UtilityFunctions::is_instance_id_valid(cmd.dcd.viewport_id)) {
+					return;
+				}
+				last_valid_viewport_id = cmd.dcd.viewport_id;
+			}
+
+			apply_deferred_command(&cfg, cmd);
+		});
+
+		if (is_orphaned) {
+			it = thread_command_buffers.erase(it);
+		} else {
+			it++;
+		}
+	}
+
+	threading_stats_3d.lock_contentions = draw_lock_contentions.exchange(0);
+	threading_stats_3d.deferred_commands = deferred_draw_commands.exchange(0);
+	threading_stats_3d.thread_buffers = thread_command_buffers.size();
+}
+
+DebugDraw3D::ThreadCommandBuffer *DebugDraw3D::get_thread_command_buffer() {
+	thread_local std::shared_ptr<ThreadCommandBuffer> buffer;
+	thread_local uint64_t buffer_generation = 0;
+
+	if (!buffer || buffer_generation != thread_buffers_generation) {
+		ZoneScopedN("Register thread buffer");
+		buffer = std::make_shared<ThreadCommandBuffer>();
+		buffer_generation = thread_buffers_generation;
+
+		LOCK_GUARD(datalock);
+		thread_command_buffers.push_back(buffer);
+	}
+
+	return buffer.get();
+}
+
 Node *DebugDraw3D::get_root_node() {
 	return root_node;
 }
 
+void DebugDraw3D::_run_parallel_task(uint32_t p_index) {
+	(*parallel_task)(p_index);
+}
+
+void DebugDraw3D::run_parallel_for(uint32_t p_count, const std::function<void(uint32_t)> &p_task) {
+	ZoneScoped;
+	if (geometry_fill_threads <= 0 || p_count < 2) {
+		for (uint32_t i = 0; i < p_count; i++) {
+			p_task(i);
+		}
+		return;
+	}
+
+	// Called only from the main thread, so there can be only one active task group.
+	parallel_task = &p_task;
+
+	WorkerThreadPool *wtp = WorkerThreadPool::get_singleton();
+	int64_t group_id = wtp->add_group_task(callable_mp(this, &DebugDraw3D::_run_parallel_task), (int32_t)p_count, geometry_fill_threads, true, NAMEOF(DebugDraw3D) " geometry filling");
+	wtp->wait_for_group_task_completion(group_id);
+
+	parallel_task = nullptr;
+}
+
 std::array<Ref<ArrayMesh>, 2> *DebugDraw3D::get_shared_meshes() {
 	LOCK_GUARD(datalock);
 	if (!shared_generated_meshes.size()) {
@@ -436,18 +652,41 @@ DebugDraw3D::ViewportToDebugContainerItem *DebugDraw3D::get_debug_container(cons
 
 	int dgc_depth = !!p_dgcd.no_depth_test;
 
-	if (const auto &cached_world = viewport_to_world_cache.find(p_dgcd.viewport);
-			cached_world != viewport_to_world_cache.end() && cached_world->second->dgcs[dgc_depth]) {
-		return cached_world->second;
+	auto cached_world = viewport_to_world_cache.find(p_dgcd.viewport);
+	if (cached_world != viewport_to_world_cache.end() && cached_world->second.checked_frame == world_cache_frame && cached_world->second.container->dgcs[dgc_depth]) {
+		return cached_world->second.container;
 	}
 
 	Ref<World3D> vp_world = p_dgcd.viewport->find_world_3d();
+	// A Viewport outside the tree may have no World3D
+	if (vp_world.is_null()) {
+		return nullptr;
+	}
 	uint64_t vp_world_id = vp_world->get_instance_id();
 
+	if (cached_world != viewport_to_world_cache.end()) {
+		ViewportToDebugContainerItem *cached = cached_world->second.container;
+		if (cached->world_id == vp_world_id) {
+			cached_world->second.checked_frame = world_cache_frame;
+			if (cached->dgcs[dgc_depth]) {
+				return cached;
+			}
+		} else {
+			// The Viewport now renders another World3D, so its geometry in the old one will never be visible
+			for (auto &dgc : cached->dgcs) {
+				if (dgc) {
+					dgc->geometry_pool.remove_viewport(p_dgcd.viewport);
+				}
+			}
+			viewport_to_world_cache.erase(cached_world);
+		}
+	}
+
 	if (const auto &dgc_pair = debug_containers.find(vp_world_id);
 			dgc_pair != debug_containers.end() && dgc_pair->second.dgcs[dgc_depth]) {
 
-		viewport_to_world_cache[p_dgcd.viewport] = &dgc_pair->second;
+		_track_viewport(p_dgcd.viewport, p_dgcd.viewport_id);
+		viewport_to_world_cache[p_dgcd.viewport] = { &dgc_pair->second, world_cache_frame };
 		return &dgc_pair->second;
 	}
 
@@ -455,14 +694,12 @@ DebugDraw3D::ViewportToDebugContainerItem *DebugDraw3D::get_debug_container(cons
 		return nullptr;
 	}
 
-	// create or update container storage
+	// create or update container storage.
+	// `debug_containers` is an unordered_map, so the cached pointers to its items remain valid.
 	auto &c = debug_containers[vp_world_id];
 
 	// on new storage created
 	if (!c.world_watcher) {
-		// remove cached references to avoid crashes in case of invalidation of `debug_containers`
-		viewport_to_world_cache.clear();
-
 		// _DD3D_WorldWatcher has to be cleared by the SceenTree or manually in case of an error.
 		c.world_watcher = memnew(_DD3D_WorldWatcher(this, vp_world_id));
 		Node *scene_root = root_node->get_current_scene();
@@ -475,8 +712,10 @@ DebugDraw3D::ViewportToDebugContainerItem *DebugDraw3D::get_debug_container(cons
 	c.dgcs[dgc_depth]->set_world(vp_world);
 
 	c.ncs[dgc_depth] = std::make_unique<NodesContainer>(this, c.world_watcher, p_dgcd.no_depth_test);
+	c.ncs[dgc_depth]->set_world(vp_world);
 
-	viewport_to_world_cache[p_dgcd.viewport] = &c;
+	_track_viewport(p_dgcd.viewport, p_dgcd.viewport_id);
+	viewport_to_world_cache[p_dgcd.viewport] = { &c, world_cache_frame };
 
 	return &c;
 }
@@ -552,11 +791,116 @@ void DebugDraw3D::_remove_debug_container(const uint64_t &p_world_id) {
 	if (const auto &dgc = debug_containers.find(p_world_id);
 			dgc != debug_containers.end()) {
 		DEV_PRINT_STD_F(NAMEOF(_DD3D_WorldWatcher) " (remove): World3D (%" PRIu64 ") is no longer in use, its storage will be deleted.\n", p_world_id);
+		ViewportToDebugContainerItem *removed = &dgc->second;
+		for (auto it = viewport_to_world_cache.begin(); it != viewport_to_world_cache.end();) {
+			if (it->second.container == removed) {
+				it = viewport_to_world_cache.erase(it);
+			} else {
+				it++;
+			}
+		}
+
 		debug_containers.erase(dgc);
+	}
+}
+
+void DebugDraw3D::_track_viewport(Viewport *p_vp, uint64_t p_vp_id) {
+	if (tracked_viewports.find(p_vp_id) != tracked_viewports.end())
+		return;
+
+	ZoneScoped;
+	tracked_viewports[p_vp_id] = p_vp;
+	p_vp->connect("tree_exiting", callable_mp(this, &DebugDraw3D::_on_viewport_tree_exiting).bind(p_vp_id), CONNECT_ONE_SHOT);
+}
+
+void DebugDraw3D::_on_viewport_tree_exiting(uint64_t p_vp_id) {
+	ZoneScoped;
+	LOCK_GUARD(datalock);
+
+	const auto &it = tracked_viewports.find(p_vp_id);
+	if (it == tracked_viewports.end())
+		return;
+
+	Viewport *vp = it->second;
+	tracked_viewports.erase(it);
+	viewport_to_world_cache.erase(vp);
 
-		// remove cached references to avoid crashes in case of invalidation of `debug_containers`
-		viewport_to_world_cache.clear();
+	// The Viewport can be only reparented, so its geometry is dropped later if it is deleted
+	exited_viewports.push_back({ p_vp_id, vp });
+}
+
+void DebugDraw3D::_remove_deleted_viewports() {
+	if (exited_viewports.empty())
+		return;
+
+	ZoneScoped;
+	for (auto it = exited_viewports.begin(); it != exited_viewports.end();) {
+		if (UtilityFunctions::is_instance_id_valid(it->first)) {
+			// Track it again to know when it is deleted
+			if (it->second->is_inside_tree()) {
+				_track_viewport(it->second, it->first);
+				it = exited_viewports.erase(it);
+			} else {
+				it++;
+			}
+			continue;
+		}
+
+		tracked_viewports.erase(it->first);
+		for (auto &p : debug_containers) {
+			for (auto &dgc : p.second.dgcs) {
+				if (dgc) {
+					dgc->geometry_pool.remove_viewport(it->second);
+				}
+			}
+		}
+		it = exited_viewports.erase(it);
+	}
+}
+
+void DebugDraw3D::_untrack_viewports() {
+	ZoneScoped;
+	for (const auto &p : tracked_viewports) {
+		if (Object *vp = ObjectDB::get_instance(p.first); vp) {
+			Callable c = callable_mp(this, &DebugDraw3D::_on_viewport_tree_exiting).bind(p.first);
+			if (vp->is_connected("tree_exiting", c)) {
+				vp->disconnect("tree_exiting", c);
+			}
+		}
 	}
+	tracked_viewports.clear();
+	exited_viewports.clear();
+	viewport_to_world_cache.clear();
+}
+
+void DebugDraw3D::_track_font(const Ref<Font> &p_font) {
+	uint64_t id = p_font->get_instance_id();
+	if (tracked_fonts.find(id) != tracked_fonts.end())
+		return;
+
+	ZoneScoped;
+	tracked_fonts.insert(id);
+	// Emitted when the font cache is cleared or the font settings are changed, so the glyph textures and UVs may be different
+	p_font->connect("changed", callable_mp(this, &DebugDraw3D::_on_font_changed));
+}
+
+void DebugDraw3D::_on_font_changed() {
+	ZoneScoped;
+	LOCK_GUARD(datalock);
+	fonts_generation++;
+}
+
+void DebugDraw3D::_untrack_fonts() {
+	ZoneScoped;
+	Callable c = callable_mp(this, &DebugDraw3D::_on_font_changed);
+	for (const uint64_t &id : tracked_fonts) {
+		if (Object *font = ObjectDB::get_instance(id); font) {
+			if (font->is_connected("changed", c)) {
+				font->disconnect("changed", c);
+			}
+		}
+	}
+	tracked_fonts.clear();
 }
 
 #endif
@@ -564,23 +908,23 @@ void DebugDraw3D::_remove_debug_container(const uint64_t &p_world_id) {
 Ref<DebugDraw3DScopeConfig> DebugDraw3D::new_scoped_config() {
 	ZoneScoped;
 #ifndef DISABLE_DEBUG_RENDERING
-	LOCK_GUARD(datalock);
-	static std::atomic<uint64_t> create_counter = 0;
-	create_counter++;
+	uint64_t guard_id = ++scoped_configs_guards_counter;
 
-	uint64_t thread = OS::get_singleton()->get_thread_caller_id();
-	auto unreg_func = [this](const uint64_t &p_thread_id, const uint64_t &p_guard_id) {
-		_unregister_scoped_config(p_thread_id, p_guard_id);
+	// Configs are identified by their thread's stack instead of the OS thread id
+	uint64_t stack_id = get_thread_scoped_config_stack(true)->id;
+	auto unreg_func = [](const uint64_t &p_thread_id, const uint64_t &p_guard_id) {
+		if (DebugDraw3D *dd = get_singleton()) {
+			dd->_unregister_scoped_config(p_thread_id, p_guard_id);
+		}
 	};
 	Ref<DebugDraw3DScopeConfig> res(memnew(
 			DebugDraw3DScopeConfig(
-					thread,
-					create_counter,
+					stack_id,
+					guard_id,
 					scoped_config_for_current_thread(),
 					unreg_func)));
 
-	_register_scoped_config(thread, create_counter, res.ptr());
-	created_scoped_configs++;
+	_register_scoped_config(stack_id, guard_id, res.ptr());
 	return res;
 #else
 	return default_scoped_config;
@@ -636,6 +980,7 @@ void DebugDraw3D::_load_materials() {
 		LOAD_SHADER(mesh_shaders[(int)MeshMaterialType::Billboard][variant], prefix + DD3DResources::src_resources_billboard_unshaded_gdshader);
 		LOAD_SHADER(mesh_shaders[(int)MeshMaterialType::Plane][variant], prefix + DD3DResources::src_resources_plane_unshaded_gdshader);
 		LOAD_SHADER(mesh_shaders[(int)MeshMaterialType::Extendable][variant], prefix + DD3DResources::src_resources_extendable_meshes_gdshader);
+		LOAD_SHADER(mesh_shaders[(int)MeshMaterialType::Text][variant], prefix + DD3DResources::src_resources_text_glyphs_unshaded_gdshader);
 	}
 #undef LOAD_SHADER
 #endif
@@ -714,6 +1059,8 @@ Ref<DebugDraw3DStats> DebugDraw3D::get_render_stats() {
 		}
 	}
 
+	// The node containers do not overwrite the geometry stats
+	stats_3d.instantiate();
 	for (const auto &p : debug_containers) {
 		for (const auto &nc : p.second.ncs) {
 			if (nc) {
@@ -724,6 +1071,7 @@ Ref<DebugDraw3DStats> DebugDraw3D::get_render_stats() {
 	}
 
 	res->set_scoped_config_stats(scoped_stats_3d.created, scoped_stats_3d.orphans);
+	res->set_threading_stats(threading_stats_3d.lock_contentions, threading_stats_3d.deferred_commands, threading_stats_3d.thread_buffers);
 #endif
 	return res;
 }
@@ -797,7 +1145,12 @@ void DebugDraw3D::clear_all() {
 	}
 
 	debug_containers.clear();
-	viewport_to_world_cache.clear();
+	_untrack_viewports();
+	_untrack_fonts();
+
+	for (auto &b : thread_command_buffers) {
+		b->commands.consume([](DeferredDrawCommand &) {});
+	}
 #else
 	return;
 #endif
@@ -861,39 +1214,315 @@ Vector3 DebugDraw3D::get_up_vector(const Vector3 &p_dir) {
 	return Vector3_UP;
 }
 
-void DebugDraw3D::add_or_update_line_with_thickness(real_t p_exp_time, std::unique_ptr<Vector3[]> p_lines, const size_t p_line_count, const Color &p_col, const std::function<void(DelayedRendererLine *)> p_custom_upd) {
+bool DebugDraw3D::is_main_thread() const {
+	return std::this_thread::get_id() == main_thread_id;
+}
+
+static _FORCE_INLINE_ ProcessType _get_current_process_type() {
+	return Engine::get_singleton()->is_in_physics_frame() ? ProcessType::PHYSICS_PROCESS : ProcessType::PROCESS;
+}
+
+void DebugDraw3D::capture_deferred_scope(DeferredDrawCommand &p_cmd) {
+	p_cmd.proc = _get_current_process_type();
+
+	// The scoped configs are stored per thread, so no lock is needed here
+	auto scfg = scoped_config_for_current_thread();
+	p_cmd.thickness = scfg->thickness;
+	p_cmd.center_brightness = scfg->center_brightness;
+	p_cmd.hd_sphere = scfg->hd_sphere;
+	p_cmd.plane_size = scfg->plane_size;
+	p_cmd.dcd = scfg->dcd;
+}
+
+void DebugDraw3D::push_deferred_command(DeferredDrawCommand &p_cmd) {
 	ZoneScoped;
+	capture_deferred_scope(p_cmd);
+
+	get_thread_command_buffer()->commands.push(std::move(p_cmd));
+	deferred_draw_commands++;
+}
+
+void DebugDraw3D::push_deferred_instance(DeferredDrawCommand::Type p_type, char p_instance_type, const real_t &p_exp_time, const Transform3D &p_transform, const Color &p_col, const SphereBounds &p_bounds, const Color *p_custom_col) {
+	DeferredDrawCommand cmd;
+	cmd.type = p_type;
+	cmd.instance_type = p_instance_type;
+	cmd.exp_time = p_exp_time;
+	cmd.transform = p_transform;
+	cmd.color = p_col;
+	cmd.bounds = p_bounds;
+	if (p_custom_col) {
+		cmd.has_custom_col = true;
+		cmd.custom_col = *p_custom_col;
+	}
 
-	LOCK_GUARD(datalock);
+	push_deferred_command(cmd);
+}
+
+void DebugDraw3D::apply_deferred_command(DebugDraw3DScopeConfig::Data *p_cfg, DeferredDrawCommand &p_cmd) {
+	p_cfg->thickness = p_cmd.thickness;
+	p_cfg->center_brightness = p_cmd.center_brightness;
+	p_cfg->hd_sphere = p_cmd.hd_sphere;
+	p_cfg->plane_size = p_cmd.plane_size;
+	p_cfg->dcd = p_cmd.dcd;
+
+	auto vdc = get_debug_container(p_cfg->dcd, true);
+	if (!vdc) return;
+	auto dgc = vdc->dgcs[!!p_cfg->dcd.no_depth_test].get();
+	if (!dgc) return;
+
+	switch (p_cmd.type) {
+		case DeferredDrawCommand::Type::INSTANCE:
+			dgc->geometry_pool.add_or_update_instance(
+					p_cfg,
+					p_cmd.proc,
+					(InstanceType)p_cmd.instance_type,
+					p_cmd.exp_time,
+					FIX_PRECISION_TRANSFORM(p_cmd.transform),
+					p_cmd.color,
+					p_cmd.bounds,
+					p_cmd.has_custom_col ? &p_cmd.custom_col : nullptr);
+			break;
+		case DeferredDrawCommand::Type::CONVERTABLE_INSTANCE:
+			dgc->geometry_pool.add_or_update_instance(
+					p_cfg,
+					p_cmd.proc,
+					(ConvertableInstanceType)p_cmd.instance_type,
+					p_cmd.exp_time,
+					FIX_PRECISION_TRANSFORM(p_cmd.transform),
+					p_cmd.color,
+					p_cmd.bounds,
+					p_cmd.has_custom_col ? &p_cmd.custom_col : nullptr);
+			break;
+		case DeferredDrawCommand::Type::LINES:
+			add_lines_to_container(dgc, p_cfg, p_cmd.proc, p_cmd.exp_time, p_cmd.lines, p_cmd.lines_count, p_cmd.color);
+			break;
+		case DeferredDrawCommand::Type::PLANE:
+			add_plane_to_container(dgc, p_cfg, p_cmd.proc, p_cmd.exp_time, p_cmd.plane, p_cmd.anchor_point, p_cmd.color);
+			break;
+	}
+}
+
+void DebugDraw3D::add_or_update_instance(ConvertableInstanceType p_type, const real_t &p_exp_time, const Transform3D &p_transform, const Color &p_col, const SphereBounds &p_bounds, const Color *p_custom_col) {
+	ZoneScoped;
+	if (!is_main_thread()) {
+		push_deferred_instance(DeferredDrawCommand::Type::CONVERTABLE_INSTANCE, (char)p_type, p_exp_time, p_transform, p_col, p_bounds, p_custom_col);
+		return;
+	}
+
+	LOCK_GUARD_COUNTED(datalock, draw_lock_contentions);
+	GET_SCOPED_CFG_AND_DGC();
+
+	dgc->geometry_pool.add_or_update_instance(
+			scfg,
+			_get_current_process_type(),
+			p_type,
+			p_exp_time,
+			FIX_PRECISION_TRANSFORM(p_transform),
+			p_col,
+			p_bounds,
+			p_custom_col);
+}
+
+void DebugDraw3D::add_or_update_instance(InstanceType p_type, const real_t &p_exp_time, const Transform3D &p_transform, const Color &p_col, const SphereBounds &p_bounds, const Color *p_custom_col) {
+	ZoneScoped;
+	if (!is_main_thread()) {
+		push_deferred_instance(DeferredDrawCommand::Type::INSTANCE, (char)p_type, p_exp_time, p_transform, p_col, p_bounds, p_custom_col);
+		return;
+	}
+
+	LOCK_GUARD_COUNTED(datalock, draw_lock_contentions);
 	GET_SCOPED_CFG_AND_DGC();
 
-	if (!scfg->thickness) {
-		AABB aabb = MathUtils::calculate_vertex_bounds(p_lines.get(), p_line_count);
+	dgc->geometry_pool.add_or_update_instance(
+			scfg,
+			_get_current_process_type(),
+			p_type,
+			p_exp_time,
+			FIX_PRECISION_TRANSFORM(p_transform),
+			p_col,
+			p_bounds,
+			p_custom_col);
+}
+
+DebugDraw3D::BatchInstance *DebugDraw3D::get_temp_batch_instances(size_t p_count) {
+	thread_local std::vector<BatchInstance> temp_instances;
+	if (temp_instances.size() < p_count) {
+		temp_instances.resize(p_count);
+	}
+	return temp_instances.data();
+}
 
-#if defined(REAL_T_IS_DOUBLE) && defined(FIX_PRECISION_ENABLED)
-		for (size_t l = 0; l < p_line_count; l++) {
-			p_lines[l] -= dgc->get_center_position();
+template <class TInstanceType>
+void DebugDraw3D::add_or_update_instances(TInstanceType p_type, const real_t &p_exp_time, const BatchInstance *p_items, const size_t p_count, const Color *p_custom_col) {
+	ZoneScoped;
+	if (!p_count)
+		return;
+
+	if (!is_main_thread()) {
+		// The scoped config is the same for the whole batch, so it is captured only once.
+		DeferredDrawCommand scope;
+		capture_deferred_scope(scope);
+
+		auto buffer = get_thread_command_buffer();
+		for (size_t i = 0; i < p_count; i++) {
+			DeferredDrawCommand cmd;
+			cmd.type = std::is_same<TInstanceType, InstanceType>::value ? DeferredDrawCommand::Type::INSTANCE : DeferredDrawCommand::Type::CONVERTABLE_INSTANCE;
+			cmd.proc = scope.proc;
+			cmd.instance_type = (char)p_type;
+			cmd.exp_time = p_exp_time;
+			cmd.thickness = scope.thickness;
+			cmd.center_brightness = scope.center_brightness;
+			cmd.hd_sphere = scope.hd_sphere;
+			cmd.dcd = scope.dcd;
+			cmd.transform = p_items[i].transform;
+			cmd.color = p_items[i].color;
+			cmd.bounds = p_items[i].bounds;
+			if (p_custom_col) {
+				cmd.has_custom_col = true;
+				cmd.custom_col = *p_custom_col;
+			}
+			buffer->commands.push(std::move(cmd));
 		}
-#endif
-		dgc->geometry_pool.add_or_update_line(
+		deferred_draw_commands += p_count;
+		return;
+	}
+
+	LOCK_GUARD_COUNTED(datalock, draw_lock_contentions);
+	GET_SCOPED_CFG_AND_DGC();
+
+	ProcessType proc = _get_current_process_type();
+	for (size_t i = 0; i < p_count; i++) {
+		const BatchInstance &item = p_items[i];
+		dgc->geometry_pool.add_or_update_instance(
 				scfg,
+				proc,
+				p_type,
 				p_exp_time,
-				std::move(p_lines),
+				FIX_PRECISION_TRANSFORM(item.transform),
+				item.color,
+				item.bounds,
+				p_custom_col);
+	}
+}
+
+void DebugDraw3D::add_or_update_line_with_thickness(real_t p_exp_time, const Vector3 *p_lines, const size_t p_line_count, const Color &p_col) {
+	ZoneScoped;
+	if (!is_main_thread()) {
+		DeferredDrawCommand cmd;
+		cmd.type = DeferredDrawCommand::Type::LINES;
+		cmd.exp_time = p_exp_time;
+		cmd.color = p_col;
+		// The command outlives the caller's vertices, so it needs its own copy.
+		cmd.lines = get_thread_command_buffer()->lines.push(p_lines, p_line_count, &cmd.lines_chunk);
+		cmd.lines_count = p_line_count;
+
+		push_deferred_command(cmd);
+		return;
+	}
+
+	LOCK_GUARD_COUNTED(datalock, draw_lock_contentions);
+	GET_SCOPED_CFG_AND_DGC();
+
+	add_lines_to_container(dgc, scfg, _get_current_process_type(), p_exp_time, p_lines, p_line_count, p_col);
+}
+
+void DebugDraw3D::add_or_update_lines_by_color(real_t p_exp_time, const Vector3 *p_lines, const BatchInstance *p_items, const size_t p_count) {
+	ZoneScoped;
+
+	// The lines are sorted by the colors of `p_items`, so each color is added as one group
+	thread_local std::vector<uint32_t> order;
+	thread_local std::vector<Vector3> sorted_lines;
+	order.resize(p_count);
+	sorted_lines.resize(p_count * 2);
+	{
+		ZoneScopedN("Sort by color");
+		for (size_t i = 0; i < p_count; i++) {
+			order[i] = (uint32_t)i;
+		}
+		std::stable_sort(order.begin(), order.end(), [p_items](uint32_t a, uint32_t b) {
+			const Color &ca = p_items[a].color;
+			const Color &cb = p_items[b].color;
+			if (ca.r != cb.r)
+				return ca.r < cb.r;
+			if (ca.g != cb.g)
+				return ca.g < cb.g;
+			if (ca.b != cb.b)
+				return ca.b < cb.b;
+			return ca.a < cb.a;
+		});
+		for (size_t i = 0; i < p_count; i++) {
+			sorted_lines[i * 2] = p_lines[order[i] * 2];
+			sorted_lines[i * 2 + 1] = p_lines[order[i] * 2 + 1];
+		}
+	}
+
+	auto for_each_group = [p_items, p_count](const auto &p_func) {
+		size_t begin = 0;
+		for (size_t i = 1; i <= p_count; i++) {
+			const Color &col = p_items[order[begin]].color;
+			if (i == p_count || p_items[order[i]].color != col) {
+				p_func(sorted_lines.data() + begin * 2, (i - begin) * 2, col);
+				begin = i;
+			}
+		}
+	};
+
+	if (!is_main_thread()) {
+		// Only pushes the commands to the buffer of this thread
+		for_each_group([this, p_exp_time](const Vector3 *p_group, size_t p_group_count, const Color &p_col) {
+			add_or_update_line_with_thickness(p_exp_time, p_group, p_group_count, p_col);
+		});
+		return;
+	}
+
+	LOCK_GUARD_COUNTED(datalock, draw_lock_contentions);
+	GET_SCOPED_CFG_AND_DGC();
+
+	const ProcessType proc = _get_current_process_type();
+	for_each_group([this, dgc, scfg, proc, p_exp_time](const Vector3 *p_group, size_t p_group_count, const Color &p_col) {
+		add_lines_to_container(dgc, scfg, proc, p_exp_time, p_group, p_group_count, p_col);
+	});
+}
+
+void DebugDraw3D::add_lines_to_container(DebugGeometryContainer *p_dgc, const DebugDraw3DScopeConfig::Data *p_cfg, const ProcessType &p_proc, real_t p_exp_time, const Vector3 *p_lines, const size_t p_line_count, const Color &p_col) {
+	ZoneScoped;
+
+	if (!p_cfg->thickness) {
+		AABB aabb = MathUtils::calculate_vertex_bounds(p_lines, p_line_count);
+
+		// The bounds are calculated from the original positions, only the stored copy is shifted.
+		[[maybe_unused]] Vector3 *stored_lines = p_dgc->geometry_pool.add_or_update_line(
+				p_cfg,
+				p_proc,
+				p_exp_time,
+				p_lines,
 				p_line_count,
 				p_col,
 				aabb);
+
+#if defined(REAL_T_IS_DOUBLE) && defined(FIX_PRECISION_ENABLED)
+		for (size_t l = 0; l < p_line_count; l++) {
+			stored_lines[l] -= p_dgc->get_center_position();
+		}
+#endif
 	} else {
 		for (int i = 0; i < p_line_count; i += 2) {
 			ZoneScopedN("Convert AB to xf");
-			Vector3 a = p_lines.get()[i];
-			Vector3 diff = p_lines.get()[i + 1] - a;
+			Vector3 a = p_lines[i];
+			Vector3 diff = p_lines[i + 1] - a;
 			real_t len = diff.length();
 			Vector3 center = diff.normalized() * len * .5f;
-			dgc->geometry_pool.add_or_update_instance(
-					scfg,
+
+			Vector3 origin = a;
+#if defined(REAL_T_IS_DOUBLE) && defined(FIX_PRECISION_ENABLED)
+			origin -= p_dgc->get_center_position();
+#endif
+			p_dgc->geometry_pool.add_or_update_instance(
+					p_cfg,
+					p_proc,
 					InstanceType::LINE_VOLUMETRIC,
 					p_exp_time,
-					Transform3D(Basis().looking_at(center, get_up_vector(center)).scaled(VEC3_ONE(len)), FIX_PRECISION_POSITION(a)), // slow
+					Transform3D(Basis().looking_at(center, get_up_vector(center)).scaled(VEC3_ONE(len)), origin), // slow
 					p_col,
 					SphereBounds(a + center, len * .5f));
 		}
@@ -906,14 +1535,10 @@ void DebugDraw3D::draw_sphere_base(const Transform3D &transform, const Color &co
 	ZoneScoped;
 	CHECK_BEFORE_CALL();
 
-	LOCK_GUARD(datalock);
-	GET_SCOPED_CFG_AND_DGC();
-
-	dgc->geometry_pool.add_or_update_instance(
-			scfg,
+	add_or_update_instance(
 			ConvertableInstanceType::SPHERE,
 			duration,
-			FIX_PRECISION_TRANSFORM(transform),
+			transform,
 			IS_DEFAULT_COLOR(color) ? Colors::chartreuse : color,
 			SphereBounds(transform.origin, MathUtils::get_max_basis_length(transform.basis) * 0.5f));
 }
@@ -931,6 +1556,33 @@ void DebugDraw3D::draw_sphere_xf(const Transform3D &transform, const Color &colo
 	draw_sphere_base(transform, color, duration);
 }
 
+void DebugDraw3D::draw_spheres(const PackedVector3Array &positions, const PackedFloat32Array &radii, const PackedColorArray &colors, const real_t &duration) {
+	ZoneScoped;
+	CHECK_BEFORE_CALL();
+
+	int64_t count = positions.size();
+	if (!_is_batch_array_size_valid(radii.size(), count, "radii") || !_is_batch_array_size_valid(colors.size(), count, "colors"))
+		return;
+
+	const Vector3 *p = positions.ptr();
+	const float *r = radii.ptr();
+	const Color *c = colors.ptr();
+	int64_t radii_count = radii.size();
+	int64_t colors_count = colors.size();
+
+	BatchInstance *items = get_temp_batch_instances(count);
+	for (int64_t i = 0; i < count; i++) {
+		real_t radius = radii_count ? r[radii_count == 1 ? 0 : i] : 0.5f;
+		items[i] = {
+			Transform3D(Basis().scaled(VEC3_ONE(radius * 2)), p[i]),
+			_get_batch_color(c, colors_count, i, Colors::chartreuse),
+			SphereBounds(p[i], radius),
+		};
+	}
+
+	add_or_update_instances(ConvertableInstanceType::SPHERE, duration, items, count);
+}
+
 #pragma endregion // Spheres
 #pragma region Cylinders
 
@@ -938,14 +1590,10 @@ void DebugDraw3D::draw_cylinder(const Transform3D &transform, const Color &color
 	ZoneScoped;
 	CHECK_BEFORE_CALL();
 
-	LOCK_GUARD(datalock);
-	GET_SCOPED_CFG_AND_DGC();
-
-	dgc->geometry_pool.add_or_update_instance(
-			scfg,
+	add_or_update_instance(
 			ConvertableInstanceType::CYLINDER,
 			duration,
-			FIX_PRECISION_TRANSFORM(transform),
+			transform,
 			IS_DEFAULT_COLOR(color) ? Colors::forest_green : color,
 			SphereBounds(transform.origin, MathUtils::get_max_basis_length(transform.basis) * MathUtils::CylinderRadiusForSphere));
 }
@@ -961,14 +1609,10 @@ void DebugDraw3D::draw_cylinder_ab(const Vector3 &a, const Vector3 &b, const rea
 	Vector3 up = get_up_vector(half_center);
 	Transform3D t = Transform3D(Basis().looking_at(half_center, up).scaled_local(Vector3(radius, radius, len)), a + half_center);
 
-	LOCK_GUARD(datalock);
-	GET_SCOPED_CFG_AND_DGC();
-
-	dgc->geometry_pool.add_or_update_instance(
-			scfg,
+	add_or_update_instance(
 			ConvertableInstanceType::CYLINDER_AB,
 			duration,
-			FIX_PRECISION_TRANSFORM(t),
+			t,
 			IS_DEFAULT_COLOR(color) ? Colors::forest_green : color,
 			SphereBounds(t.origin, MathUtils::get_max_basis_length(t.basis) * MathUtils::CylinderRadiusForSphere));
 }
@@ -1002,14 +1646,10 @@ void DebugDraw3D::draw_box_ab(const Vector3 &a, const Vector3 &b, const Vector3
 		// copied from draw_box_xf
 		SphereBounds sb(t.origin + half_center_orig, MathUtils::get_max_basis_length(t.basis) * MathUtils::CubeRadiusForSphere);
 
-		LOCK_GUARD(datalock);
-		GET_SCOPED_CFG_AND_DGC();
-
-		dgc->geometry_pool.add_or_update_instance(
-				scfg,
+		add_or_update_instance(
 				ConvertableInstanceType::CUBE,
 				duration,
-				FIX_PRECISION_TRANSFORM(t),
+				t,
 				IS_DEFAULT_COLOR(color) ? Colors::forest_green : color,
 				sb);
 	} else {
@@ -1033,18 +1673,47 @@ void DebugDraw3D::draw_box_xf(const Transform3D &transform, const Color &color,
 		sb.position = transform.origin + (transform.basis[0] + transform.basis[1] + transform.basis[2]) * 0.5f;
 	}
 
-	LOCK_GUARD(datalock);
-	GET_SCOPED_CFG_AND_DGC();
-
-	dgc->geometry_pool.add_or_update_instance(
-			scfg,
+	add_or_update_instance(
 			is_box_centered ? ConvertableInstanceType::CUBE_CENTERED : ConvertableInstanceType::CUBE,
 			duration,
-			FIX_PRECISION_TRANSFORM(transform),
+			transform,
 			IS_DEFAULT_COLOR(color) ? Colors::forest_green : color,
 			sb);
 }
 
+void DebugDraw3D::draw_boxes(const PackedFloat32Array &transforms, const PackedColorArray &colors, const bool &is_box_centered, const real_t &duration) {
+	ZoneScoped;
+	CHECK_BEFORE_CALL();
+
+	if (transforms.size() % 12 != 0) {
+		PRINT_ERROR("The size of the transforms array must be a multiple of 12. " + String::num_int64(transforms.size()) + " is not a multiple of 12.");
+		return;
+	}
+
+	int64_t count = transforms.size() / 12;
+	if (!_is_batch_array_size_valid(colors.size(), count, "colors"))
+		return;
+
+	const float *t = transforms.ptr();
+	const Color *c = colors.ptr();
+	int64_t colors_count = colors.size();
+
+	BatchInstance *items = get_temp_batch_instances(count);
+	for (int64_t i = 0; i < count; i++) {
+		Transform3D xf = _get_batch_transform(t + i * 12);
+
+		// same as in draw_box_xf
+		SphereBounds sb(xf.origin, MathUtils::get_max_basis_length(xf.basis) * MathUtils::CubeRadiusForSphere);
+		if (!is_box_centered) {
+			sb.position = xf.origin + (xf.basis[0] + xf.basis[1] + xf.basis[2]) * 0.5f;
+		}
+
+		items[i] = { xf, _get_batch_color(c, colors_count, i, Colors::forest_green), sb };
+	}
+
+	add_or_update_instances(is_box_centered ? ConvertableInstanceType::CUBE_CENTERED : ConvertableInstanceType::CUBE, duration, items, count);
+}
+
 void DebugDraw3D::draw_aabb(const AABB &aabb, const Color &color, const real_t &duration) {
 	ZoneScoped;
 	CHECK_BEFORE_CALL();
@@ -1069,23 +1738,19 @@ void DebugDraw3D::draw_line_hit(const Vector3 &start, const Vector3 &end, const
 	ZoneScoped;
 	CHECK_BEFORE_CALL();
 
-	LOCK_GUARD(datalock);
 	if (is_hit) {
-		add_or_update_line_with_thickness(duration, std::unique_ptr<Vector3[]>(new Vector3[2]{ start, hit }), 2, IS_DEFAULT_COLOR(hit_color) ? config->get_line_hit_color() : hit_color);
-		add_or_update_line_with_thickness(duration, std::unique_ptr<Vector3[]>(new Vector3[2]{ hit, end }), 2, IS_DEFAULT_COLOR(after_hit_color) ? config->get_line_after_hit_color() : after_hit_color);
-
-		GET_SCOPED_CFG_AND_DGC();
+		add_or_update_line_with_thickness(duration, std::array<Vector3, 2>{ start, hit }.data(), 2, IS_DEFAULT_COLOR(hit_color) ? config->get_line_hit_color() : hit_color);
+		add_or_update_line_with_thickness(duration, std::array<Vector3, 2>{ hit, end }.data(), 2, IS_DEFAULT_COLOR(after_hit_color) ? config->get_line_after_hit_color() : after_hit_color);
 
-		dgc->geometry_pool.add_or_update_instance(
-				scfg,
+		add_or_update_instance(
 				InstanceType::BILLBOARD_SQUARE,
 				duration,
-				Transform3D(Basis().scaled(VEC3_ONE(hit_size)), FIX_PRECISION_POSITION(hit)),
+				Transform3D(Basis().scaled(VEC3_ONE(hit_size)), hit),
 				IS_DEFAULT_COLOR(hit_color) ? config->get_line_hit_color() : hit_color,
 				SphereBounds(hit, MathUtils::CubeRadiusForSphere * hit_size),
 				&Colors::empty_color);
 	} else {
-		add_or_update_line_with_thickness(duration, std::unique_ptr<Vector3[]>(new Vector3[2]{ start, end }), 2, IS_DEFAULT_COLOR(hit_color) ? config->get_line_hit_color() : hit_color);
+		add_or_update_line_with_thickness(duration, std::array<Vector3, 2>{ start, end }.data(), 2, IS_DEFAULT_COLOR(hit_color) ? config->get_line_hit_color() : hit_color);
 	}
 }
 
@@ -1106,7 +1771,7 @@ void DebugDraw3D::draw_line(const Vector3 &a, const Vector3 &b, const Color &col
 	ZoneScoped;
 	CHECK_BEFORE_CALL();
 
-	add_or_update_line_with_thickness(duration, std::unique_ptr<Vector3[]>(new Vector3[2]{ a, b }), 2, IS_DEFAULT_COLOR(color) ? Colors::red : color);
+	add_or_update_line_with_thickness(duration, std::array<Vector3, 2>{ a, b }.data(), 2, IS_DEFAULT_COLOR(color) ? Colors::red : color);
 }
 
 void DebugDraw3D::draw_lines(const PackedVector3Array &lines, const Color &color, const real_t &duration) {
@@ -1118,11 +1783,7 @@ void DebugDraw3D::draw_lines(const PackedVector3Array &lines, const Color &color
 		return;
 	}
 
-	size_t s = lines.size();
-	std::unique_ptr<Vector3[]> l(new Vector3[s]);
-	memcpy(l.get(), lines.ptr(), s * sizeof(Vector3));
-
-	add_or_update_line_with_thickness(duration, std::move(l), s, IS_DEFAULT_COLOR(color) ? Colors::red : color);
+	add_or_update_line_with_thickness(duration, lines.ptr(), lines.size(), IS_DEFAULT_COLOR(color) ? Colors::red : color);
 }
 
 void DebugDraw3D::draw_lines_c(const std::vector<Vector3> &lines, const Color &color, const real_t &duration) {
@@ -1134,18 +1795,14 @@ void DebugDraw3D::draw_lines_c(const std::vector<Vector3> &lines, const Color &c
 		return;
 	}
 
-	size_t s = lines.size();
-	std::unique_ptr<Vector3[]> l(new Vector3[s]);
-	memcpy(l.get(), lines.data(), s * sizeof(Vector3));
-
-	add_or_update_line_with_thickness(duration, std::move(l), s, IS_DEFAULT_COLOR(color) ? Colors::red : color);
+	add_or_update_line_with_thickness(duration, lines.data(), lines.size(), IS_DEFAULT_COLOR(color) ? Colors::red : color);
 }
 
 void DebugDraw3D::draw_ray(const Vector3 &origin, const Vector3 &direction, const real_t &length, const Color &color, const real_t &duration) {
 	ZoneScoped;
 	CHECK_BEFORE_CALL();
 
-	add_or_update_line_with_thickness(duration, std::unique_ptr<Vector3[]>(new Vector3[2]{ origin, origin + direction * length }), 2, IS_DEFAULT_COLOR(color) ? Colors::red : color);
+	add_or_update_line_with_thickness(duration, std::array<Vector3, 2>{ origin, origin + direction * length }.data(), 2, IS_DEFAULT_COLOR(color) ? Colors::red : color);
 }
 
 void DebugDraw3D::draw_line_path(const PackedVector3Array &path, const Color &color, const real_t &duration) {
@@ -1160,10 +1817,10 @@ void DebugDraw3D::draw_line_path(const PackedVector3Array &path, const Color &co
 	}
 
 	size_t s = (path.size() - 1) * 2;
-	std::unique_ptr<Vector3[]> l(new Vector3[s]);
-	GeometryGenerator::CreateLinesFromPathWireframe(path, l.get());
+	Vector3 *l = _get_temp_lines(s);
+	GeometryGenerator::CreateLinesFromPathWireframe(path, l);
 
-	add_or_update_line_with_thickness(duration, std::move(l), s, IS_DEFAULT_COLOR(color) ? Colors::light_green : color);
+	add_or_update_line_with_thickness(duration, l, s, IS_DEFAULT_COLOR(color) ? Colors::light_green : color);
 }
 
 #pragma endregion // Normal
@@ -1179,14 +1836,10 @@ void DebugDraw3D::create_arrow(const Vector3 &p_a, const Vector3 &p_b, const Col
 	Vector3 up = get_up_vector(dir);
 	Transform3D t = Transform3D(Basis().looking_at(dir, up).scaled(VEC3_ONE(size)), p_b);
 
-	GET_SCOPED_CFG_AND_DGC();
-
-	LOCK_GUARD(datalock);
-	dgc->geometry_pool.add_or_update_instance(
-			scfg,
+	add_or_update_instance(
 			ConvertableInstanceType::ARROWHEAD,
 			p_duration,
-			FIX_PRECISION_TRANSFORM(t),
+			t,
 			IS_DEFAULT_COLOR(p_color) ? Colors::light_green : p_color,
 			SphereBounds(t.origin + t.basis.get_column(2) * 0.5f, MathUtils::ArrowRadiusForSphere * size));
 }
@@ -1195,14 +1848,10 @@ void DebugDraw3D::draw_arrowhead(const Transform3D &transform, const Color &colo
 	ZoneScoped;
 	CHECK_BEFORE_CALL();
 
-	LOCK_GUARD(datalock);
-	GET_SCOPED_CFG_AND_DGC();
-
-	dgc->geometry_pool.add_or_update_instance(
-			scfg,
+	add_or_update_instance(
 			ConvertableInstanceType::ARROWHEAD,
 			duration,
-			FIX_PRECISION_TRANSFORM(transform),
+			transform,
 			IS_DEFAULT_COLOR(color) ? Colors::light_green : color,
 			SphereBounds(transform.origin + transform.basis.get_column(2) * 0.5f, MathUtils::ArrowRadiusForSphere * MathUtils::get_max_basis_length(transform.basis)));
 }
@@ -1211,8 +1860,7 @@ void DebugDraw3D::draw_arrow(const Vector3 &a, const Vector3 &b, const Color &co
 	ZoneScoped;
 	CHECK_BEFORE_CALL();
 
-	LOCK_GUARD(datalock);
-	add_or_update_line_with_thickness(duration, std::unique_ptr<Vector3[]>(new Vector3[2]{ a, b }), 2, IS_DEFAULT_COLOR(color) ? Colors::light_green : color);
+	add_or_update_line_with_thickness(duration, std::array<Vector3, 2>{ a, b }.data(), 2, IS_DEFAULT_COLOR(color) ? Colors::light_green : color);
 	create_arrow(a, b, color, arrow_size, is_absolute_size, duration);
 }
 
@@ -1222,16 +1870,58 @@ void DebugDraw3D::draw_arrow_ray(const Vector3 &origin, const Vector3 &direction
 	draw_arrow(origin, origin + direction * length, color, arrow_size, is_absolute_size, duration);
 }
 
+void DebugDraw3D::draw_arrows(const PackedVector3Array &lines, const PackedColorArray &colors, const real_t &arrow_size, const bool &is_absolute_size, const real_t &duration) {
+	ZoneScoped;
+	CHECK_BEFORE_CALL();
+
+	if (lines.size() % 2 != 0) {
+		PRINT_ERROR("The size of the lines array must be even. " + String::num_int64(lines.size()) + " is not even.");
+		return;
+	}
+
+	int64_t count = lines.size() / 2;
+	if (!count || !_is_batch_array_size_valid(colors.size(), count, "colors"))
+		return;
+
+	const Vector3 *l = lines.ptr();
+	const Color *c = colors.ptr();
+	int64_t colors_count = colors.size();
+
+	BatchInstance *items = get_temp_batch_instances(count);
+	for (int64_t i = 0; i < count; i++) {
+		const Vector3 &a = l[i * 2];
+		const Vector3 &b = l[i * 2 + 1];
+
+		// same as in create_arrow
+		Vector3 dir = (b - a);
+		real_t size = (is_absolute_size ? arrow_size : dir.length() * arrow_size) * 2;
+		Transform3D t = Transform3D(Basis().looking_at(dir, get_up_vector(dir)).scaled(VEC3_ONE(size)), b);
+
+		items[i] = {
+			t,
+			_get_batch_color(c, colors_count, i, Colors::light_green),
+			SphereBounds(t.origin + t.basis.get_column(2) * 0.5f, MathUtils::ArrowRadiusForSphere * size),
+		};
+	}
+
+	if (colors_count > 1) {
+		add_or_update_lines_by_color(duration, l, items, count);
+	} else {
+		add_or_update_line_with_thickness(duration, l, lines.size(), _get_batch_color(c, colors_count, 0, Colors::light_green));
+	}
+
+	add_or_update_instances(ConvertableInstanceType::ARROWHEAD, duration, items, count);
+}
+
 void DebugDraw3D::draw_arrow_path(const PackedVector3Array &path, const Color &color, const real_t &arrow_size, const bool &is_absolute_size, const real_t &duration) {
 	ZoneScoped;
 	CHECK_BEFORE_CALL();
 
 	size_t s = (path.size() - 1) * 2;
-	std::unique_ptr<Vector3[]> l(new Vector3[s]);
-	GeometryGenerator::CreateLinesFromPathWireframe(path, l.get());
+	Vector3 *l = _get_temp_lines(s);
+	GeometryGenerator::CreateLinesFromPathWireframe(path, l);
 
-	LOCK_GUARD(datalock);
-	add_or_update_line_with_thickness(duration, std::move(l), s, IS_DEFAULT_COLOR(color) ? Colors::light_green : color);
+	add_or_update_line_with_thickness(duration, l, s, IS_DEFAULT_COLOR(color) ? Colors::light_green : color);
 
 	for (int64_t i = 0; i < path.size() - 1; i++) {
 		create_arrow(path[i], path[i + 1], color, arrow_size, is_absolute_size, duration);
@@ -1245,7 +1935,6 @@ void DebugDraw3D::draw_point_path(const PackedVector3Array &path, const PointTyp
 	ZoneScoped;
 	CHECK_BEFORE_CALL();
 
-	LOCK_GUARD(datalock);
 	draw_points(path, type, size, IS_DEFAULT_COLOR(points_color) ? Colors::red : points_color, duration);
 	draw_line_path(path, IS_DEFAULT_COLOR(lines_color) ? Colors::green : lines_color, duration);
 }
@@ -1259,14 +1948,10 @@ void DebugDraw3D::draw_square(const Vector3 &position, const real_t &size, const
 	ZoneScoped;
 	CHECK_BEFORE_CALL();
 
-	LOCK_GUARD(datalock);
-	GET_SCOPED_CFG_AND_DGC();
-
-	dgc->geometry_pool.add_or_update_instance(
-			scfg,
+	add_or_update_instance(
 			InstanceType::BILLBOARD_SQUARE,
 			duration,
-			Transform3D(Basis().scaled(VEC3_ONE(size)), FIX_PRECISION_POSITION(position)),
+			Transform3D(Basis().scaled(VEC3_ONE(size)), position),
 			IS_DEFAULT_COLOR(color) ? Colors::red : color,
 			SphereBounds(position, MathUtils::CubeRadiusForSphere * size),
 			&Colors::empty_color);
@@ -1278,23 +1963,45 @@ void DebugDraw3D::draw_plane(const Plane &plane, const Color &color, const Vecto
 
 	Color front_color = IS_DEFAULT_COLOR(color) ? Colors::plane_light_sky_blue : color;
 
-	LOCK_GUARD(datalock);
+	if (!is_main_thread()) {
+		DeferredDrawCommand cmd;
+		cmd.type = DeferredDrawCommand::Type::PLANE;
+		cmd.exp_time = duration;
+		cmd.color = front_color;
+		cmd.plane = plane;
+		cmd.anchor_point = anchor_point;
+		push_deferred_command(cmd);
+		return;
+	}
+
+	LOCK_GUARD_COUNTED(datalock, draw_lock_contentions);
 	GET_SCOPED_CFG_AND_DGC();
 
-	Camera3D *cam = scfg->dcd.viewport ? scfg->dcd.viewport->get_camera_3d() : nullptr;
+	add_plane_to_container(dgc, scfg, _get_current_process_type(), duration, plane, anchor_point, front_color);
+}
 
-	Vector3 center_pos = plane.project(anchor_point == Vector3_INF ? (cam ? cam->get_global_position() : Vector3()) : anchor_point);
-	real_t plane_size = scfg->plane_size != INFINITY ? scfg->plane_size : (cam ? (real_t)cam->get_far() : 1000);
+void DebugDraw3D::add_plane_to_container(DebugGeometryContainer *p_dgc, const DebugDraw3DScopeConfig::Data *p_cfg, const ProcessType &p_proc, real_t p_exp_time, const Plane &p_plane, const Vector3 &p_anchor_point, const Color &p_col) {
+	ZoneScoped;
+
+	Camera3D *cam = p_cfg->dcd.viewport ? p_cfg->dcd.viewport->get_camera_3d() : nullptr;
+
+	Vector3 center_pos = p_plane.project(p_anchor_point == Vector3_INF ? (cam ? cam->get_global_position() : Vector3()) : p_anchor_point);
+	real_t plane_size = p_cfg->plane_size != INFINITY ? p_cfg->plane_size : (cam ? (real_t)cam->get_far() : 1000);
 	Transform3D t(Basis(), center_pos);
-	t = t.looking_at(center_pos + plane.normal, get_up_vector(plane.normal)).scaled_local(VEC3_ONE(plane_size));
-	Color custom_col = Color::from_hsv(front_color.get_h(), Math::clamp(front_color.get_s() - 0.25f, 0.f, 1.f), Math::clamp(front_color.get_v() - 0.25f, 0.f, 1.f), front_color.a);
+	t = t.looking_at(center_pos + p_plane.normal, get_up_vector(p_plane.normal)).scaled_local(VEC3_ONE(plane_size));
+	Color custom_col = Color::from_hsv(p_col.get_h(), Math::clamp(p_col.get_s() - 0.25f, 0.f, 1.f), Math::clamp(p_col.get_v() - 0.25f, 0.f, 1.f), p_col.a);
 
-	dgc->geometry_pool.add_or_update_instance(
-			scfg,
+#if defined(REAL_T_IS_DOUBLE) && defined(FIX_PRECISION_ENABLED)
+	t.origin -= p_dgc->get_center_position();
+#endif
+
+	p_dgc->geometry_pool.add_or_update_instance(
+			p_cfg,
+			p_proc,
 			InstanceType::PLANE,
-			duration,
-			FIX_PRECISION_TRANSFORM(t),
-			front_color,
+			p_exp_time,
+			t,
+			p_col,
 			SphereBounds(center_pos, MathUtils::CubeRadiusForSphere * plane_size),
 			&custom_col);
 }
@@ -1303,15 +2010,28 @@ void DebugDraw3D::draw_points(const PackedVector3Array &points, const PointType
 	ZoneScoped;
 	CHECK_BEFORE_CALL();
 
-	LOCK_GUARD(datalock);
-	for (int i = 0; i < points.size(); i++) {
-		switch (type) {
-			case PointType::POINT_TYPE_SQUARE:
-				draw_square(points[i], size, color, duration);
-				break;
-			case PointType::POINT_TYPE_SPHERE:
-				draw_sphere(points[i], size, color, duration);
-				break;
+	int64_t count = points.size();
+	const Vector3 *p = points.ptr();
+	BatchInstance *items = get_temp_batch_instances(count);
+
+	switch (type) {
+		case PointType::POINT_TYPE_SQUARE: {
+			// same as in draw_square
+			Color col = IS_DEFAULT_COLOR(color) ? Colors::red : color;
+			for (int64_t i = 0; i < count; i++) {
+				items[i] = { Transform3D(Basis().scaled(VEC3_ONE(size)), p[i]), col, SphereBounds(p[i], MathUtils::CubeRadiusForSphere * size) };
+			}
+			add_or_update_instances(InstanceType::BILLBOARD_SQUARE, duration, items, count, &Colors::empty_color);
+			break;
+		}
+		case PointType::POINT_TYPE_SPHERE: {
+			// same as in draw_sphere
+			Color col = IS_DEFAULT_COLOR(color) ? Colors::chartreuse : color;
+			for (int64_t i = 0; i < count; i++) {
+				items[i] = { Transform3D(Basis().scaled(VEC3_ONE(size * 2)), p[i]), col, SphereBounds(p[i], size) };
+			}
+			add_or_update_instances(ConvertableInstanceType::SPHERE, duration, items, count);
+			break;
 		}
 	}
 }
@@ -1320,18 +2040,44 @@ void DebugDraw3D::draw_position(const Transform3D &transform, const Color &color
 	ZoneScoped;
 	CHECK_BEFORE_CALL();
 
-	LOCK_GUARD(datalock);
-	GET_SCOPED_CFG_AND_DGC();
-
-	dgc->geometry_pool.add_or_update_instance(
-			scfg,
+	add_or_update_instance(
 			ConvertableInstanceType::POSITION,
 			duration,
-			FIX_PRECISION_TRANSFORM(transform),
+			transform,
 			IS_DEFAULT_COLOR(color) ? Colors::crimson : color,
 			SphereBounds(transform.origin, MathUtils::get_max_basis_length(transform.basis) * MathUtils::AxisRadiusForSphere));
 }
 
+void DebugDraw3D::draw_positions(const PackedFloat32Array &transforms, const PackedColorArray &colors, const real_t &duration) {
+	ZoneScoped;
+	CHECK_BEFORE_CALL();
+
+	if (transforms.size() % 12 != 0) {
+		PRINT_ERROR("The size of the transforms array must be a multiple of 12. " + String::num_int64(transforms.size()) + " is not a multiple of 12.");
+		return;
+	}
+
+	int64_t count = transforms.size() / 12;
+	if (!_is_batch_array_size_valid(colors.size(), count, "colors"))
+		return;
+
+	const float *t = transforms.ptr();
+	const Color *c = colors.ptr();
+	int64_t colors_count = colors.size();
+
+	BatchInstance *items = get_temp_batch_instances(count);
+	for (int64_t i = 0; i < count; i++) {
+		Transform3D xf = _get_batch_transform(t + i * 12);
+		items[i] = {
+			xf,
+			_get_batch_color(c, colors_count, i, Colors::crimson),
+			SphereBounds(xf.origin, MathUtils::get_max_basis_length(xf.basis) * MathUtils::AxisRadiusForSphere),
+		};
+	}
+
+	add_or_update_instances(ConvertableInstanceType::POSITION, duration, items, count);
+}
+
 void DebugDraw3D::draw_gizmo(const Transform3D &transform, const Color &color, const bool &is_centered, const real_t &duration) {
 	ZoneScoped;
 	CHECK_BEFORE_CALL();
@@ -1341,7 +2087,6 @@ void DebugDraw3D::draw_gizmo(const Transform3D &transform, const Color &color, c
 #define MINUS(axis) transform.origin - transform.basis.get_column(axis)
 #define PLUS(axis) transform.origin + transform.basis.get_column(axis)
 
-	LOCK_GUARD(datalock);
 	if (is_centered) {
 		draw_arrow(MINUS(0 /** 0.5f*/), PLUS(0 /** 0.5f*/), COLOR(x), 0.1f, true, duration);
 		draw_arrow(MINUS(1 /** 0.5f*/), PLUS(1 /** 0.5f*/), COLOR(y), 0.1f, true, duration);
@@ -1406,11 +2151,10 @@ void DebugDraw3D::draw_camera_frustum_planes_c(const std::array<Plane, 6> &plane
 	CHECK_BEFORE_CALL();
 
 	size_t s = GeometryGenerator::CubeIndexes.size();
-	std::unique_ptr<Vector3[]> l(new Vector3[s]);
-	GeometryGenerator::CreateCameraFrustumLinesWireframe(planes, l.get());
+	Vector3 *l = _get_temp_lines(s);
+	GeometryGenerator::CreateCameraFrustumLinesWireframe(planes, l);
 
-	LOCK_GUARD(datalock);
-	add_or_update_line_with_thickness(duration, std::move(l), s, IS_DEFAULT_COLOR(color) ? Colors::red : color);
+	add_or_update_line_with_thickness(duration, l, s, IS_DEFAULT_COLOR(color) ? Colors::red : color);
 }
 
 void DebugDraw3D::draw_camera_frustum(const Camera3D *camera, const Color &color, const real_t &duration) {
@@ -1446,6 +2190,14 @@ void DebugDraw3D::draw_text(const Vector3 &position, const String text, const in
 	// LOCK_GUARD(datalock);
 	GET_SCOPED_CFG_AND_NC();
 
+	// Labels for a single frame are not created if they were out of view in the previous frame.
+	// Labels with a duration can come into view later, so they are always created.
+	if (duration <= 0) {
+		auto dgc = vdc->dgcs[!!scfg->dcd.no_depth_test].get();
+		if (dgc && !dgc->is_sphere_visible(position, NodesContainer::get_text_radius(scfg, text, size), config->get_text_max_distance()))
+			return;
+	}
+
 	nc->add_or_update_text(
 			scfg,
 			position,
@@ -1,14 +1,19 @@
 #pragma once
 
+#include "common/append_only_buffer.h"
 #include "common/colors.h"
 #include "common/i_scope_storage.h"
 #include "config_scope_3d.h"
 #include "render_instances_enums.h"
+#include "utils/math_utils.h"
 #include "utils/profiler.h"
 
+#include <atomic>
 #include <map>
 #include <memory>
 #include <mutex>
+#include <thread>
+#include <unordered_set>
 
 GODOT_WARNING_DISABLE()
 #include <godot_cpp/classes/array_mesh.hpp>
@@ -27,7 +32,7 @@ class DebugDraw3DStats;
 #ifndef DISABLE_DEBUG_RENDERING
 class DebugGeometryContainer;
 class NodesContainer;
-struct DelayedRendererLine;
+class TextGlyphsContainer;
 #endif
 
 /// @private
@@ -36,6 +41,7 @@ enum class MeshMaterialType : char {
 	Billboard,
 	Plane,
 	Extendable,
+	Text,
 	MAX,
 };
 
@@ -93,6 +99,7 @@ public:
  * ---
  * @note
  * You can use this class anywhere, including in `_physics_process` and `_process` (and probably from other threads).
+ * Geometry drawn from other threads is stored in per-thread buffers and added to the scene at the end of the frame.
  * It is worth mentioning that physics ticks may not be called every frame or may be called several times in one frame.
  * So if you want to avoid multiple identical `draw_` calls, you can call `draw_` methods in `_process` or use such a check:
  * ```python
@@ -110,6 +117,10 @@ public:
  *
  * ---
  * @note
+ * Geometry with a duration is removed when its Viewport is deleted or switches to another World3D.
+ *
+ * ---
+ * @note
  * Due to the way Godot registers this addon, it is not possible to use the `draw_` methods
  * in the first few frames immediately after the project is launched.
  */
@@ -121,7 +132,9 @@ class DebugDraw3D : public Object, public IScopeStorage<DebugDraw3DScopeConfig,
 #ifndef DISABLE_DEBUG_RENDERING
 	friend DebugGeometryContainer;
 	friend NodesContainer;
+	friend TextGlyphsContainer;
 	friend _DD3D_WorldWatcher;
+	friend DebugDraw3DScope;
 #endif
 
 public:
@@ -150,6 +163,10 @@ private:
 	const static char *s_render_priority;
 	const static char *s_render_mode;
 	const static char *s_render_fog_disabled;
+	const static char *s_geometry_fill_threads;
+#ifdef DEV_ENABLED
+	const static char *s_dev_benchmark_culling;
+#endif
 
 	std::vector<SubViewport *> custom_editor_viewports;
 	DebugDrawManager *root_node = nullptr;
@@ -161,15 +178,33 @@ private:
 
 	struct ScopedPairIdConfig {
 		uint64_t id;
-		DebugDraw3DScopeConfig *scfg;
-		ScopedPairIdConfig(uint64_t id, DebugDraw3DScopeConfig *scfg) :
-				id(id), scfg(scfg) {}
+		const DebugDraw3DScopeConfig::Data *data;
+		// Empty for DebugDraw3DScope, which owns its data
+		std::shared_ptr<DebugDraw3DScopeConfig::Data> owned_data;
+		ScopedPairIdConfig(uint64_t id, const DebugDraw3DScopeConfig::Data *data, const std::shared_ptr<DebugDraw3DScopeConfig::Data> &owned_data) :
+				id(id), data(data), owned_data(owned_data) {}
 	};
-	// stores thread id and array of id's with ptrs
-	std::unordered_map<uint64_t, std::vector<ScopedPairIdConfig> > scoped_configs;
-	// stores thread id and most recent config
-	std::unordered_map<uint64_t, std::shared_ptr<DebugDraw3DScopeConfig::Data> > cached_scoped_configs;
-	uint64_t created_scoped_configs = 0;
+
+	/// Stack of the scoped configs of one thread. Only the owning thread changes `configs`.
+	struct ScopedConfigStack {
+		uint64_t id = 0;
+		uint64_t generation = 0;
+		std::vector<ScopedPairIdConfig> configs;
+		// Read by the main thread to count orphans
+		std::atomic<size_t> configs_count = 0;
+
+		// Configs released by other threads. They are removed by the owning thread.
+		std::atomic<bool> has_pending_removals = false;
+		ProfiledMutex(std::recursive_mutex, pending_removals_lock, "Scoped config removals lock");
+		std::vector<uint64_t> pending_removals;
+	};
+
+	// Stacks are recreated by their threads after each `_clear_scoped_configs`
+	std::atomic<uint64_t> scoped_configs_generation = 0;
+	// Used only to count orphans and to find stacks when a config is released by another thread
+	std::vector<std::shared_ptr<ScopedConfigStack> > scoped_config_stacks;
+	std::atomic<uint64_t> created_scoped_configs = 0;
+	std::atomic<uint64_t> scoped_configs_guards_counter = 0;
 	struct {
 		uint64_t created;
 		uint64_t orphans;
@@ -178,6 +213,67 @@ private:
 	// Inherited via IScopeStorage
 	const DebugDraw3DScopeConfig::Data *scoped_config_for_current_thread() override;
 
+	/// Draw call recorded by a non-main thread. It is merged into the GeometryPool in `process_end`.
+	struct DeferredDrawCommand {
+		enum class Type : char {
+			INSTANCE,
+			CONVERTABLE_INSTANCE,
+			LINES,
+			PLANE,
+		};
+
+		Type type = Type::INSTANCE;
+		ProcessType proc = ProcessType::PROCESS;
+		char instance_type = 0;
+		bool has_custom_col = false;
+		real_t exp_time = 0;
+
+		// Only the part of the scoped config that is used by the GeometryPool
+		real_t thickness = 0;
+		real_t center_brightness = 0;
+		bool hd_sphere = false;
+		real_t plane_size = 0;
+		DebugDraw3DScopeConfig::DebugContainerDependent dcd;
+
+		Transform3D transform;
+		Color color;
+		Color custom_col;
+		SphereBounds bounds;
+
+		// Copy of the vertices in the `lines` arena of the thread buffer
+		const Vector3 *lines = nullptr;
+		AppendOnlyArena<Vector3>::Chunk *lines_chunk = nullptr;
+		size_t lines_count = 0;
+
+		// The camera is read only on the main thread, so the plane is converted to an instance there
+		Plane plane;
+		Vector3 anchor_point;
+	};
+
+	struct ThreadCommandBuffer {
+		AppendOnlyBuffer<DeferredDrawCommand> commands;
+		AppendOnlyArena<Vector3> lines;
+	};
+
+	/// One item of the batch draw calls.
+	struct BatchInstance {
+		Transform3D transform;
+		Color color;
+		SphereBounds bounds;
+	};
+
+	std::thread::id main_thread_id;
+	uint64_t thread_buffers_generation = 0;
+	// Each thread owns its buffer, this array is used only by the main thread to merge commands
+	std::vector<std::shared_ptr<ThreadCommandBuffer> > thread_command_buffers;
+	std::atomic<uint64_t> draw_lock_contentions = 0;
+	std::atomic<uint64_t> deferred_draw_commands = 0;
+	struct {
+		uint64_t lock_contentions;
+		uint64_t deferred_commands;
+		uint64_t thread_buffers;
+	} threading_stats_3d = {};
+
 	// Meshes
 	/// Store meshes shared between many debug containers
 	std::vector<std::array<Ref<ArrayMesh>, (int)MeshMaterialVariant::MAX> > shared_generated_meshes;
@@ -195,8 +291,22 @@ private:
 	};
 
 	std::unordered_map<uint64_t, ViewportToDebugContainerItem> debug_containers;
-	// invalidate on add/remove operations or use ptrs
-	std::unordered_map<const Viewport *, ViewportToDebugContainerItem *> viewport_to_world_cache;
+	struct ViewportWorldCacheItem {
+		ViewportToDebugContainerItem *container;
+		// The World3D of a Viewport can change while it stays in the tree, so it is checked again once per frame
+		uint64_t checked_frame;
+	};
+
+	// Persists between frames. Entries are removed when their Viewport leaves the tree, changes its World3D or their container is removed.
+	std::unordered_map<const Viewport *, ViewportWorldCacheItem> viewport_to_world_cache;
+	uint64_t world_cache_frame = 0;
+	// Viewports with a connected `tree_exiting` signal
+	std::unordered_map<uint64_t, Viewport *> tracked_viewports;
+	// Viewports that left the tree. Their geometry is kept until they are deleted, in case they are only reparented.
+	std::vector<std::pair<uint64_t, Viewport *> > exited_viewports;
+	// Fonts with a connected `changed` signal. The glyph layouts are rebuilt when `fonts_generation` changes.
+	std::unordered_set<uint64_t> tracked_fonts;
+	uint64_t fonts_generation = 0;
 
 	// Default materials and shaders
 	Ref<ShaderMaterial> mesh_shaders[(int)MeshMaterialType::MAX][(int)MeshMaterialVariant::MAX];
@@ -205,19 +315,52 @@ private:
 	void _register_scoped_config(uint64_t p_thread_id, uint64_t p_guard_id, DebugDraw3DScopeConfig *p_cfg) override;
 	void _unregister_scoped_config(uint64_t p_thread_id, uint64_t p_guard_id) override;
 	void _clear_scoped_configs() override;
+	ScopedConfigStack *get_thread_scoped_config_stack(bool p_create);
+	void _push_scoped_config(ScopedConfigStack *p_stack, uint64_t p_guard_id, const DebugDraw3DScopeConfig::Data *p_data, const std::shared_ptr<DebugDraw3DScopeConfig::Data> &p_owned_data);
+	void _push_native_scope(DebugDraw3DScope *p_scope);
+	void _remove_scoped_config_from_stack(ScopedConfigStack *p_stack, uint64_t p_guard_id);
 
 	std::array<Ref<ArrayMesh>, (int)MeshMaterialVariant::MAX> *get_shared_meshes();
 	DebugDraw3D::ViewportToDebugContainerItem *get_debug_container(const DebugDraw3DScopeConfig::DebugContainerDependent &p_dgcd, const bool p_generate_new_container);
 	void _register_viewport_world_deferred(uint64_t /*Node * */ p_node_id, const uint64_t p_world_id, _DD3D_WorldWatcher *watcher);
 	Node *_get_root_world_node(Node *p_scene_root, Viewport *p_vp);
 	void _remove_debug_container(const uint64_t &p_world_id);
+	void _track_viewport(Viewport *p_vp, uint64_t p_vp_id);
+	void _on_viewport_tree_exiting(uint64_t p_vp_id);
+	void _remove_deleted_viewports();
+	void _untrack_viewports();
+	void _track_font(const Ref<Font> &p_font);
+	void _on_font_changed();
+	void _untrack_fonts();
 
 	_FORCE_INLINE_ Vector3 get_up_vector(const Vector3 &p_dir);
-	void add_or_update_line_with_thickness(real_t p_exp_time, std::unique_ptr<Vector3[]> p_lines, const size_t p_line_count, const Color &p_col, const std::function<void(DelayedRendererLine *)> p_custom_upd = nullptr);
+	_FORCE_INLINE_ bool is_main_thread() const;
+	ThreadCommandBuffer *get_thread_command_buffer();
+	void capture_deferred_scope(DeferredDrawCommand &p_cmd);
+	void push_deferred_command(DeferredDrawCommand &p_cmd);
+	void push_deferred_instance(DeferredDrawCommand::Type p_type, char p_instance_type, const real_t &p_exp_time, const Transform3D &p_transform, const Color &p_col, const SphereBounds &p_bounds, const Color *p_custom_col);
+	void merge_thread_command_buffers();
+	void apply_deferred_command(DebugDraw3DScopeConfig::Data *p_cfg, DeferredDrawCommand &p_cmd);
+
+	void add_or_update_instance(ConvertableInstanceType p_type, const real_t &p_exp_time, const Transform3D &p_transform, const Color &p_col, const SphereBounds &p_bounds, const Color *p_custom_col = nullptr);
+	void add_or_update_instance(InstanceType p_type, const real_t &p_exp_time, const Transform3D &p_transform, const Color &p_col, const SphereBounds &p_bounds, const Color *p_custom_col = nullptr);
+	static BatchInstance *get_temp_batch_instances(size_t p_count);
+	template <class TInstanceType>
+	void add_or_update_instances(TInstanceType p_type, const real_t &p_exp_time, const BatchInstance *p_items, const size_t p_count, const Color *p_custom_col = nullptr);
+	void add_or_update_line_with_thickness(real_t p_exp_time, const Vector3 *p_lines, const size_t p_line_count, const Color &p_col);
+	void add_or_update_lines_by_color(real_t p_exp_time, const Vector3 *p_lines, const BatchInstance *p_items, const size_t p_count);
+	void add_lines_to_container(DebugGeometryContainer *p_dgc, const DebugDraw3DScopeConfig::Data *p_cfg, const ProcessType &p_proc, real_t p_exp_time, const Vector3 *p_lines, const size_t p_line_count, const Color &p_col);
+	void add_plane_to_container(DebugGeometryContainer *p_dgc, const DebugDraw3DScopeConfig::Data *p_cfg, const ProcessType &p_proc, real_t p_exp_time, const Plane &p_plane, const Vector3 &p_anchor_point, const Color &p_col);
 	Node *get_root_node();
 
 	void create_arrow(const Vector3 &p_a, const Vector3 &p_b, const Color &p_color, const real_t &p_arrow_size, const bool &p_is_absolute_size, const real_t &p_duration = 0);
 
+	// 0 means filling geometry buffers on the calling thread
+	int geometry_fill_threads = 0;
+	const std::function<void(uint32_t)> *parallel_task = nullptr;
+	void _run_parallel_task(uint32_t p_index);
+	void run_parallel_for(uint32_t p_count, const std::function<void(uint32_t)> &p_task);
+
 #ifdef DEV_ENABLED
 	void _save_generated_meshes();
 #endif
@@ -368,6 +511,18 @@ public:
 	 */
 	void draw_sphere_xf(const Transform3D &transform, const Color &color = Colors::empty_color, const real_t &duration = 0) FAKE_FUNC_IMPL;
 
+	/**
+	 * Draw many spheres in one call, as in DebugDraw3D.draw_sphere.
+	 *
+	 * It is much faster than calling DebugDraw3D.draw_sphere in a loop.
+	 *
+	 * @param positions Centers of the spheres
+	 * @param radii Radius of each sphere, a single radius for all spheres or an empty array to use a radius of 0.5
+	 * @param colors Color of each sphere, a single color for all spheres or an empty array to use the default color
+	 * @param duration The duration of how long the objects will be visible
+	 */
+	void draw_spheres(const PackedVector3Array &positions, const PackedFloat32Array &radii = PackedFloat32Array(), const PackedColorArray &colors = PackedColorArray(), const real_t &duration = 0) FAKE_FUNC_IMPL;
+
 #pragma endregion // Spheres
 
 #pragma region Cylinders
@@ -442,6 +597,18 @@ public:
 	 */
 	void draw_box_xf(const Transform3D &transform, const Color &color = Colors::empty_color, const bool &is_box_centered = true, const real_t &duration = 0) FAKE_FUNC_IMPL;
 
+	/**
+	 * Draw many boxes in one call, as in DebugDraw3D.draw_box_xf.
+	 *
+	 * It is much faster than calling DebugDraw3D.draw_box_xf in a loop.
+	 *
+	 * @param transforms 12 floats per box in the same order as in MultiMesh.buffer: `basis.x.x, basis.y.x, basis.z.x, origin.x, basis.x.y, ...`
+	 * @param colors Color of each box, a single color for all boxes or an empty array to use the default color
+	 * @param is_box_centered Set where the center of the boxes will be. In the center or in the bottom corner
+	 * @param duration The duration of how long the objects will be visible
+	 */
+	void draw_boxes(const PackedFloat32Array &transforms, const PackedColorArray &colors = PackedColorArray(), const bool &is_box_centered = true, const real_t &duration = 0) FAKE_FUNC_IMPL;
+
 	/**
 	 * Draw a box as in DebugDraw3D.draw_box, but based on the AABB
 	 *
@@ -594,6 +761,19 @@ public:
 	 */
 	void draw_arrow_ray(const Vector3 &origin, const Vector3 &direction, const real_t &length, const Color &color = Colors::empty_color, const real_t &arrow_size = 0.5f, const bool &is_absolute_size = false, const real_t &duration = 0) FAKE_FUNC_IMPL;
 
+	/**
+	 * Draw many arrows in one call, as in DebugDraw3D.draw_arrow.
+	 *
+	 * It is much faster than calling DebugDraw3D.draw_arrow in a loop.
+	 *
+	 * @param lines Pairs of points, as in DebugDraw3D.draw_lines. The first point of each pair is the start and the second is the end of the arrow
+	 * @param colors Color of each arrow, a single color for all arrows or an empty array to use the default color
+	 * @param arrow_size Size of the arrows
+	 * @param is_absolute_size Is `arrow_size` absolute or relative to the length of each arrow?
+	 * @param duration The duration of how long the objects will be visible
+	 */
+	void draw_arrows(const PackedVector3Array &lines, const PackedColorArray &colors = PackedColorArray(), const real_t &arrow_size = 0.5f, const bool &is_absolute_size = false, const real_t &duration = 0) FAKE_FUNC_IMPL;
+
 	/**
 	 * Draw a sequence of points connected by lines with arrows like DebugDraw3D.draw_line_path.
 	 *
@@ -679,6 +859,17 @@ public:
 	 */
 	void draw_position(const Transform3D &transform, const Color &color = Colors::empty_color, const real_t &duration = 0) FAKE_FUNC_IMPL;
 
+	/**
+	 * Draw many positions in one call, as in DebugDraw3D.draw_position.
+	 *
+	 * It is much faster than calling DebugDraw3D.draw_position in a loop.
+	 *
+	 * @param transforms 12 floats per position in the same order as in MultiMesh.buffer: `basis.x.x, basis.y.x, basis.z.x, origin.x, basis.x.y, ...`
+	 * @param colors Color of each position, a single color for all positions or an empty array to use the default color
+	 * @param duration The duration of how long the objects will be visible
+	 */
+	void draw_positions(const PackedFloat32Array &transforms, const PackedColorArray &colors = PackedColorArray(), const real_t &duration = 0) FAKE_FUNC_IMPL;
+
 	/**
 	 * Draw 3 lines with the given transformations and arrows at the ends
 	 *
@@ -755,6 +946,10 @@ public:
 	 * Outline can be changed using DebugDraw3DScopeConfig.set_text_outline_color and DebugDraw3DScopeConfig.set_text_outline_size.
 	 * And the font can be changed using DebugDraw3DScopeConfig.set_text_font.
 	 *
+	 * @note
+	 * Text with zero duration is skipped if it was outside the camera frustums in the previous frame
+	 * or farther than DebugDraw3DConfig.set_text_max_distance.
+	 *
 	 * ![](docs/images/classes/DrawText.webp)
 	 *
 	 * @param position Center position of Label
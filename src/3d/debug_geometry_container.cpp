@@ -13,6 +13,7 @@ GODOT_WARNING_DISABLE()
 #include <godot_cpp/classes/camera3d.hpp>
 #include <godot_cpp/classes/mesh.hpp>
 #include <godot_cpp/classes/world3d.hpp>
+#include <godot_cpp/classes/xr_camera3d.hpp>
 GODOT_WARNING_RESTORE()
 using namespace godot;
 
@@ -151,15 +152,15 @@ void DebugGeometryContainer::update_center_positions() {
 	Vector3 pos_diff = center_position - new_center_position;
 	center_position = new_center_position;
 
-	geometry_pool.for_each_instance([&pos_diff](DelayedRendererInstance *i) {
-		i->data.origin_x += (float)pos_diff.x;
-		i->data.origin_y += (float)pos_diff.y;
-		i->data.origin_z += (float)pos_diff.z;
+	geometry_pool.for_each_instance([&pos_diff](const DelayedRenderer &, const AABBMinMax &, GeometryPoolData3DInstance &i) {
+		i.origin_x += (float)pos_diff.x;
+		i.origin_y += (float)pos_diff.y;
+		i.origin_z += (float)pos_diff.z;
 	});
 
-	geometry_pool.for_each_line([&pos_diff](DelayedRendererLine *i) {
-		for (size_t l = 0; l < i->lines_count; l++) {
-			i->lines[l] += pos_diff;
+	geometry_pool.for_each_line([&pos_diff](const DelayedRenderer &, const AABBMinMax &, DelayedRendererLine &i) {
+		for (size_t l = 0; l < i.lines_count; l++) {
+			i.lines[l] += pos_diff;
 		}
 	});
 
@@ -173,6 +174,87 @@ void DebugGeometryContainer::update_center_positions() {
 }
 #endif
 
+const DebugGeometryContainer::CachedCameraFrustum &DebugGeometryContainer::get_camera_frustum(Camera3D *p_camera) {
+	ZoneScoped;
+	CachedCameraFrustum &c = camera_frustums[p_camera->get_instance_id()];
+	c.last_used_frame = camera_frustums_frame;
+
+	const real_t length_scale = owner->get_config()->get_frustum_length_scale();
+
+	// XR cameras have their own projections, so they use the slow path without caching
+	if (Object::cast_to<XRCamera3D>(p_camera)) {
+		Array arr = p_camera->get_frustum();
+		c.is_valid = arr.size() == 6;
+		if (c.is_valid) {
+			for (int i = 0; i < 6; i++)
+				c.planes[i] = (Plane)arr[i];
+
+			MathUtils::scale_frustum_far_plane_distance(c.planes, p_camera->get_camera_transform(), length_scale);
+			auto cube = MathUtils::get_frustum_cube(c.planes);
+			c.bounds = MathUtils::calculate_vertex_bounds(cube.data(), cube.size());
+		}
+		c.camera_xf = p_camera->get_camera_transform();
+		c.projection = -1;
+		return c;
+	}
+
+	const Transform3D camera_xf = p_camera->get_camera_transform();
+	const Vector2 viewport_size = p_camera->get_viewport()->get_visible_rect().size;
+	const Camera3D::ProjectionType projection = p_camera->get_projection();
+	const real_t fov_or_size = projection == Camera3D::PROJECTION_PERSPECTIVE ? p_camera->get_fov() : p_camera->get_size();
+	const Vector2 frustum_offset = projection == Camera3D::PROJECTION_FRUSTUM ? p_camera->get_frustum_offset() : Vector2();
+	const real_t near_dist = p_camera->get_near();
+	const real_t far_dist = p_camera->get_far();
+	const Camera3D::KeepAspect keep_aspect = p_camera->get_keep_aspect_mode();
+
+	if (c.projection == (int)projection &&
+			c.keep_aspect == (int)keep_aspect &&
+			c.fov_or_size == fov_or_size &&
+			c.near_dist == near_dist &&
+			c.far_dist == far_dist &&
+			c.length_scale == length_scale &&
+			c.frustum_offset == frustum_offset &&
+			c.viewport_size == viewport_size &&
+			c.camera_xf == camera_xf) {
+		return c;
+	}
+
+	c.camera_xf = camera_xf;
+	c.viewport_size = viewport_size;
+	c.frustum_offset = frustum_offset;
+	c.fov_or_size = fov_or_size;
+	c.near_dist = near_dist;
+	c.far_dist = far_dist;
+	c.length_scale = length_scale;
+	c.projection = (int)projection;
+	c.keep_aspect = (int)keep_aspect;
+
+	c.is_valid = viewport_size.x > 0 && viewport_size.y > 0;
+	if (!c.is_valid)
+		return c;
+
+	// Same as `Camera3D::get_camera_projection`, which is not available in Godot 4.1
+	Projection proj;
+	switch (projection) {
+		case Camera3D::PROJECTION_PERSPECTIVE:
+			proj.set_perspective(fov_or_size, viewport_size.aspect(), near_dist, far_dist, keep_aspect == Camera3D::KEEP_WIDTH);
+			break;
+		case Camera3D::PROJECTION_ORTHOGONAL:
+			proj.set_orthogonal(fov_or_size, viewport_size.aspect(), near_dist, far_dist, keep_aspect == Camera3D::KEEP_WIDTH);
+			break;
+		case Camera3D::PROJECTION_FRUSTUM:
+			proj.set_frustum(fov_or_size, viewport_size.aspect(), frustum_offset, near_dist, far_dist, keep_aspect == Camera3D::KEEP_WIDTH);
+			break;
+	}
+
+	c.planes = MathUtils::get_projection_planes(proj, camera_xf);
+	MathUtils::scale_frustum_far_plane_distance(c.planes, camera_xf, length_scale);
+
+	auto cube = MathUtils::get_frustum_cube(c.planes);
+	c.bounds = MathUtils::calculate_vertex_bounds(cube.data(), cube.size());
+	return c;
+}
+
 void DebugGeometryContainer::update_geometry(double p_delta) {
 	ZoneScoped;
 	LOCK_GUARD(owner->datalock);
@@ -187,14 +269,10 @@ void DebugGeometryContainer::update_geometry(double p_delta) {
 	if (owner->get_config()->is_freeze_3d_render())
 		return;
 
-	if (immediate_mesh_storage.mesh->get_surface_count()) {
-		ZoneScopedN("Clear lines");
-		immediate_mesh_storage.mesh->clear_surfaces();
-	}
-
 	// Return if nothing to do
 	if (!owner->is_debug_enabled()) {
 		ZoneScopedN("Reset instances");
+		geometry_pool.clear_lines_mesh(immediate_mesh_storage.mesh);
 		for (auto &item : multi_mesh_storage) {
 			if (item.mesh->get_visible_instance_count())
 				item.mesh->set_visible_instance_count(0);
@@ -216,13 +294,15 @@ void DebugGeometryContainer::update_geometry(double p_delta) {
 	std::unordered_map<Viewport *, std::shared_ptr<GeometryPoolCullingData> > culling_data;
 	{
 		ZoneScopedN("Get frustums");
+		last_culling_data.clear();
+		last_camera_positions.clear();
 
 		for (const auto &vp_p : available_viewports) {
 			std::vector<std::array<Plane, 6> > frustum_planes;
 			std::vector<AABBMinMax> frustum_boxes;
 
-			std::vector<std::pair<Array, Camera3D *> > frustum_arrays;
-			frustum_arrays.reserve(1);
+			std::vector<Camera3D *> frustum_cameras;
+			frustum_cameras.reserve(1);
 
 #ifdef DEBUG_ENABLED
 			auto custom_editor_viewports = owner->get_custom_editor_viewports();
@@ -239,7 +319,7 @@ void DebugGeometryContainer::update_geometry(double p_delta) {
 				}
 
 				if (owner->config->is_force_use_camera_from_scene() && cam) {
-					frustum_arrays.push_back({ cam->get_frustum(), cam });
+					frustum_cameras.push_back(cam);
 
 #ifdef FIX_DOUBLE_PRECISION_ERRORS
 					new_center_position = cam->get_global_position();
@@ -250,7 +330,7 @@ void DebugGeometryContainer::update_geometry(double p_delta) {
 						if (evp->get_update_mode() == SubViewport::UpdateMode::UPDATE_ALWAYS) {
 							Camera3D *vp_cam = evp->get_camera_3d();
 							if (vp_cam) {
-								frustum_arrays.push_back({ vp_cam->get_frustum(), vp_cam });
+								frustum_cameras.push_back(vp_cam);
 
 								if (!is_updated) {
 									is_updated = true;
@@ -266,7 +346,7 @@ void DebugGeometryContainer::update_geometry(double p_delta) {
 #endif
 				Camera3D *vp_cam = vp_p->get_camera_3d();
 				if (vp_cam) {
-					frustum_arrays.push_back({ vp_cam->get_frustum(), vp_cam });
+					frustum_cameras.push_back(vp_cam);
 
 #ifdef FIX_DOUBLE_PRECISION_ERRORS
 					new_center_position = vp_cam->get_global_position();
@@ -276,40 +356,43 @@ void DebugGeometryContainer::update_geometry(double p_delta) {
 			}
 #endif
 
-			// Convert Array to vector
-			if (frustum_arrays.size()) {
-				for (auto &pair : frustum_arrays) {
-					Array &arr = pair.first;
-					if (arr.size() == 6) {
-						std::array<Plane, 6> a;
-						for (int i = 0; i < arr.size(); i++)
-							a[i] = (Plane)arr[i];
+			for (Camera3D *cam : frustum_cameras) {
+				const CachedCameraFrustum &frustum = get_camera_frustum(cam);
+				if (!frustum.is_valid)
+					continue;
 
-						MathUtils::scale_frustum_far_plane_distance(a, pair.second->get_global_transform(), owner->get_config()->get_frustum_length_scale());
+				if (owner->get_config()->is_use_frustum_culling())
+					frustum_planes.push_back(frustum.planes);
 
-						if (owner->get_config()->is_use_frustum_culling())
-							frustum_planes.push_back(a);
-
-						auto cube = MathUtils::get_frustum_cube(a);
-						AABB aabb = MathUtils::calculate_vertex_bounds(cube.data(), cube.size());
-						frustum_boxes.push_back(aabb);
+				frustum_boxes.push_back(frustum.bounds);
+				last_camera_positions.push_back(frustum.camera_xf.origin);
 
 #if false
-						// Debug camera bounds
-						{
-							SphereBounds sb = aabb;
-							auto cfg = owner->new_scoped_config()->set_thickness(0.1f)->set_hd_sphere(true); //->set_viewport(vp_p);
-							owner->draw_sphere(sb.position, sb.radius, Colors::crimson);
-							owner->draw_aabb(aabb, Colors::yellow);
-						}
-#endif
-					}
+				// Debug camera bounds
+				{
+					SphereBounds sb = frustum.bounds;
+					auto cfg = owner->new_scoped_config()->set_thickness(0.1f)->set_hd_sphere(true); //->set_viewport(vp_p);
+					owner->draw_sphere(sb.position, sb.radius, Colors::crimson);
+					owner->draw_aabb(frustum.bounds, Colors::yellow);
 				}
+#endif
 			}
 
-			culling_data[vp_p] = std::make_shared<GeometryPoolCullingData>(frustum_planes, frustum_boxes);
+			auto vp_culling_data = std::make_shared<GeometryPoolCullingData>(frustum_planes, frustum_boxes);
+			culling_data[vp_p] = vp_culling_data;
+			last_culling_data.push_back(vp_culling_data);
+		}
+	}
+
+	// Forget the cameras that were not used in this frame
+	for (auto it = camera_frustums.begin(); it != camera_frustums.end();) {
+		if (it->second.last_used_frame != camera_frustums_frame) {
+			it = camera_frustums.erase(it);
+		} else {
+			it++;
 		}
 	}
+	camera_frustums_frame++;
 
 #ifdef FIX_DOUBLE_PRECISION_ERRORS
 	update_center_positions();
@@ -333,10 +416,10 @@ void DebugGeometryContainer::update_geometry(double p_delta) {
 			cfg->thickness = 0;
 
 			std::vector<AABBMinMax> new_instances;
-			geometry_pool.for_each_instance([&new_instances](DelayedRendererInstance *o) {
-				if (!o->is_visible || o->is_expired())
+			geometry_pool.for_each_instance([&new_instances](const DelayedRenderer &s, const AABBMinMax &b, GeometryPoolData3DInstance &) {
+				if (!s.is_visible || s.is_expired())
 					return;
-				new_instances.push_back(o->bounds);
+				new_instances.push_back(b);
 			});
 
 			// Draw custom sphere for 1 frame
@@ -349,6 +432,7 @@ void DebugGeometryContainer::update_geometry(double p_delta) {
 
 				geometry_pool.add_or_update_instance(
 						cfg.get(),
+						ProcessType::PROCESS,
 						InstanceType::SPHERE,
 						0,
 						Transform3D(Basis().scaled(VEC3_ONE(radius) * 2), center),
@@ -357,6 +441,7 @@ void DebugGeometryContainer::update_geometry(double p_delta) {
 
 				geometry_pool.add_or_update_instance(
 						cfg.get(),
+						ProcessType::PROCESS,
 						InstanceType::CUBE_CENTERED,
 						0,
 						Transform3D(Basis().scaled(diag), center),
@@ -364,18 +449,19 @@ void DebugGeometryContainer::update_geometry(double p_delta) {
 						SphereBounds(center, radius));
 			}
 
-			geometry_pool.for_each_line([this, &cfg, &vp, &vp_id](DelayedRendererLine *o) {
-				if (!o->is_visible || o->is_expired())
+			geometry_pool.for_each_line([this, &cfg, &vp, &vp_id](const DelayedRenderer &s, const AABBMinMax &b, DelayedRendererLine &) {
+				if (!s.is_visible || s.is_expired())
 					return;
 
-				Vector3 diag = o->bounds.max - o->bounds.min;
-				Vector3 center = o->bounds.center;
-				real_t radius = o->bounds.radius;
+				Vector3 diag = b.max - b.min;
+				Vector3 center = b.center;
+				real_t radius = b.radius;
 
 				cfg->dcd.viewport = vp;
 				cfg->dcd.viewport_id = vp_id;
 				geometry_pool.add_or_update_instance(
 						cfg.get(),
+						ProcessType::PROCESS,
 						InstanceType::CUBE_CENTERED,
 						0,
 						Transform3D(Basis().scaled(diag), center),
@@ -385,6 +471,7 @@ void DebugGeometryContainer::update_geometry(double p_delta) {
 
 				geometry_pool.add_or_update_instance(
 						cfg.get(),
+						ProcessType::PROCESS,
 						InstanceType::SPHERE,
 						0,
 						Transform3D(Basis().scaled(VEC3_ONE(radius) * 2), center),
@@ -394,17 +481,17 @@ void DebugGeometryContainer::update_geometry(double p_delta) {
 
 			for (const auto &culling_data : culling_data) {
 				for (const auto &frustum : culling_data.second->m_frustums) {
-					size_t s = GeometryGenerator::CubeIndexes.size();
-					std::unique_ptr<Vector3[]> l(new Vector3[s]);
-					GeometryGenerator::CreateCameraFrustumLinesWireframe(frustum, l.get());
+					std::array<Vector3, std::tuple_size<decltype(GeometryGenerator::CubeIndexes)>::value> l;
+					GeometryGenerator::CreateCameraFrustumLinesWireframe(frustum, l.data());
 
 					geometry_pool.add_or_update_line(
 							cfg.get(),
+							ProcessType::PROCESS,
 							0,
-							std::move(l),
-							s,
+							l.data(),
+							l.size(),
 							Colors::red,
-							MathUtils::calculate_vertex_bounds(l.get(), s));
+							MathUtils::calculate_vertex_bounds(l.data(), l.size()));
 				}
 			}
 		}
@@ -416,7 +503,9 @@ void DebugGeometryContainer::update_geometry(double p_delta) {
 	}
 
 	geometry_pool.reset_visible_objects();
-	geometry_pool.fill_mesh_data(meshes, immediate_mesh_storage.mesh, culling_data);
+	geometry_pool.fill_mesh_data(meshes, immediate_mesh_storage.mesh, culling_data, [this](uint32_t p_count, const std::function<void(uint32_t)> &p_task) {
+		owner->run_parallel_for(p_count, p_task);
+	});
 
 	geometry_pool.reset_counter(p_delta, ProcessType::PROCESS);
 
@@ -457,14 +546,44 @@ int32_t DebugGeometryContainer::get_render_layer_mask() const {
 	return render_layers;
 }
 
+bool DebugGeometryContainer::is_sphere_visible(const Vector3 &p_position, const real_t &p_radius, const real_t &p_max_distance) {
+	ZoneScoped;
+	LOCK_GUARD(owner->datalock);
+
+	// Nothing is known about the cameras before the first update
+	if (last_culling_data.empty())
+		return true;
+
+	if (p_max_distance > 0 && last_camera_positions.size()) {
+		const real_t max_dist = p_max_distance + p_radius;
+		bool is_near = false;
+		for (const Vector3 &cam_pos : last_camera_positions) {
+			if (cam_pos.distance_squared_to(p_position) <= max_dist * max_dist) {
+				is_near = true;
+				break;
+			}
+		}
+		if (!is_near)
+			return false;
+	}
+
+	const AABBMinMax bounds = SphereBounds(p_position, p_radius);
+	for (const auto &cd : last_culling_data) {
+		uint8_t is_visible = 0;
+		cd->cull(&bounds, 1, &is_visible);
+		if (is_visible)
+			return true;
+	}
+	return false;
+}
+
 void DebugGeometryContainer::clear_3d_objects() {
 	ZoneScoped;
 	LOCK_GUARD(owner->datalock);
 	for (auto &s : multi_mesh_storage) {
 		s.mesh->set_instance_count(0);
 	}
-	immediate_mesh_storage.mesh->clear_surfaces();
-
+	geometry_pool.clear_lines_mesh(immediate_mesh_storage.mesh);
 	geometry_pool.clear_pool();
 }
 
@@ -5,6 +5,7 @@
 
 GODOT_WARNING_DISABLE()
 #include <godot_cpp/classes/array_mesh.hpp>
+#include <godot_cpp/classes/camera3d.hpp>
 #include <godot_cpp/classes/multi_mesh.hpp>
 #include <godot_cpp/classes/rendering_server.hpp>
 #include <godot_cpp/classes/shader_material.hpp>
@@ -49,11 +50,36 @@ class DebugGeometryContainer {
 	Vector3 new_center_position;
 #endif
 
+	/// Frustum of a camera. It is recalculated only when the camera, its viewport size or the length scale changes.
+	struct CachedCameraFrustum {
+		Transform3D camera_xf;
+		Vector2 viewport_size;
+		Vector2 frustum_offset;
+		real_t fov_or_size = 0;
+		real_t near_dist = 0;
+		real_t far_dist = 0;
+		real_t length_scale = 0;
+		int projection = -1;
+		int keep_aspect = -1;
+
+		std::array<Plane, 6> planes;
+		AABB bounds;
+		bool is_valid = false;
+		uint64_t last_used_frame = 0;
+	};
+	std::unordered_map<uint64_t, CachedCameraFrustum> camera_frustums;
+	uint64_t camera_frustums_frame = 0;
+
+	// Frustums and camera positions of the last update. They are used to cull the text before creating labels.
+	std::vector<std::shared_ptr<GeometryPoolCullingData> > last_culling_data;
+	std::vector<Vector3> last_camera_positions;
+
 	int32_t render_layers = 1;
 	bool is_frame_rendered = false;
 	bool no_depth_test = false;
 
 	void CreateMMI(InstanceType p_type, Ref<ArrayMesh> p_mesh);
+	const CachedCameraFrustum &get_camera_frustum(Camera3D *p_camera);
 
 public:
 	DebugGeometryContainer(class DebugDraw3D *p_owner, bool p_no_depth_test);
@@ -76,6 +102,12 @@ public:
 	void set_render_layer_mask(int32_t p_layers);
 	int32_t get_render_layer_mask() const;
 
+	/**
+	 * Returns true if the sphere was visible to any camera in the last update
+	 * and is not farther than `p_max_distance` from the nearest of them. A zero distance is not checked.
+	 */
+	bool is_sphere_visible(const Vector3 &p_position, const real_t &p_radius, const real_t &p_max_distance);
+
 	void get_render_stats(Ref<DebugDraw3DStats> &p_stats);
 	void clear_3d_objects();
 };
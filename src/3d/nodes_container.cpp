@@ -13,164 +13,168 @@ GODOT_WARNING_DISABLE()
 GODOT_WARNING_RESTORE()
 using namespace godot;
 
+NodesContainer::LabelsPool::RecentBucket *NodesContainer::LabelsPool::_find_bucket(uint64_t p_key) {
+	const size_t mask = recent_index.size() - 1;
+	size_t i = hash_murmur3_one_64(p_key) & mask;
+	while (true) {
+		RecentBucket &b = recent_index[i];
+		if (b.head == -2 || b.key == p_key) {
+			return &b;
+		}
+		i = (i + 1) & mask;
+	}
+}
+
+void NodesContainer::LabelsPool::_add_recent(int32_t p_slot) {
+	const TextNodeItem &item = slots[p_slot];
+	RecentBucket *b = _find_bucket(_make_key(item.opts_hash, item.text_hash));
+	if (b->head == -2) {
+		b->key = _make_key(item.opts_hash, item.text_hash);
+		b->head = -1;
+	}
+	next_recent[p_slot] = b->head;
+	b->head = p_slot;
+}
+
+int32_t NodesContainer::LabelsPool::_create_slot(uint32_t opts_hash, uint32_t text_hash) {
+	TextNodeItem item = owner->_create_text_node_item(opts_hash, text_hash);
+	if (empty_slots.size()) {
+		int32_t idx = empty_slots.back();
+		empty_slots.pop_back();
+		slots[idx] = item;
+		return idx;
+	}
+
+	slots.push_back(item);
+	states.push_back(SLOT_EMPTY);
+	next_recent.push_back(-1);
+	return (int32_t)slots.size() - 1;
+}
+
 NodesContainer::TextNodeItem *NodesContainer::LabelsPool::get(uint32_t opts_hash, uint32_t text_hash) {
 	ZoneScoped;
 
-	if (auto &r = recent[opts_hash][text_hash]; !r.empty()) {
-		ZoneScopedN("Returning first recent node.");
-		used.splice(used.begin(), r, r.begin());
-		return &used.front();
+	if (recent_index.size()) {
+		RecentBucket *b = _find_bucket(_make_key(opts_hash, text_hash));
+		if (b->head >= 0) {
+			ZoneScopedN("Returning first recent node.");
+			int32_t idx = b->head;
+			b->head = next_recent[idx];
+			states[idx] = SLOT_USED;
+			return &slots[idx];
+		}
 	}
 
 	// if no recent same
-	if (!unused.empty()) {
+	if (unused_slots.size()) {
 		ZoneScopedN("Returning first unused node.");
-		used.splice(used.begin(), unused, unused.begin());
-		return &used.front();
+		int32_t idx = unused_slots.back();
+		unused_slots.pop_back();
+		states[idx] = SLOT_USED;
+		return &slots[idx];
 	}
 
 	{
 		ZoneScopedN("Creating");
 
-		// int to_create = Math::clamp((int)delayed.size(), 2, 1024);
-		int to_create = 2;
-		for (int i = 0; i < to_create; i++) {
-			unused.push_front(owner->_create_text_node_item(opts_hash, text_hash));
-		}
-		used.splice(used.begin(), unused, unused.begin());
+		// Create one more node for the next call
+		int32_t extra = _create_slot(opts_hash, text_hash);
+		states[extra] = SLOT_UNUSED;
+		unused_slots.push_back(extra);
+
+		int32_t idx = _create_slot(opts_hash, text_hash);
+		states[idx] = SLOT_USED;
+		return &slots[idx];
 	}
-	return &used.front();
 }
 
 void NodesContainer::LabelsPool::update_unused(double delta, bool is_physics) {
 	ZoneScoped;
 
-	nodes_count = 0;
 	{
-		ZoneScopedN("Delete nodes");
-		size_t destroyed = 0;
-
-		size_t idx = 0;
-		for (auto it = unused.begin(); it != unused.end();) {
-			if (it->unused_time < 0) {
-				// Save at least 32 (+1) nodes
-				if (idx > 32) {
-					DEV_PRINT_STD("Destroyed %s\n", it->node->get_text().utf8().ptr());
-
-					owner->_destroy_text_node_item(*it);
-					it = unused.erase(it);
-					destroyed++;
-				} else {
-					++it;
-				}
-			} else {
-				it->unused_time -= delta;
-				nodes_count++;
-				++it;
-			}
-			idx++;
-		}
-
-		if (destroyed) {
-			DEV_PRINT_STD("Destroyed unused Label3D nodes: %" PRIu64 ". %" PRIu64 " nodes remain.\n", destroyed, unused.size());
+		ZoneScopedN("Reset recent index");
+		size_t capacity = 16;
+		while (capacity < slots.size() * 2) {
+			capacity <<= 1;
 		}
+		recent_index.assign(capacity, { 0, -2 });
 	}
 
-	{
-		ZoneScopedN("Move to unused");
-
-		size_t moved = 0;
-
-		for (auto &r : recent) {
-			for (auto &rt : r.second) {
-				for (auto it = rt.second.begin(); it != rt.second.end();) {
-					if (it->unused_time < 0) {
-						it->unused_time = TIME_UNUSED_LABEL3D_DELETE;
-
-						auto next = std::next(it);
-						unused.splice(unused.begin(), rt.second, it);
-						// DEV_PRINT_STD("Moved %s\n", it->node->get_text().utf8().ptr());
-						it = next;
-						moved++;
-					} else {
-						it->unused_time -= delta;
-						++it;
+	nodes_count = 0;
+	used_count = 0;
+	prev_reshapes = reshapes;
+	reshapes = 0;
+	empty_slots.clear();
+	unused_slots.clear();
+
+	size_t destroyed = 0;
+	size_t unused_idx = 0;
+
+	for (int32_t i = 0; i < (int32_t)slots.size(); i++) {
+		TextNodeItem &item = slots[i];
+
+		switch (states[i]) {
+			case SLOT_EMPTY:
+				empty_slots.push_back(i);
+				continue;
+			case SLOT_UNUSED:
+				if (item.unused_time < 0) {
+					// Save at least 32 (+1) nodes
+					if (unused_idx > 32) {
+						DEV_PRINT_STD("Destroyed %s\n", item.node->get_text().utf8().ptr());
+
+						owner->_destroy_text_node_item(item);
+						item.node = nullptr;
+						item.is_applied = false;
+						item.text = String();
+						item.font.unref();
+						states[i] = SLOT_EMPTY;
+						empty_slots.push_back(i);
+						destroyed++;
+						continue;
 					}
-
-					nodes_count++;
+				} else {
+					item.unused_time -= delta;
 				}
-			}
+				unused_idx++;
+				unused_slots.push_back(i);
+				break;
+			case SLOT_RECENT:
+				if (item.unused_time < 0) {
+					item.unused_time = TIME_UNUSED_LABEL3D_DELETE;
+					states[i] = SLOT_UNUSED;
+					unused_slots.push_back(i);
+				} else {
+					item.unused_time -= delta;
+					_add_recent(i);
+				}
+				break;
+			case SLOT_USED:
+				if (is_physics ? item.is_expired_physics() : item.is_expired()) {
+					ZoneScopedN("Hide");
+					item.node->set_visible(false);
+					states[i] = SLOT_RECENT;
+					_add_recent(i);
+				} else {
+					used_count++;
+					item.update_expiration(delta);
+				}
+				break;
 		}
 
-		if (moved) {
-			// DEV_PRINT_STD("Moved Label3D nodes to unused: %" PRIu64 ".\n", moved);
-		}
+		nodes_count++;
 	}
 
-	{
-		ZoneScopedN("Move to recent");
-
-		used_count = 0;
-		for (auto it = used.begin(); it != used.end();) {
-			if (is_physics ? it->is_expired_physics() : it->is_expired()) {
-				ZoneScopedN("Hide");
-				it->node->set_visible(false);
-
-				auto &rt = recent[it->opts_hash][it->text_hash];
-				auto next = std::next(it);
-				rt.splice(rt.begin(), used, it);
-				it = next;
-			} else {
-				used_count++;
-				it->update_expiration(delta);
-				++it;
-			}
-
-			nodes_count++;
-		}
+	// Trailing empty slots are at the end of `empty_slots`
+	while (slots.size() && states.back() == SLOT_EMPTY) {
+		slots.pop_back();
+		states.pop_back();
+		next_recent.pop_back();
+		empty_slots.pop_back();
 	}
 
-	{
-		ZoneScopedN("Clear empty lists");
-
-		std::vector<uint32_t> keys_to_remove;
-		bool is_something_cleared = false;
-
-		// Clear empty lists for the String hashes
-		for (auto &r : recent) { // each options group
-			for (auto &rt : r.second) { // each text hash
-				if (rt.second.empty()) {
-					keys_to_remove.push_back(rt.first);
-				}
-			}
-
-			if (!keys_to_remove.empty()) {
-				for (auto &k : keys_to_remove) {
-					r.second.erase(k);
-				}
-
-				is_something_cleared = true;
-				// DEV_PRINT_STD("Removed TextNodeItems lists: %" PRIu64 ".\n", keys_to_remove.size());
-			}
-			keys_to_remove.clear();
-		}
-
-		// Clear option groups
-		if (is_something_cleared) {
-			for (auto &r : recent) {
-				if (r.second.empty()) {
-					keys_to_remove.push_back(r.first);
-				}
-			}
-
-			if (!keys_to_remove.empty()) {
-				for (auto &k : keys_to_remove) {
-					recent.erase(k);
-				}
-				// DEV_PRINT_STD("Removed TextNodeItems option groups: %" PRIu64 ".\n", keys_to_remove.size());
-			}
-			keys_to_remove.clear();
-		}
+	if (destroyed) {
+		DEV_PRINT_STD("Destroyed unused Label3D nodes: %" PRIu64 ". %" PRIu64 " nodes remain.\n", destroyed, nodes_count);
 	}
 }
 
@@ -180,12 +184,17 @@ void NodesContainer::LabelsPool::clear_pools() {
 		owner->_destroy_text_node_item(i);
 	});
 
-	recent.clear();
-	unused.clear();
-	used.clear();
+	slots.clear();
+	states.clear();
+	next_recent.clear();
+	empty_slots.clear();
+	unused_slots.clear();
+	recent_index.clear();
 
 	nodes_count = 0;
 	used_count = 0;
+	reshapes = 0;
+	prev_reshapes = 0;
 }
 
 NodesContainer::TextNodeItem NodesContainer::_create_text_node_item(uint32_t opts_hash, uint32_t text_hash) {
@@ -194,6 +203,7 @@ NodesContainer::TextNodeItem NodesContainer::_create_text_node_item(uint32_t opt
 	lbl->set_layer_mask(render_layers);
 	lbl->set_visible(false);
 	lbl->set_draw_flag(Label3D::DrawFlags::FLAG_DISABLE_DEPTH_TEST, no_depth_test);
+	lbl->set_billboard_mode(BaseMaterial3D::BillboardMode::BILLBOARD_ENABLED);
 	root->add_child(lbl);
 	return TextNodeItem(lbl, opts_hash, text_hash);
 }
@@ -205,7 +215,8 @@ void NodesContainer::_destroy_text_node_item(TextNodeItem &item) {
 	DEV_PRINT_STD(NAMEOF(TextNodeItem) "'s Label3D node is destroyed\n");
 }
 
-NodesContainer::NodesContainer(DebugDraw3D *p_owner, Node *p_root, bool p_no_depth_test) {
+NodesContainer::NodesContainer(DebugDraw3D *p_owner, Node *p_root, bool p_no_depth_test) :
+		text_glyphs(p_owner, p_no_depth_test) {
 	for (auto &p : text_pools) {
 		p.owner = this;
 	}
@@ -220,6 +231,11 @@ NodesContainer::~NodesContainer() {
 	for (auto &p : text_pools) {
 		p.clear_pools();
 	}
+	text_glyphs.clear();
+}
+
+void NodesContainer::set_world(Ref<World3D> p_new_world) {
+	text_glyphs.set_world(p_new_world);
 }
 
 void NodesContainer::update_expiration_delta(const double &p_delta, const ProcessType &p_proc) {
@@ -246,6 +262,7 @@ void NodesContainer::update_geometry(double p_delta) {
 	if (!owner->is_debug_enabled()) {
 		ZoneScopedN("Reset Label3Ds");
 		update_unused(p_delta);
+		text_glyphs.update_geometry();
 		return;
 	}
 
@@ -255,6 +272,7 @@ void NodesContainer::update_geometry(double p_delta) {
 	}
 
 	update_unused(p_delta, ProcessType::PROCESS);
+	text_glyphs.update_geometry();
 
 	is_frame_rendered = true;
 }
@@ -279,9 +297,11 @@ void NodesContainer::update_unused(const double &p_delta, const ProcessType &p_p
 	if (p_proc == ProcessType::MAX) {
 		for (int p = 0; p < (int)ProcessType::MAX; p++) {
 			text_pools[p].update_unused(p_delta, p == (int)ProcessType::PHYSICS_PROCESS);
+			text_glyphs.update_expiration(p_delta, (ProcessType)p);
 		}
 	} else {
 		text_pools[(int)p_proc].update_unused(p_delta, p_proc == ProcessType::PHYSICS_PROCESS);
+		text_glyphs.update_expiration(p_delta, p_proc);
 	}
 }
 
@@ -295,6 +315,7 @@ void NodesContainer::set_render_layer_mask(int32_t p_layers) {
 			});
 		}
 
+		text_glyphs.set_render_layer_mask(p_layers);
 		render_layers = p_layers;
 	}
 }
@@ -305,6 +326,12 @@ int32_t NodesContainer::get_render_layer_mask() const {
 
 void NodesContainer::add_or_update_text(const DebugDraw3DScopeConfig::Data *p_cfg, const Vector3 &position, const String text, int size, const Color &color, const real_t &duration) {
 	ZoneScoped;
+	const ProcessType proc = Engine::get_singleton()->is_in_physics_frame() ? ProcessType::PHYSICS_PROCESS : ProcessType::PROCESS;
+
+	// Label3D is still used for the fonts that cannot be drawn as glyph quads
+	if (owner->get_config()->is_use_glyph_atlas_for_text() && text_glyphs.add_or_update_text(p_cfg, position, text, size, color, duration, proc)) {
+		return;
+	}
 
 	uint32_t opts_hash = hash_murmur3_one_32(size);
 	opts_hash = hash_murmur3_one_64((uint64_t)p_cfg->text_font.ptr(), opts_hash);
@@ -317,7 +344,8 @@ void NodesContainer::add_or_update_text(const DebugDraw3DScopeConfig::Data *p_cf
 
 	uint32_t text_hash = text.hash();
 
-	auto *lblit = text_pools[(int)(Engine::get_singleton()->is_in_physics_frame() ? ProcessType::PHYSICS_PROCESS : ProcessType::PROCESS)].get(opts_hash, text_hash);
+	LabelsPool &pool = text_pools[(int)proc];
+	auto *lblit = pool.get(opts_hash, text_hash);
 
 	lblit->expiration_time = duration;
 	lblit->is_used_one_time = false;
@@ -328,13 +356,49 @@ void NodesContainer::add_or_update_text(const DebugDraw3DScopeConfig::Data *p_cf
 	Label3D *lbl3d = lblit->node;
 	lbl3d->set_position(position);
 	lbl3d->set_visible(true);
-	lbl3d->set_text(text);
-	lbl3d->set_font(p_cfg->text_font);
-	lbl3d->set_font_size(size);
-	lbl3d->set_modulate(color);
-	lbl3d->set_outline_modulate(p_cfg->text_outline_color);
-	lbl3d->set_outline_size(p_cfg->text_outline_size);
-	lbl3d->set_billboard_mode(BaseMaterial3D::BillboardMode::BILLBOARD_ENABLED);
+
+	// Each of these setters makes the node shape its text again
+	bool is_reshaped = false;
+	if (!lblit->is_applied || lblit->text != text) {
+		lbl3d->set_text(text);
+		lblit->text = text;
+		is_reshaped = true;
+	}
+	if (!lblit->is_applied || lblit->font != p_cfg->text_font) {
+		lbl3d->set_font(p_cfg->text_font);
+		lblit->font = p_cfg->text_font;
+		is_reshaped = true;
+	}
+	if (!lblit->is_applied || lblit->font_size != size) {
+		lbl3d->set_font_size(size);
+		lblit->font_size = size;
+		is_reshaped = true;
+	}
+	if (!lblit->is_applied || lblit->outline_size != p_cfg->text_outline_size) {
+		lbl3d->set_outline_size(p_cfg->text_outline_size);
+		lblit->outline_size = p_cfg->text_outline_size;
+		is_reshaped = true;
+	}
+
+	if (!lblit->is_applied || lblit->modulate != color) {
+		lbl3d->set_modulate(color);
+		lblit->modulate = color;
+	}
+	if (!lblit->is_applied || lblit->outline_modulate != p_cfg->text_outline_color) {
+		lbl3d->set_outline_modulate(p_cfg->text_outline_color);
+		lblit->outline_modulate = p_cfg->text_outline_color;
+	}
+
+	lblit->is_applied = true;
+	if (is_reshaped) {
+		pool.reshapes++;
+	}
+}
+
+real_t NodesContainer::get_text_radius(const DebugDraw3DScopeConfig::Data *p_cfg, const String &text, int size) {
+	// Same as the default `Label3D.pixel_size`
+	const real_t pixel_size = 0.005f;
+	return (real_t)(text.length() + 1) * (size + p_cfg->text_outline_size * 2) * pixel_size * 0.5f;
 }
 
 void NodesContainer::get_render_stats(Ref<DebugDraw3DStats> &p_stats) const {
@@ -348,7 +412,14 @@ void NodesContainer::get_render_stats(Ref<DebugDraw3DStats> &p_stats) const {
 			/* p_nodes_label3d_visible */ text_pools[p].used_count,
 			/* p_nodes_label3d_visible_physics */ text_pools[py].used_count,
 			/* p_nodes_label3d_exists */ text_pools[p].nodes_count,
-			/* p_nodes_label3d_exists_physics */ text_pools[py].nodes_count);
+			/* p_nodes_label3d_exists_physics */ text_pools[py].nodes_count,
+			/* p_nodes_label3d_reshapes */ text_pools[p].prev_reshapes + text_pools[py].prev_reshapes);
+
+	p_stats->set_glyph_text_stats(
+			/* p_glyph_text_visible */ text_glyphs.get_visible_count(ProcessType::PROCESS),
+			/* p_glyph_text_visible_physics */ text_glyphs.get_visible_count(ProcessType::PHYSICS_PROCESS),
+			/* p_glyph_text_quads */ text_glyphs.get_visible_quads(),
+			/* p_glyph_text_batches */ text_glyphs.get_batches_count());
 }
 
 #endif
\ No newline at end of file
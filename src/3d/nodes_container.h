@@ -3,10 +3,11 @@
 
 #include "config_scope_3d.h"
 #include "render_instances_enums.h"
+#include "text_glyphs_container.h"
 #include "utils/utils.h"
 
 #include <functional>
-#include <list>
+#include <vector>
 
 GODOT_WARNING_DISABLE()
 #include <godot_cpp/classes/label3d.hpp>
@@ -50,6 +51,15 @@ class NodesContainer {
 		uint32_t text_hash;
 		double unused_time;
 
+		// Values applied to the `node`. Setters are called only for the changed values.
+		bool is_applied = false;
+		String text;
+		Ref<Font> font;
+		int font_size = 0;
+		int outline_size = 0;
+		Color modulate;
+		Color outline_modulate;
+
 		TextNodeItem() :
 				DelayedNode(),
 				node(nullptr),
@@ -74,14 +84,46 @@ class NodesContainer {
 		TIME_UNUSED_LABEL3D_DELETE = 5,
 	};
 
+	/// Label3D nodes in dense arrays. Hidden nodes are found by their options and text through an open addressing index.
 	struct LabelsPool {
-		std::unordered_map<uint32_t, std::unordered_map<uint32_t, std::list<TextNodeItem> > > recent;
-		std::list<TextNodeItem> unused;
-		std::list<TextNodeItem> used;
+		enum SlotState : uint8_t {
+			SLOT_EMPTY,
+			SLOT_USED,
+			// Hidden, but waits for the same text and options
+			SLOT_RECENT,
+			// Hidden and can be used for any text
+			SLOT_UNUSED,
+		};
+
+		struct RecentBucket {
+			uint64_t key;
+			// First slot with this key, -1 if there are none left, -2 for empty buckets
+			int32_t head;
+		};
+
+		std::vector<TextNodeItem> slots;
+		std::vector<uint8_t> states;
+		// Next slot with the same key or -1
+		std::vector<int32_t> next_recent;
+		std::vector<int32_t> empty_slots;
+		std::vector<int32_t> unused_slots;
+		// Rebuilt in each `update_unused`
+		std::vector<RecentBucket> recent_index;
 		NodesContainer *owner;
 
 		size_t nodes_count = 0;
 		size_t used_count = 0;
+		// Changes of the text, font, font size or outline size since the last `update_unused`
+		size_t reshapes = 0;
+		size_t prev_reshapes = 0;
+
+		_FORCE_INLINE_ static uint64_t _make_key(uint32_t opts_hash, uint32_t text_hash) {
+			return (uint64_t)opts_hash << 32 | text_hash;
+		}
+
+		RecentBucket *_find_bucket(uint64_t p_key);
+		void _add_recent(int32_t p_slot);
+		int32_t _create_slot(uint32_t opts_hash, uint32_t text_hash);
 
 	public:
 		TextNodeItem *get(uint32_t opts_hash, uint32_t text_hash);
@@ -89,19 +131,11 @@ class NodesContainer {
 		void clear_pools();
 
 		_FORCE_INLINE_ void for_each(std::function<void(TextNodeItem &)> func) {
-			for (auto &r : recent) {
-				for (auto &rt : r.second) {
-					for (auto &i : rt.second) {
-						func(i);
-					}
+			for (size_t i = 0; i < slots.size(); i++) {
+				if (states[i] != SLOT_EMPTY) {
+					func(slots[i]);
 				}
 			}
-			for (auto &i : unused) {
-				func(i);
-			}
-			for (auto &i : used) {
-				func(i);
-			}
 		}
 	};
 
@@ -113,11 +147,14 @@ class NodesContainer {
 	TextNodeItem _create_text_node_item(uint32_t opts_hash, uint32_t text_hash);
 	void _destroy_text_node_item(TextNodeItem &item);
 	LabelsPool text_pools[(int)ProcessType::MAX];
+	TextGlyphsContainer text_glyphs;
 
 public:
 	NodesContainer(class DebugDraw3D *p_owner, Node *p_root, bool p_no_depth_test);
 	~NodesContainer();
 
+	void set_world(Ref<World3D> p_new_world);
+
 	void update_geometry(double p_delta);
 	void update_geometry_physics_start(double p_delta);
 	void update_geometry_physics_end(double p_delta);
@@ -129,6 +166,8 @@ public:
 	int32_t get_render_layer_mask() const;
 
 	void add_or_update_text(const DebugDraw3DScopeConfig::Data *p_cfg, const Vector3 &position, const String text, int size, const Color &color, const real_t &duration);
+	/// Rough radius of the label bounds, assuming that no glyph is wider than the font size.
+	static real_t get_text_radius(const DebugDraw3DScopeConfig::Data *p_cfg, const String &text, int size);
 
 	void get_render_stats(Ref<DebugDraw3DStats> &p_stats) const;
 };
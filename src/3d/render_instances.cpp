@@ -9,294 +9,412 @@ GODOT_WARNING_DISABLE()
 #include <godot_cpp/classes/multi_mesh.hpp>
 GODOT_WARNING_RESTORE()
 
-bool DelayedRenderer::update_visibility(const std::shared_ptr<GeometryPoolCullingData> &p_culling_data) {
-	is_visible = false;
-	for (auto &box : p_culling_data->m_frustum_boxes) {
-		if (box.intersects(bounds)) {
-			goto frustum;
-		}
-	}
-	return is_visible;
-frustum:
-	if (p_culling_data->m_frustums.size()) {
-		for (auto &frustum : p_culling_data->m_frustums) {
-			if (MathUtils::is_bounds_partially_inside_convex_shape(bounds, frustum)) {
-				return is_visible = true;
-			}
-		}
-		return is_visible = false;
-	} else {
-		return is_visible = true;
-	}
-}
-
-DelayedRendererInstance::DelayedRendererInstance() :
-		DelayedRenderer() {
-	DEV_PRINT_STD("New " NAMEOF(DelayedRendererInstance) " created\n");
-}
-
 DelayedRendererLine::DelayedRendererLine() :
-		DelayedRenderer(),
+		lines(nullptr),
 		lines_count(0) {
 	DEV_PRINT_STD("New " NAMEOF(DelayedRendererLine) " created\n");
 }
 
-void GeometryPool::fill_mesh_data(const std::vector<Ref<MultiMesh> *> &p_meshes, Ref<ArrayMesh> p_ig, std::unordered_map<Viewport *, std::shared_ptr<GeometryPoolCullingData> > &p_culling_data) {
-	ZoneScoped;
-	fill_instance_data(p_meshes, p_culling_data);
-	fill_lines_data(p_ig, p_culling_data);
-
-	process_delta_sum = 0;
-	physics_delta_sum = 0;
-}
+constexpr size_t INSTANCE_DATA_FLOAT_COUNT = ((sizeof(float) * 3 /*3 components*/ * 4 /*4 vectors3*/ + sizeof(godot::Color) /*Instance Color*/ + sizeof(godot::Color) /*Custom Data*/) / sizeof(float));
 
-void GeometryPool::fill_instance_data(const std::vector<Ref<MultiMesh> *> &p_meshes, std::unordered_map<Viewport *, std::shared_ptr<GeometryPoolCullingData> > &p_culling_data) {
+void GeometryPool::fill_mesh_data(const std::vector<Ref<MultiMesh> *> &p_meshes, Ref<ArrayMesh> p_ig, std::unordered_map<Viewport *, std::shared_ptr<GeometryPoolCullingData> > &p_culling_data, const ParallelForFunc &p_parallel_for) {
 	ZoneScoped;
 
-	constexpr size_t INSTANCE_DATA_FLOAT_COUNT = ((sizeof(float) * 3 /*3 components*/ * 4 /*4 vectors3*/ + sizeof(godot::Color) /*Instance Color*/ + sizeof(godot::Color) /*Custom Data*/) / sizeof(float));
+	// The tasks must not touch the map, so the culling data is resolved here.
+	fill_viewports.clear();
+	for (auto &vp_pool : pools) {
+		auto info = viewports_info.find(vp_pool.first);
+		fill_viewports.push_back({ vp_pool.second, p_culling_data[vp_pool.first], info != viewports_info.end() ? info->second.id : 0, {} });
+	}
+
+	{
+		ZoneScopedN("Fill tasks");
+		GODOT_STOPWATCH(&time_spent_to_run_fill_tasks);
+
+		// Every InstanceType and the lines are independent of each other.
+		p_parallel_for(FILL_TASKS_COUNT, [this](uint32_t p_task) {
+			GODOT_STOPWATCH(&fill_tasks_time[p_task].total);
+			if (p_task < (uint32_t)InstanceType::MAX) {
+				fill_instance_data((int)p_task);
+			} else {
+				fill_lines_data();
+			}
+		});
+	}
 
 	// reset timers
 	time_spent_to_cull_instances = 0;
 	time_spent_to_fill_buffers_of_instances = 0;
+	time_spent_to_fill_task_max = 0;
+	stat_visible_instances = 0;
 
 	for (int type = 0; type < (int)InstanceType::MAX; type++) {
-		ZoneScopedN("Fill iteration");
-		ZoneValue(type);
 		GODOT_STOPWATCH_ADD(&time_spent_to_fill_buffers_of_instances);
+		update_instance_mesh(type, *p_meshes[type]);
 
-		std::vector<DelayedRendererInstance *> visible_buffer;
-		visible_buffer.reserve(prev_buffer_visible_instance_count[type]);
+		stat_visible_instances += prev_buffer_visible_instance_count[type];
+		stat_visible_by_type[type] = prev_buffer_visible_instance_count[type];
+		time_spent_to_cull_instances += fill_tasks_time[type].culling;
+		time_spent_to_fill_buffers_of_instances += fill_tasks_time[type].total - fill_tasks_time[type].culling;
+	}
 
-		{
-			ZoneScopedN("Update visibility and expiration");
+	stat_visible_by_type[LINES_TASK] = stat_visible_lines;
+	time_spent_to_cull_lines = fill_tasks_time[LINES_TASK].culling;
+	time_spent_to_fill_buffers_of_lines = fill_tasks_time[LINES_TASK].total - fill_tasks_time[LINES_TASK].culling;
+	{
+		GODOT_STOPWATCH_ADD(&time_spent_to_fill_buffers_of_lines);
+		update_lines_mesh(p_ig);
+	}
 
-			for (auto &vp_pool : pools) {
-				GODOT_STOPWATCH_ADD(&time_spent_to_cull_instances);
-				auto &culling_data = p_culling_data[vp_pool.first];
+	for (auto &t : fill_tasks_time) {
+		time_spent_to_fill_task_max = Math::max(time_spent_to_fill_task_max, t.total);
+	}
 
-				for (int proc_i = 0; proc_i < (int)ProcessType::MAX; proc_i++) {
-					auto &itype = vp_pool.second[proc_i].instances[type];
+	process_delta_sum = 0;
+	physics_delta_sum = 0;
+}
 
-					auto &inst_arr = itype.instant;
-					for (int i = 0; i < itype.used_instant; i++) {
-						auto &inst = inst_arr[i];
-						if (inst.update_visibility(culling_data)) {
-							visible_buffer.push_back(&inst);
-						}
-					}
+void GeometryPool::fill_instance_data(int p_type) {
+	ZoneScoped;
+	ZoneValue(p_type);
 
-					itype.used_delayed = 0;
-					if (proc_i == (int)ProcessType::PHYSICS_PROCESS) {
-						for (auto &inst : itype.delayed) {
-							if (!inst.is_expired()) {
-								if (inst.is_used_one_time) {
-									inst.expiration_time -= physics_delta_sum;
-								}
-								inst.is_used_one_time = true;
-								itype.used_delayed++;
-
-								if (inst.update_visibility(culling_data)) {
-									visible_buffer.push_back(&inst);
-								}
-							}
-						}
-					} else {
-						for (auto &inst : itype.delayed) {
-							if (!inst.is_expired()) {
-								inst.expiration_time -= process_delta_sum;
-								inst.is_used_one_time = true;
-								itype.used_delayed++;
-
-								if (inst.update_visibility(culling_data)) {
-									visible_buffer.push_back(&inst);
-								}
-							}
-						}
-					}
-				}
+	auto &timing = fill_tasks_time[p_type];
+	timing.culling = 0;
 
-				stat_visible_instances += visible_buffer.size();
-				prev_buffer_visible_instance_count[type] = visible_buffer.size();
-			}
+	PackedFloat32Array &buffer = temp_instances_buffers[p_type];
+	std::vector<uint8_t> &culling_mask = culling_masks[p_type];
+	size_t capacity = buffer.size() / INSTANCE_DATA_FLOAT_COUNT;
+	size_t last_added = 0;
+
+	{
+		ZoneScopedN("Prepare buffer");
+		ZoneValue(buffer.size());
+
+		if (prev_buffer_visible_instance_count[p_type] > capacity) {
+			ZoneScopedN("Resize buffer (grew)");
+			capacity = prev_buffer_visible_instance_count[p_type];
+			ZoneValue(capacity * INSTANCE_DATA_FLOAT_COUNT);
+			buffer.resize(capacity * INSTANCE_DATA_FLOAT_COUNT);
 		}
+	}
 
-		PackedFloat32Array &buffer = temp_instances_buffers[type];
-		size_t used_buffer_size = visible_buffer.size() * INSTANCE_DATA_FLOAT_COUNT;
+	float *w = buffer.ptrw();
+	// Visible instances are copied straight into the MultiMesh buffer.
+	auto push_visible = [&](const GeometryPoolData3DInstance &p_inst) {
+		if (last_added == capacity) {
+			ZoneScopedN("Resize buffer (grew)");
+			capacity = Math::max(capacity * 2, (size_t)64);
+			ZoneValue(capacity * INSTANCE_DATA_FLOAT_COUNT);
+			buffer.resize(capacity * INSTANCE_DATA_FLOAT_COUNT);
+			w = buffer.ptrw();
+		}
+		memcpy(w + last_added++ * INSTANCE_DATA_FLOAT_COUNT, reinterpret_cast<const float *>(&p_inst), INSTANCE_DATA_FLOAT_COUNT * sizeof(float));
+	};
 
-		{
-			ZoneScopedN("Prepare buffer");
-			ZoneValue(buffer.size());
+	{
+		ZoneScopedN("Update visibility, expiration and fill buffer");
 
-			if ((int64_t)used_buffer_size > buffer.size()) {
-				ZoneScopedN("Resize buffer (grew)");
-				ZoneValue(used_buffer_size);
-				buffer.resize(used_buffer_size);
-			}
+		for (auto &vp_pool : fill_viewports) {
+			const GeometryPoolCullingData *culling_data = vp_pool.culling_data.get();
 
-			// shrink the buffer only if half of it is required.
-			if ((int64_t)used_buffer_size < (int64_t)ceil(buffer.size() * 0.5)) {
-				ZoneScopedN("Resize buffer (shrink)");
-				ZoneValue(used_buffer_size);
-				buffer.resize(used_buffer_size);
-			}
-		}
+			for (int proc_i = 0; proc_i < (int)ProcessType::MAX; proc_i++) {
+				auto &itype = vp_pool.pools[proc_i].instances[p_type];
 
-		size_t last_added = 0;
-		{
-			ZoneScopedN("Fill buffer");
-			ZoneValue(visible_buffer.size());
-			auto w = buffer.ptrw();
+				auto &instant = itype.instant;
+				culling_mask.resize(itype.used_instant);
+				{
+					GODOT_STOPWATCH_ADD(&vp_pool.culling_time[p_type]);
+					culling_data->cull(instant.bounds.data(), itype.used_instant, culling_mask.data());
+				}
 
-			for (auto &inst : visible_buffer) {
-				memcpy(w + last_added++ * INSTANCE_DATA_FLOAT_COUNT, reinterpret_cast<const float *>(&inst->data), INSTANCE_DATA_FLOAT_COUNT * sizeof(float));
-			}
-		}
+				for (size_t i = 0; i < itype.used_instant; i++) {
+					bool is_visible = culling_mask[i];
+					instant.states[i].is_visible = is_visible;
+					if (is_visible) {
+						push_visible(instant.data[i]);
+					}
+				}
 
-		// resize if the buffer size has changed.
-		auto &mesh = *p_meshes[type];
-		int32_t new_inst_count = (int)(buffer.size() / INSTANCE_DATA_FLOAT_COUNT);
-		if (new_inst_count != mesh->get_instance_count()) {
-			ZoneScopedN("Changing amount of instances");
-			ZoneValue(new_inst_count);
-			mesh->set_instance_count(new_inst_count);
-		}
+				auto &delayed = itype.delayed;
+				const bool is_physics = proc_i == (int)ProcessType::PHYSICS_PROCESS;
+				itype.schedule_delayed(is_physics ? physics_delta_sum : process_delta_sum, is_physics);
 
-		// just change the visible instances instead of resizing the entire buffer.
-		{
-			int32_t new_visible_count = (int32_t)used_buffer_size / INSTANCE_DATA_FLOAT_COUNT;
-			ZoneScopedN("Set visible instances");
-			ZoneValue(new_visible_count);
-			mesh->set_visible_instance_count(new_visible_count);
-		}
+				{
+					GODOT_STOPWATCH_ADD(&vp_pool.culling_time[p_type]);
+					itype.cull_delayed(vp_pool.culling_data);
+				}
+
+				for (size_t i : itype.visible_delayed) {
+					push_visible(delayed.data[i]);
+				}
 
-		if (buffer.size()) {
-			ZoneScopedN("Set buffer");
-			mesh->set_buffer(buffer);
+				// Expired objects are still drawn in the frame when their time is up
+				itype.release_expired_delayed();
+			}
+
+			timing.culling += vp_pool.culling_time[p_type];
 		}
+
+		ZoneValue(last_added);
+		prev_buffer_visible_instance_count[p_type] = last_added;
 	}
 
-	time_spent_to_fill_buffers_of_instances -= time_spent_to_cull_instances;
+	// shrink the buffer only if half of it is required.
+	size_t used_buffer_size = last_added * INSTANCE_DATA_FLOAT_COUNT;
+	if ((int64_t)used_buffer_size < (int64_t)ceil(buffer.size() * 0.5)) {
+		ZoneScopedN("Resize buffer (shrink)");
+		ZoneValue(used_buffer_size);
+		buffer.resize(used_buffer_size);
+	}
 }
 
-void GeometryPool::fill_lines_data(Ref<ArrayMesh> p_ig, std::unordered_map<Viewport *, std::shared_ptr<GeometryPoolCullingData> > &p_culling_data) {
+void GeometryPool::update_instance_mesh(int p_type, Ref<MultiMesh> &p_mesh) {
 	ZoneScoped;
+	PackedFloat32Array &buffer = temp_instances_buffers[p_type];
+
+	// resize if the buffer size has changed.
+	int32_t new_inst_count = (int)(buffer.size() / INSTANCE_DATA_FLOAT_COUNT);
+	if (new_inst_count != p_mesh->get_instance_count()) {
+		ZoneScopedN("Changing amount of instances");
+		ZoneValue(new_inst_count);
+		p_mesh->set_instance_count(new_inst_count);
+	}
 
-	uint64_t used_lines = 0;
-	for (auto &vp_pool : pools) {
-		for (auto &proc : vp_pool.second) {
-			used_lines += proc.lines.used_instant;
-			used_lines += proc.lines.delayed.size();
-		}
+	// just change the visible instances instead of resizing the entire buffer.
+	{
+		int32_t new_visible_count = (int32_t)prev_buffer_visible_instance_count[p_type];
+		ZoneScopedN("Set visible instances");
+		ZoneValue(new_visible_count);
+		p_mesh->set_visible_instance_count(new_visible_count);
 	}
 
-	if (used_lines == 0) {
-		return;
+	stat_uploaded_bytes[p_type] = buffer.size() * sizeof(float);
+	if (buffer.size()) {
+		ZoneScopedN("Set buffer");
+		p_mesh->set_buffer(buffer);
 	}
+}
 
-	GODOT_STOPWATCH(&time_spent_to_fill_buffers_of_lines);
+void GeometryPool::fill_lines_data() {
+	ZoneScoped;
 
-	size_t used_vertexes = 0;
+	auto &timing = fill_tasks_time[LINES_TASK];
+	timing.culling = 0;
 
-	PackedVector3Array vertexes;
-	PackedColorArray colors;
+	uint64_t used_lines = 0;
+	for (auto &vp_pool : fill_viewports) {
+		for (int proc_i = 0; proc_i < (int)ProcessType::MAX; proc_i++) {
+			auto &lines = vp_pool.pools[proc_i].lines;
+			used_lines += lines.used_instant;
+			used_lines += lines.delayed.size();
+		}
+	}
 
-	std::vector<DelayedRendererLine *> visible_buffer;
+	size_t used_vertexes = 0;
+	std::vector<uint8_t> &culling_mask = culling_masks[LINES_TASK];
+	std::vector<const DelayedRendererLine *> visible_buffer;
 
-	{
+	if (used_lines) {
 		ZoneScopedN("Prepare buffers");
 		visible_buffer.reserve(prev_buffer_visible_lines_count);
 
 		{
 			ZoneScopedN("Update visibility and expiration");
-			GODOT_STOPWATCH(&time_spent_to_cull_lines);
+			GODOT_STOPWATCH(&timing.culling);
 
 			// pre calculate buffer size
 
-			for (auto &vp_pool : pools) {
-				auto &culling_data = p_culling_data[vp_pool.first];
+			for (auto &vp_pool : fill_viewports) {
+				GODOT_STOPWATCH(&vp_pool.culling_time[LINES_TASK]);
+				const GeometryPoolCullingData *culling_data = vp_pool.culling_data.get();
 
 				for (int proc_i = 0; proc_i < (int)ProcessType::MAX; proc_i++) {
-					auto &proc = vp_pool.second[proc_i];
-
-					for (size_t i = 0; i < proc.lines.used_instant; i++) {
-						auto &o = proc.lines.instant[i];
-						if (o.update_visibility(culling_data)) {
-							o.is_used_one_time = true;
-							used_vertexes += o.lines_count;
-							visible_buffer.push_back(&o);
+					auto &lines = vp_pool.pools[proc_i].lines;
+
+					auto &instant = lines.instant;
+					culling_mask.resize(lines.used_instant);
+					culling_data->cull(instant.bounds.data(), lines.used_instant, culling_mask.data());
+					for (size_t i = 0; i < lines.used_instant; i++) {
+						auto &state = instant.states[i];
+						state.is_visible = culling_mask[i];
+						if (state.is_visible) {
+							state.is_used_one_time = true;
+							used_vertexes += instant.data[i].lines_count;
+							visible_buffer.push_back(&instant.data[i]);
 						}
 					}
 
-					proc.lines.used_delayed = 0;
-					if (proc_i == (int)ProcessType::PHYSICS_PROCESS) {
-						for (auto &o : proc.lines.delayed) {
-							if (!o.is_expired()) {
-								if (o.is_used_one_time) {
-									o.expiration_time -= physics_delta_sum;
-								}
-								o.is_used_one_time = true;
-								proc.lines.used_delayed++;
-
-								if (o.update_visibility(culling_data)) {
-									used_vertexes += o.lines_count;
-									visible_buffer.push_back(&o);
-								}
-							}
-						}
-					} else {
-						for (auto &o : proc.lines.delayed) {
-							if (!o.is_expired()) {
-								o.expiration_time -= process_delta_sum;
-								o.is_used_one_time = true;
-								proc.lines.used_delayed++;
-
-								if (o.update_visibility(culling_data)) {
-									used_vertexes += o.lines_count;
-									visible_buffer.push_back(&o);
-								}
-							}
-						}
+					auto &delayed = lines.delayed;
+					const bool is_physics = proc_i == (int)ProcessType::PHYSICS_PROCESS;
+					lines.schedule_delayed(is_physics ? physics_delta_sum : process_delta_sum, is_physics);
+
+					lines.cull_delayed(vp_pool.culling_data);
+					for (size_t i : lines.visible_delayed) {
+						used_vertexes += delayed.data[i].lines_count;
+						visible_buffer.push_back(&delayed.data[i]);
 					}
+
+					lines.release_expired_delayed();
 				}
 			}
 		}
 
 		stat_visible_lines = visible_buffer.size();
 		prev_buffer_visible_lines_count = visible_buffer.size();
-
 		ZoneValue(used_vertexes);
-		vertexes.resize(used_vertexes);
-		colors.resize(used_vertexes);
 	}
 
-	size_t prev_pos = 0;
-	auto vertexes_write = vertexes.ptrw();
-	auto colors_write = colors.ptrw();
+	auto &lm = lines_mesh;
+	{
+		ZoneScopedN("Update capacity");
+		size_t capacity = lm.colors.size();
+		size_t new_capacity = capacity;
+
+		if (used_vertexes > capacity) {
+			new_capacity = LINES_MESH_MIN_CAPACITY;
+			while (new_capacity < used_vertexes) {
+				new_capacity *= 2;
+			}
+			lm.time_used_less_then_quarter = 0;
+		} else if (capacity > LINES_MESH_MIN_CAPACITY && used_vertexes < capacity / 4) {
+			lm.time_used_less_then_quarter += process_delta_sum;
+			if (lm.time_used_less_then_quarter > TIME_USED_TO_SHRINK_LINES_MESH) {
+				new_capacity = LINES_MESH_MIN_CAPACITY;
+				while (new_capacity < used_vertexes * 2) {
+					new_capacity *= 2;
+				}
+				lm.time_used_less_then_quarter = 0;
+			}
+		} else {
+			lm.time_used_less_then_quarter = 0;
+		}
+
+		if (new_capacity != capacity) {
+			// The mesh will be recreated, so everything needs to be uploaded again.
+			lm.vertexes.assign(new_capacity * 3, 0.f);
+			lm.colors.assign(new_capacity, 0);
+			lm.prev_used_vertexes = 0;
+			lm.dirty_begin = 0;
+			lm.dirty_end = new_capacity;
+		}
+	}
+
+	float *vertexes_write = lm.vertexes.data();
+	uint32_t *colors_write = lm.colors.data();
+	size_t dirty_begin = lm.dirty_begin;
+	size_t dirty_end = lm.dirty_end;
+	float aabb_min[3] = { 0, 0, 0 };
+	float aabb_max[3] = { 0, 0, 0 };
 
 	{
 		ZoneScopedN("Fill buffers");
 		ZoneValue(visible_buffer.size());
 
+		if (used_vertexes) {
+			const Vector3 &first = visible_buffer.front()->lines[0];
+			aabb_min[0] = aabb_max[0] = (float)first.x;
+			aabb_min[1] = aabb_max[1] = (float)first.y;
+			aabb_min[2] = aabb_max[2] = (float)first.z;
+		}
+
+		// Only the vertices that differ from the previous frame are written and marked for upload.
+		size_t pos = 0;
 		for (const auto &o : visible_buffer) {
-			size_t lines_size = o->lines_count;
-			memcpy(vertexes_write + prev_pos, o->lines.get(), o->lines_count * sizeof(Vector3));
-			std::fill(colors_write + prev_pos, colors_write + prev_pos + lines_size, o->color);
-			prev_pos += lines_size;
+			const uint32_t color = o->color.to_abgr32();
+			for (size_t i = 0; i < o->lines_count; i++, pos++) {
+				const float v[3] = { (float)o->lines[i].x, (float)o->lines[i].y, (float)o->lines[i].z };
+				for (int a = 0; a < 3; a++) {
+					aabb_min[a] = std::min(aabb_min[a], v[a]);
+					aabb_max[a] = std::max(aabb_max[a], v[a]);
+				}
+
+				float *dst = vertexes_write + pos * 3;
+				if (dst[0] != v[0] || dst[1] != v[1] || dst[2] != v[2] || colors_write[pos] != color) {
+					dst[0] = v[0];
+					dst[1] = v[1];
+					dst[2] = v[2];
+					colors_write[pos] = color;
+					dirty_begin = std::min(dirty_begin, pos);
+					dirty_end = std::max(dirty_end, pos + 1);
+				}
+			}
 		}
+
+		// The tail that was visible in the previous frame is collapsed into degenerate lines.
+		if (lm.prev_used_vertexes > used_vertexes) {
+			std::fill(vertexes_write + used_vertexes * 3, vertexes_write + lm.prev_used_vertexes * 3, 0.f);
+			dirty_begin = std::min(dirty_begin, used_vertexes);
+			dirty_end = std::max(dirty_end, lm.prev_used_vertexes);
+		}
+	}
+
+	lm.dirty_begin = dirty_begin;
+	lm.dirty_end = dirty_end;
+	lm.prev_used_vertexes = used_vertexes;
+	lm.aabb = AABB(Vector3(aabb_min[0], aabb_min[1], aabb_min[2]), Vector3(aabb_max[0] - aabb_min[0], aabb_max[1] - aabb_min[1], aabb_max[2] - aabb_min[2]));
+}
+
+void GeometryPool::update_lines_mesh(Ref<ArrayMesh> p_ig) {
+	ZoneScoped;
+	auto &lm = lines_mesh;
+	const size_t capacity = lm.colors.size();
+	stat_uploaded_bytes[LINES_TASK] = 0;
+
+	if (lm.surface_capacity != capacity) {
+		ZoneScopedN("Recreate mesh");
+		p_ig->clear_surfaces();
+
+		if (capacity) {
+			PackedVector3Array vertexes;
+			vertexes.resize(capacity);
+			PackedColorArray colors;
+			colors.resize(capacity);
+
+			Array mesh = Array();
+			mesh.resize(ArrayMesh::ArrayType::ARRAY_MAX);
+			mesh[ArrayMesh::ArrayType::ARRAY_VERTEX] = vertexes;
+			mesh[ArrayMesh::ArrayType::ARRAY_COLOR] = colors;
+
+			p_ig->add_surface_from_arrays(Mesh::PrimitiveType::PRIMITIVE_LINES, mesh);
+			stat_uploaded_bytes[LINES_TASK] += capacity * (3 * sizeof(float) + sizeof(uint32_t));
+		}
+		lm.surface_capacity = capacity;
+	}
+
+	if (!capacity) {
+		return;
 	}
 
-	if (used_vertexes > 1) {
-		ZoneScopedN("Set mesh arrays");
+	// The surface was created from the placeholder data, so its own bounds are useless.
+	p_ig->set_custom_aabb(lm.aabb);
+
+	if (lm.dirty_end > lm.dirty_begin) {
+		ZoneScopedN("Update regions");
+		const size_t count = lm.dirty_end - lm.dirty_begin;
+		ZoneValue(count);
 
-		Array mesh = Array();
-		mesh.resize(ArrayMesh::ArrayType::ARRAY_MAX);
-		mesh[ArrayMesh::ArrayType::ARRAY_VERTEX] = vertexes;
-		mesh[ArrayMesh::ArrayType::ARRAY_COLOR] = colors;
+		// Without normals and tangents, the vertex buffer contains only float positions
+		// and the attribute buffer contains only RGBA8 colors.
+		lines_upload_buffer.resize(count * 3 * sizeof(float));
+		memcpy(lines_upload_buffer.ptrw(), lm.vertexes.data() + lm.dirty_begin * 3, count * 3 * sizeof(float));
+		p_ig->surface_update_vertex_region(0, (int64_t)(lm.dirty_begin * 3 * sizeof(float)), lines_upload_buffer);
 
-		p_ig->add_surface_from_arrays(Mesh::PrimitiveType::PRIMITIVE_LINES, mesh);
+		lines_upload_buffer.resize(count * sizeof(uint32_t));
+		memcpy(lines_upload_buffer.ptrw(), lm.colors.data() + lm.dirty_begin, count * sizeof(uint32_t));
+		p_ig->surface_update_attribute_region(0, (int64_t)(lm.dirty_begin * sizeof(uint32_t)), lines_upload_buffer);
+		stat_uploaded_bytes[LINES_TASK] += count * (3 * sizeof(float) + sizeof(uint32_t));
 	}
 
-	time_spent_to_fill_buffers_of_lines -= time_spent_to_cull_lines;
+	lm.dirty_begin = capacity;
+	lm.dirty_end = 0;
+}
+
+void GeometryPool::clear_lines_mesh(Ref<ArrayMesh> p_ig) {
+	ZoneScoped;
+	if (p_ig->get_surface_count()) {
+		p_ig->clear_surfaces();
+	}
+	lines_mesh = LinesMesh();
 }
 
 void GeometryPool::reset_counter(const double &p_delta, const ProcessType &p_proc) {
@@ -310,6 +428,10 @@ void GeometryPool::reset_counter(const double &p_delta, const ProcessType &p_pro
 				proc.lines.reset_counter(p_delta);
 			}
 		}
+
+		for (auto &arena : instant_lines_arena) {
+			arena.reset();
+		}
 	} else {
 		for (auto &vp_pool : pools) {
 			auto &proc = vp_pool.second[(int)p_proc];
@@ -318,6 +440,8 @@ void GeometryPool::reset_counter(const double &p_delta, const ProcessType &p_pro
 			}
 			proc.lines.reset_counter(p_delta);
 		}
+
+		instant_lines_arena[(int)p_proc].reset();
 	}
 }
 
@@ -325,6 +449,9 @@ void GeometryPool::reset_visible_objects() {
 	ZoneScoped;
 	stat_visible_instances = 0;
 	stat_visible_lines = 0;
+	std::fill(std::begin(stat_visible_by_type), std::end(stat_visible_by_type), 0);
+	std::fill(std::begin(stat_uploaded_bytes), std::end(stat_uploaded_bytes), 0);
+	fill_viewports.clear();
 }
 
 void GeometryPool::set_stats(Ref<DebugDraw3DStats> &p_stats) const {
@@ -335,18 +462,41 @@ void GeometryPool::set_stats(Ref<DebugDraw3DStats> &p_stats) const {
 		size_t used_lines = 0;
 	} counts[(int)ProcessType::MAX];
 
+	DebugDraw3DStats::GeometryBreakdown breakdown;
+	auto &types = breakdown.types;
+
 	for (auto &vp_pool : pools) {
 		for (int proc_i = 0; proc_i < (int)ProcessType::MAX; proc_i++) {
 			auto &proc = vp_pool.second[proc_i];
-			for (auto &i : proc.instances) {
-				counts[proc_i].used_instances += i._prev_used_instant;
-				counts[proc_i].used_instances += i.used_delayed;
+			for (int type = 0; type < (int)InstanceType::MAX; type++) {
+				auto &i = proc.instances[type];
+				const size_t used = i._prev_used_instant + i.used_delayed;
+				counts[proc_i].used_instances += used;
+				types[type].used += used;
+				types[type].capacity += i.instant.size() + i.delayed.size();
 			}
 
-			counts[proc_i].used_lines += proc.lines._prev_used_instant + proc.lines.used_delayed;
+			const size_t used_lines = proc.lines._prev_used_instant + proc.lines.used_delayed;
+			counts[proc_i].used_lines += used_lines;
+			types[LINES_TASK].used += used_lines;
+			types[LINES_TASK].capacity += proc.lines.instant.size() + proc.lines.delayed.size();
 		}
 	}
 
+	for (int type = 0; type < FILL_TASKS_COUNT; type++) {
+		types[type].visible = stat_visible_by_type[type];
+		types[type].uploaded_bytes = stat_uploaded_bytes[type];
+	}
+
+	breakdown.viewports.reserve(fill_viewports.size());
+	for (auto &vp_pool : fill_viewports) {
+		int64_t culling_time = 0;
+		for (auto &t : vp_pool.culling_time) {
+			culling_time += t;
+		}
+		breakdown.viewports.push_back({ vp_pool.viewport_id, culling_time });
+	}
+
 	const int p = (int)ProcessType::PROCESS;
 	const int py = (int)ProcessType::PHYSICS_PROCESS;
 
@@ -364,6 +514,21 @@ void GeometryPool::set_stats(Ref<DebugDraw3DStats> &p_stats) const {
 
 			/* p_time_culling_instances_usec */ time_spent_to_cull_instances,
 			/* p_time_culling_lines_usec */ time_spent_to_cull_lines);
+
+	p_stats->set_filling_tasks_stats(
+			/* p_time_filling_tasks_usec */ time_spent_to_run_fill_tasks,
+			/* p_time_filling_task_max_usec */ time_spent_to_fill_task_max);
+
+	size_t arena_high_water = 0;
+	for (auto &arena : instant_lines_arena) {
+		arena_high_water += arena.get_high_water();
+	}
+
+	p_stats->set_breakdown_stats(breakdown);
+
+	p_stats->set_lines_memory_stats(
+			/* p_lines_arena_high_water_bytes */ arena_high_water * sizeof(Vector3),
+			/* p_lines_slab_high_water_bytes */ delayed_lines_slab.get_high_water() * sizeof(Vector3));
 }
 
 void GeometryPool::clear_pool() {
@@ -376,35 +541,42 @@ void GeometryPool::clear_pool() {
 			proc.lines.clear_pools();
 		}
 	}
+
+	// All the blocks have already been returned by the line pools.
+	for (auto &arena : instant_lines_arena) {
+		arena.clear();
+	}
+	delayed_lines_slab.clear();
 }
 
-void GeometryPool::for_each_instance(const std::function<void(DelayedRendererInstance *)> &p_func) {
+void GeometryPool::for_each_instance(const std::function<void(const DelayedRenderer &, const AABBMinMax &, GeometryPoolData3DInstance &)> &p_func) {
 	ZoneScoped;
 	for (auto &vp_pool : pools) {
 		for (auto &proc : vp_pool.second) {
 			for (auto &inst : proc.instances) {
 				for (size_t i = 0; i < inst.used_instant; i++) {
-					p_func(&inst.instant[i]);
+					p_func(inst.instant.states[i], inst.instant.bounds[i], inst.instant.data[i]);
 				}
 				for (size_t i = 0; i < inst.delayed.size(); i++) {
-					if (!inst.delayed[i].is_expired())
-						p_func(&inst.delayed[i]);
+					if (!inst.delayed.states[i].is_expired())
+						p_func(inst.delayed.states[i], inst.delayed.bounds[i], inst.delayed.data[i]);
 				}
 			}
 		}
 	}
 }
 
-void GeometryPool::for_each_line(const std::function<void(DelayedRendererLine *)> &p_func) {
+void GeometryPool::for_each_line(const std::function<void(const DelayedRenderer &, const AABBMinMax &, DelayedRendererLine &)> &p_func) {
 	ZoneScoped;
 	for (auto &vp_pool : pools) {
 		for (auto &proc : vp_pool.second) {
-			for (size_t i = 0; i < proc.lines.used_instant; i++) {
-				p_func(&proc.lines.instant[i]);
+			auto &lines = proc.lines;
+			for (size_t i = 0; i < lines.used_instant; i++) {
+				p_func(lines.instant.states[i], lines.instant.bounds[i], lines.instant.data[i]);
 			}
-			for (size_t i = 0; i < proc.lines.delayed.size(); i++) {
-				if (!proc.lines.delayed[i].is_expired())
-					p_func(&proc.lines.delayed[i]);
+			for (size_t i = 0; i < lines.delayed.size(); i++) {
+				if (!lines.delayed.states[i].is_expired())
+					p_func(lines.delayed.states[i], lines.delayed.bounds[i], lines.delayed.data[i]);
 			}
 		}
 	}
@@ -438,68 +610,94 @@ void GeometryPool::set_no_depth_test_info(bool p_no_depth_test) {
 	is_no_depth_test = p_no_depth_test;
 }
 
+void GeometryPool::_mark_viewport_used(const DebugDraw3DScopeConfig::DebugContainerDependent &p_dcd) {
+	auto &info = viewports_info[p_dcd.viewport];
+	info.id = p_dcd.viewport_id;
+	info.has_new_data = true;
+}
+
 std::vector<Viewport *> GeometryPool::get_and_validate_viewports() {
 	ZoneScoped;
 	std::vector<Viewport *> res;
 	std::vector<Viewport *> to_delete;
 
-	for (const auto &vp : viewport_ids) {
-		if (UtilityFunctions::is_instance_id_valid(vp.second)) {
-			if (_is_viewport_empty(vp.first)) {
-				DEV_PRINT_STD("%s Viewport (%s) did not contain any debug data,\n\tit will be deleted from the World3D's container.\n", is_no_depth_test ? "NoDepth" : "Normal", vp.first->to_string().utf8().get_data());
-				to_delete.push_back(vp.first);
-			} else {
-				res.push_back(vp.first);
-			}
-		} else {
+	for (auto &vp : viewports_info) {
+		// Only the viewports without new geometry can become empty
+		if (!vp.second.has_new_data && _is_viewport_empty(vp.first)) {
+			DEV_PRINT_STD("%s Viewport (%" PRIu64 ") did not contain any debug data,\n\tit will be deleted from the World3D's container.\n", is_no_depth_test ? "NoDepth" : "Normal", vp.second.id);
 			to_delete.push_back(vp.first);
+		} else {
+			vp.second.has_new_data = false;
+			res.push_back(vp.first);
 		}
 	}
 
 	for (const auto &vp : to_delete) {
-		viewport_ids.erase(vp);
+		viewports_info.erase(vp);
 		pools.erase(vp);
 	}
 
 	return res;
 }
 
-void GeometryPool::add_or_update_instance(const DebugDraw3DScopeConfig::Data *p_cfg, ConvertableInstanceType p_type, const real_t &p_exp_time, const Transform3D &p_transform, const Color &p_col, const SphereBounds &p_bounds, const Color *p_custom_col) {
-	add_or_update_instance(p_cfg, _scoped_config_type_convert(p_type, p_cfg), p_exp_time, p_transform, p_col, p_bounds, p_custom_col);
+void GeometryPool::remove_viewport(Viewport *p_vp) {
+	ZoneScoped;
+	viewports_info.erase(p_vp);
+	pools.erase(p_vp);
+}
+
+void GeometryPool::add_or_update_instance(const DebugDraw3DScopeConfig::Data *p_cfg, const ProcessType &p_proc, ConvertableInstanceType p_type, const real_t &p_exp_time, const Transform3D &p_transform, const Color &p_col, const SphereBounds &p_bounds, const Color *p_custom_col) {
+	add_or_update_instance(p_cfg, p_proc, _scoped_config_type_convert(p_type, p_cfg), p_exp_time, p_transform, p_col, p_bounds, p_custom_col);
 }
 
-void GeometryPool::add_or_update_instance(const DebugDraw3DScopeConfig::Data *p_cfg, InstanceType p_type, const real_t &p_exp_time, const Transform3D &p_transform, const Color &p_col, const SphereBounds &p_bounds, const Color *p_custom_col) {
+void GeometryPool::add_or_update_instance(const DebugDraw3DScopeConfig::Data *p_cfg, const ProcessType &p_proc, InstanceType p_type, const real_t &p_exp_time, const Transform3D &p_transform, const Color &p_col, const SphereBounds &p_bounds, const Color *p_custom_col) {
 	ZoneScoped;
-	auto &proc = pools[p_cfg->dcd.viewport][(int)(Engine::get_singleton()->is_in_physics_frame() ? ProcessType::PHYSICS_PROCESS : ProcessType::PROCESS)];
-	DelayedRendererInstance *inst = proc.instances[(int)p_type].get(p_exp_time > 0);
+	auto &proc = pools[p_cfg->dcd.viewport][(int)p_proc];
+	auto &pool = proc.instances[(int)p_type];
+	const bool is_delayed = p_exp_time > 0;
+	size_t idx = pool.get(is_delayed);
+	auto &storage = is_delayed ? pool.delayed : pool.instant;
 
-	if (viewport_ids.count(p_cfg->dcd.viewport) == 0) {
-		viewport_ids[p_cfg->dcd.viewport] = p_cfg->dcd.viewport_id;
-	}
+	_mark_viewport_used(p_cfg->dcd);
+
+	storage.data[idx] = GeometryPoolData3DInstance(p_transform, p_col, p_custom_col ? *p_custom_col : _scoped_config_to_custom(p_cfg));
+	storage.bounds[idx] = SphereBounds{ p_bounds.position, p_bounds.radius + p_cfg->thickness * 0.5f };
 
-	inst->data = GeometryPoolData3DInstance(p_transform, p_col, p_custom_col ? *p_custom_col : _scoped_config_to_custom(p_cfg));
-	inst->bounds = SphereBounds{ p_bounds.position, p_bounds.radius + p_cfg->thickness * 0.5f };
-	inst->expiration_time = p_exp_time;
-	inst->is_used_one_time = false;
-	inst->is_visible = true;
+	auto &state = storage.states[idx];
+	state.expiration_time = p_exp_time;
+	state.is_used_one_time = false;
+	state.is_visible = true;
 }
 
-void GeometryPool::add_or_update_line(const DebugDraw3DScopeConfig::Data *p_cfg, const real_t &p_exp_time, std::unique_ptr<Vector3[]> p_lines, const size_t p_line_count, const Color &p_col, const AABB &p_aabb) {
+Vector3 *GeometryPool::add_or_update_line(const DebugDraw3DScopeConfig::Data *p_cfg, const ProcessType &p_proc, const real_t &p_exp_time, const Vector3 *p_lines, const size_t p_line_count, const Color &p_col, const AABB &p_aabb) {
 	ZoneScoped;
-	auto &proc = pools[p_cfg->dcd.viewport][(int)(Engine::get_singleton()->is_in_physics_frame() ? ProcessType::PHYSICS_PROCESS : ProcessType::PROCESS)];
-	DelayedRendererLine *inst = proc.lines.get(p_exp_time > 0);
-
-	if (viewport_ids.count(p_cfg->dcd.viewport) == 0) {
-		viewport_ids[p_cfg->dcd.viewport] = p_cfg->dcd.viewport_id;
+	auto &proc = pools[p_cfg->dcd.viewport][(int)p_proc];
+	const bool is_delayed = p_exp_time > 0;
+	size_t idx = proc.lines.get(is_delayed);
+	auto &storage = is_delayed ? proc.lines.delayed : proc.lines.instant;
+
+	_mark_viewport_used(p_cfg->dcd);
+
+	auto &line = storage.data[idx];
+	if (is_delayed) {
+		// The block of a reused slot is kept if the new lines fit into it.
+		if (line.block.capacity() < p_line_count) {
+			line.block = delayed_lines_slab.alloc(p_line_count);
+		}
+		line.lines = line.block.get();
+	} else {
+		line.lines = instant_lines_arena[(int)p_proc].alloc(p_line_count);
 	}
-
-	inst->lines = std::move(p_lines);
-	inst->lines_count = p_line_count;
-	inst->color = p_col;
-	inst->bounds = p_aabb;
-	inst->expiration_time = p_exp_time;
-	inst->is_used_one_time = false;
-	inst->is_visible = true;
+	std::copy(p_lines, p_lines + p_line_count, line.lines);
+	line.lines_count = p_line_count;
+	line.color = p_col;
+	storage.bounds[idx] = p_aabb;
+
+	auto &state = storage.states[idx];
+	state.expiration_time = p_exp_time;
+	state.is_used_one_time = false;
+	state.is_visible = true;
+	return line.lines;
 }
 
 GeometryType GeometryPool::_scoped_config_get_geometry_type(const DebugDraw3DScopeConfig::Data *p_cfg) {
@@ -2,17 +2,22 @@
 
 #ifndef DISABLE_DEBUG_RENDERING
 
+#include "common/pooled_allocators.h"
 #include "config_scope_3d.h"
 #include "render_instances_enums.h"
+#include "utils/culling.h"
+#include "utils/culling_tree.h"
 #include "utils/math_utils.h"
 #include "utils/utils.h"
 
+#include <algorithm>
 #include <array>
 #include <functional>
 #include <unordered_set>
 
 GODOT_WARNING_DISABLE()
 #include <godot_cpp/classes/array_mesh.hpp>
+#include <godot_cpp/templates/hashfuncs.hpp>
 GODOT_WARNING_RESTORE()
 using namespace godot;
 
@@ -22,13 +27,66 @@ class MultiMesh;
 class DebugDraw3DStats;
 class GeometryPool;
 
+/// Calls `p_task` for every index in `[0, p_count)` and returns when all calls are finished.
+/// The calls can be made from other threads.
+typedef std::function<void(uint32_t p_count, const std::function<void(uint32_t)> &p_task)> ParallelForFunc;
+
 class GeometryPoolCullingData {
 public:
 	std::vector<std::array<Plane, 6> > m_frustums;
 	std::vector<AABBMinMax> m_frustum_boxes;
+	// Hash of all planes and boxes for a quick comparison
+	uint32_t m_fingerprint;
+
 	GeometryPoolCullingData(const std::vector<std::array<Plane, 6> > &p_frustums, const std::vector<AABBMinMax> p_frustum_boxes) {
 		m_frustums = p_frustums;
 		m_frustum_boxes = p_frustum_boxes;
+
+		uint32_t hash = hash_murmur3_one_32((uint32_t)m_frustums.size());
+		hash = hash_murmur3_one_32((uint32_t)m_frustum_boxes.size(), hash);
+		for (const auto &f : m_frustums) {
+			for (const Plane &p : f) {
+				hash = hash_murmur3_one_real(p.normal.x, hash);
+				hash = hash_murmur3_one_real(p.normal.y, hash);
+				hash = hash_murmur3_one_real(p.normal.z, hash);
+				hash = hash_murmur3_one_real(p.d, hash);
+			}
+		}
+		for (const auto &b : m_frustum_boxes) {
+			hash = hash_murmur3_one_real(b.min.x, hash);
+			hash = hash_murmur3_one_real(b.min.y, hash);
+			hash = hash_murmur3_one_real(b.min.z, hash);
+			hash = hash_murmur3_one_real(b.max.x, hash);
+			hash = hash_murmur3_one_real(b.max.y, hash);
+			hash = hash_murmur3_one_real(b.max.z, hash);
+		}
+		m_fingerprint = hash_fmix32(hash);
+	}
+
+	/// Returns true if the culling with `p_other` gives the same results.
+	bool is_same_frustums(const GeometryPoolCullingData &p_other) const {
+		if (m_fingerprint != p_other.m_fingerprint || m_frustums.size() != p_other.m_frustums.size() || m_frustum_boxes.size() != p_other.m_frustum_boxes.size())
+			return false;
+
+		for (size_t i = 0; i < m_frustums.size(); i++) {
+			if (m_frustums[i] != p_other.m_frustums[i])
+				return false;
+		}
+		for (size_t i = 0; i < m_frustum_boxes.size(); i++) {
+			if (m_frustum_boxes[i].min != p_other.m_frustum_boxes[i].min || m_frustum_boxes[i].max != p_other.m_frustum_boxes[i].max)
+				return false;
+		}
+		return true;
+	}
+
+	/// Writes 1 to `r_visible[i]` for each of `p_bounds` that is visible in any of the frustums.
+	_FORCE_INLINE_ void cull(const AABBMinMax *p_bounds, size_t p_count, uint8_t *r_visible) const {
+		CullingKernel::cull(p_bounds, p_count, m_frustum_boxes.data(), m_frustum_boxes.size(), m_frustums.data(), m_frustums.size(), r_visible);
+	}
+
+	/// Appends to `r_visible` the indexes of the visible items of `p_index`.
+	_FORCE_INLINE_ void cull(CullingIndex &p_index, const AABBMinMax *p_bounds, size_t p_count, std::vector<size_t> &r_visible) const {
+		p_index.cull(p_bounds, p_count, m_frustum_boxes.data(), m_frustum_boxes.size(), m_frustums.data(), m_frustums.size(), r_visible);
 	}
 };
 
@@ -63,35 +121,29 @@ struct GeometryPoolData3DInstance {
 			custom(p_custom) {}
 };
 
+/// Lifetime and visibility of the pooled object. Bounds and the payload are stored separately.
 struct DelayedRenderer {
+	// Remaining time until the first frame, then the expiration time on the pool clock
 	double expiration_time;
 	bool is_used_one_time;
 	bool is_visible;
-	AABBMinMax bounds;
 
 	DelayedRenderer() :
 			expiration_time(-1),
 			is_used_one_time(true),
-			is_visible(false),
-			bounds() {}
+			is_visible(false) {}
 
 	_FORCE_INLINE_ bool is_expired() const {
 		return expiration_time < 0 ? is_used_one_time : false;
 	}
-
-	_FORCE_INLINE_ bool update_visibility(const std::shared_ptr<GeometryPoolCullingData> &p_culling_data);
-};
-
-struct DelayedRendererInstance : public DelayedRenderer {
-	GeometryPoolData3DInstance data;
-
-	DelayedRendererInstance();
 };
 
-struct DelayedRendererLine : public DelayedRenderer {
-	std::unique_ptr<Vector3[]> lines;
+struct DelayedRendererLine {
+	/// Points to the frame arena for instant lines or to the `block` for delayed lines.
+	Vector3 *lines;
 	size_t lines_count;
 	Color color;
+	SlabPool<Vector3>::Block block;
 
 	DelayedRendererLine();
 };
@@ -105,48 +157,215 @@ private:
 
 	bool is_no_depth_test = false;
 
-	template <class TInst>
+	/// Structure of arrays. The culling and expiration passes only touch `states` and `bounds`.
+	template <class TData>
+	struct ObjectsStorage {
+		std::vector<DelayedRenderer> states = {};
+		std::vector<AABBMinMax> bounds = {};
+		std::vector<TData> data = {};
+
+		_FORCE_INLINE_ size_t size() const {
+			return states.size();
+		}
+
+		void resize(size_t p_size) {
+			states.resize(p_size);
+			bounds.resize(p_size);
+			data.resize(p_size);
+		}
+
+		void clear() {
+			states.clear();
+			bounds.clear();
+			data.clear();
+		}
+
+		void remove_expired() {
+			size_t last = 0;
+			for (size_t i = 0; i < states.size(); i++) {
+				if (!states[i].is_expired()) {
+					if (last != i) {
+						states[last] = states[i];
+						bounds[last] = bounds[i];
+						data[last] = std::move(data[i]);
+					}
+					last++;
+				}
+			}
+			resize(last);
+		}
+	};
+
+	template <class TData>
 	struct ObjectsPool {
-		std::vector<TInst> instant = {};
-		std::vector<TInst> delayed = {};
+		ObjectsStorage<TData> instant = {};
+		ObjectsStorage<TData> delayed = {};
 
 		size_t used_instant = 0;
 		size_t used_delayed = 0;
 		size_t _prev_used_instant = 0;
-		size_t _prev_not_expired_delayed = 0;
 		double time_used_less_then_half_of_instant_pool = TIME_USED_TO_SHRINK_INSTANT;
 		double time_used_less_then_half_of_delayed_pool = TIME_USED_TO_SHRINK_DELAYED;
 
+		struct ExpirationEntry {
+			double time;
+			size_t index;
+
+			bool operator>(const ExpirationEntry &p_other) const {
+				return time > p_other.time;
+			}
+		};
+
+		// Time passed since the creation of the pool
+		double clock = 0;
+		// Min-heap of the expiration times of the scheduled delayed objects
+		std::vector<ExpirationEntry> expiration_queue;
+		// Delayed objects added since the last frame
+		std::vector<size_t> pending_delayed;
+		// Expired slots in `delayed`
+		std::vector<size_t> free_delayed;
+		// Scheduled delayed objects. Large pools are culled through a BVH.
+		CullingIndex delayed_culling;
+		// Delayed objects visible in the last frame
+		std::vector<size_t> visible_delayed;
+		// Delayed objects scheduled since the last culling
+		std::vector<size_t> scheduled_delayed;
+		// Frustums of the last culling. While they are the same, only `scheduled_delayed` are culled.
+		std::shared_ptr<GeometryPoolCullingData> delayed_culled_with;
+		std::vector<AABBMinMax> temp_bounds;
+		std::vector<uint8_t> temp_mask;
+
 	private:
-		_FORCE_INLINE_ TInst *get_internal(bool is_delayed, std::vector<TInst> &objs, size_t &used) {
+		void rebuild_expiration_queue() {
+			expiration_queue.clear();
+			pending_delayed.clear();
+			free_delayed.clear();
+			delayed_culling.clear();
+			visible_delayed.clear();
+			scheduled_delayed.clear();
+
+			for (size_t i = 0; i < delayed.size(); i++) {
+				const DelayedRenderer &s = delayed.states[i];
+				if (s.is_expired()) {
+					free_delayed.push_back(i);
+				} else if (s.is_used_one_time) {
+					expiration_queue.push_back({ s.expiration_time, i });
+					delayed_culling.add(i);
+					if (s.is_visible) {
+						visible_delayed.push_back(i);
+					}
+				} else {
+					pending_delayed.push_back(i);
+				}
+			}
+			std::make_heap(expiration_queue.begin(), expiration_queue.end(), std::greater<ExpirationEntry>());
+		}
+
+	public:
+		/// Returns the index of a free object in `delayed` or `instant` storage.
+		size_t get(bool is_delayed) {
+			ZoneScoped;
 			if (is_delayed) {
-				while (objs.size() != used) {
-					if ((objs[used]).is_expired()) {
-						return &objs[used++];
+				if (free_delayed.empty()) {
+					size_t old_size = delayed.size();
+					int to_create = Math::clamp((int)old_size, 2, 1024);
+					delayed.resize(old_size + to_create);
+
+					// Take the first new slot and leave the rest for the next calls
+					for (size_t i = delayed.size() - 1; i > old_size; i--) {
+						free_delayed.push_back(i);
 					}
-					used++;
+					pending_delayed.push_back(old_size);
+					return old_size;
 				}
+
+				size_t idx = free_delayed.back();
+				free_delayed.pop_back();
+				pending_delayed.push_back(idx);
+				return idx;
 			} else {
-				if (objs.size() != used) {
-					return &objs[used++];
+				if (instant.size() == used_instant) {
+					int to_create = Math::clamp((int)instant.size(), 2, 1024);
+					instant.resize(instant.size() + to_create);
 				}
+				return used_instant++;
 			}
+		}
 
-			int to_create = Math::clamp((int)objs.size(), 2, 1024);
-			for (int i = 0; i < to_create; i++) {
-				objs.push_back(TInst());
+		/// Advances the pool clock and schedules the expiration of the objects added since the last frame.
+		/// Objects created in the physics ticks are not aged by the time passed before they were rendered for the first time.
+		void schedule_delayed(double p_delta, bool p_is_physics) {
+			const double first_frame_time = p_is_physics ? clock + p_delta : clock;
+			for (size_t idx : pending_delayed) {
+				DelayedRenderer &s = delayed.states[idx];
+				s.expiration_time += first_frame_time;
+				s.is_used_one_time = true;
+				s.is_visible = false;
+
+				expiration_queue.push_back({ s.expiration_time, idx });
+				std::push_heap(expiration_queue.begin(), expiration_queue.end(), std::greater<ExpirationEntry>());
+				delayed_culling.add(idx);
+				scheduled_delayed.push_back(idx);
 			}
-			return &objs[used++];
+			pending_delayed.clear();
+			clock += p_delta;
 		}
 
-	public:
-		TInst *get(bool is_delayed) {
-			ZoneScoped;
-			if (is_delayed) {
-				return get_internal(is_delayed, delayed, _prev_not_expired_delayed);
+		/// Frees the slots of the objects whose time is up. Only the expired objects are visited.
+		void release_expired_delayed() {
+			while (expiration_queue.size() && expiration_queue.front().time < clock) {
+				size_t idx = expiration_queue.front().index;
+				std::pop_heap(expiration_queue.begin(), expiration_queue.end(), std::greater<ExpirationEntry>());
+				expiration_queue.pop_back();
+
+				DelayedRenderer &s = delayed.states[idx];
+				s.expiration_time = -1;
+				s.is_used_one_time = true;
+				s.is_visible = false;
+				free_delayed.push_back(idx);
+				delayed_culling.remove(idx);
+			}
+			used_delayed = delayed.size() - free_delayed.size();
+		}
+
+		/// Updates `visible_delayed` and the visibility flags of the scheduled delayed objects.
+		/// The bounds of delayed objects never change, so with the same frustums the previous results are reused.
+		void cull_delayed(const std::shared_ptr<GeometryPoolCullingData> &p_culling_data) {
+			if (delayed_culled_with && delayed_culled_with->is_same_frustums(*p_culling_data)) {
+				// Expired objects were hidden in `release_expired_delayed` and their slots could be scheduled again
+				visible_delayed.erase(std::remove_if(visible_delayed.begin(), visible_delayed.end(), [this](size_t idx) { return !delayed.states[idx].is_visible; }), visible_delayed.end());
+
+				if (scheduled_delayed.size()) {
+					temp_bounds.resize(scheduled_delayed.size());
+					temp_mask.resize(scheduled_delayed.size());
+					for (size_t i = 0; i < scheduled_delayed.size(); i++) {
+						temp_bounds[i] = delayed.bounds[scheduled_delayed[i]];
+					}
+
+					p_culling_data->cull(temp_bounds.data(), temp_bounds.size(), temp_mask.data());
+
+					for (size_t i = 0; i < scheduled_delayed.size(); i++) {
+						if (temp_mask[i]) {
+							size_t idx = scheduled_delayed[i];
+							delayed.states[idx].is_visible = true;
+							visible_delayed.push_back(idx);
+						}
+					}
+				}
 			} else {
-				return get_internal(is_delayed, instant, used_instant);
+				for (size_t idx : visible_delayed) {
+					delayed.states[idx].is_visible = false;
+				}
+				visible_delayed.clear();
+
+				p_culling_data->cull(delayed_culling, delayed.bounds.data(), delayed.size(), visible_delayed);
+
+				for (size_t idx : visible_delayed) {
+					delayed.states[idx].is_visible = true;
+				}
+				delayed_culled_with = p_culling_data;
 			}
+			scheduled_delayed.clear();
 		}
 
 		void reset_counter(double delta, int custom_type_of_buffer = 0) {
@@ -156,7 +375,7 @@ private:
 				if (time_used_less_then_half_of_instant_pool <= 0) {
 					time_used_less_then_half_of_instant_pool = TIME_USED_TO_SHRINK_INSTANT;
 
-					DEV_PRINT_STD("Shrinking instant buffer for %s. From %" PRIu64 ", to %" PRIu64 ". Buffer type: %d\n", typeid(TInst).name(), instant.size(), used_instant, custom_type_of_buffer);
+					DEV_PRINT_STD("Shrinking instant buffer for %s. From %" PRIu64 ", to %" PRIu64 ". Buffer type: %d\n", typeid(TData).name(), instant.size(), used_instant, custom_type_of_buffer);
 
 					instant.resize(used_instant);
 				}
@@ -166,7 +385,6 @@ private:
 
 			_prev_used_instant = used_instant;
 			used_instant = 0;
-			_prev_not_expired_delayed = 0;
 
 			if (delayed.size() && used_delayed <= (delayed.size() * 0.5)) {
 				time_used_less_then_half_of_delayed_pool -= delta;
@@ -174,10 +392,11 @@ private:
 					time_used_less_then_half_of_delayed_pool = TIME_USED_TO_SHRINK_DELAYED;
 
 					size_t old_size = delayed.size();
-					delayed.erase(std::remove_if(delayed.begin(), delayed.end(), [this](auto &i) { return i.is_expired(); }),
-							delayed.end());
+					delayed.remove_expired();
+					// Indexes have been changed
+					rebuild_expiration_queue();
 
-					DEV_PRINT_STD("Shrinking _delayed_ buffer for %s. From %" PRIu64 ", to %" PRIu64 ". Buffer type: %d\n", typeid(TInst).name(), old_size, delayed.size(), custom_type_of_buffer);
+					DEV_PRINT_STD("Shrinking _delayed_ buffer for %s. From %" PRIu64 ", to %" PRIu64 ". Buffer type: %d\n", typeid(TData).name(), old_size, delayed.size(), custom_type_of_buffer);
 				}
 			} else {
 				time_used_less_then_half_of_delayed_pool = TIME_USED_TO_SHRINK_DELAYED;
@@ -187,22 +406,57 @@ private:
 		void clear_pools() {
 			instant.clear();
 			delayed.clear();
+			expiration_queue.clear();
+			pending_delayed.clear();
+			free_delayed.clear();
+			delayed_culling.clear();
+			visible_delayed.clear();
+			scheduled_delayed.clear();
+			delayed_culled_with.reset();
 			used_instant = 0;
 			used_delayed = 0;
 			_prev_used_instant = 0;
-			_prev_not_expired_delayed = 0;
 			time_used_less_then_half_of_instant_pool = 0;
 			time_used_less_then_half_of_delayed_pool = 0;
 		}
 	};
 
 	struct processTypePools {
-		ObjectsPool<DelayedRendererInstance> instances[(int)InstanceType::MAX];
+		ObjectsPool<GeometryPoolData3DInstance> instances[(int)InstanceType::MAX];
 		ObjectsPool<DelayedRendererLine> lines;
 	};
 
+	// Must be declared before the `pools` to outlive the lines that use them.
+	FrameArena<Vector3> instant_lines_arena[(int)ProcessType::MAX];
+	SlabPool<Vector3> delayed_lines_slab;
+
 	std::unordered_map<Viewport *, processTypePools[(int)ProcessType::MAX]> pools;
-	std::unordered_map<Viewport *, uint64_t> viewport_ids;
+	struct ViewportInfo {
+		uint64_t id = 0;
+		// Set when geometry is added, so the Viewport is known to be non-empty without checking all its pools
+		bool has_new_data = false;
+	};
+	std::unordered_map<Viewport *, ViewportInfo> viewports_info;
+
+	// One task for each InstanceType and one for the lines
+	static constexpr int LINES_TASK = (int)InstanceType::MAX;
+	static constexpr int FILL_TASKS_COUNT = LINES_TASK + 1;
+
+	struct FillViewport {
+		processTypePools *pools;
+		std::shared_ptr<GeometryPoolCullingData> culling_data;
+		uint64_t viewport_id;
+		// Each task writes only its own entry
+		int64_t culling_time[FILL_TASKS_COUNT];
+	};
+
+	struct FillTaskTime {
+		int64_t total = 0;
+		int64_t culling = 0;
+	};
+
+	std::vector<FillViewport> fill_viewports;
+	FillTaskTime fill_tasks_time[FILL_TASKS_COUNT] = {};
 
 	double process_delta_sum = 0;
 	double physics_delta_sum = 0;
@@ -210,13 +464,36 @@ private:
 	PackedFloat32Array temp_instances_buffers[(int)InstanceType::MAX];
 	size_t prev_buffer_visible_instance_count[(int)InstanceType::MAX] = {};
 	size_t prev_buffer_visible_lines_count = 0;
-
+	std::vector<uint8_t> culling_masks[FILL_TASKS_COUNT];
+
+	static constexpr size_t LINES_MESH_MIN_CAPACITY = 4096;
+	static constexpr double TIME_USED_TO_SHRINK_LINES_MESH = 5;
+
+	/// Copy of the persistent lines mesh in the format of its GPU buffers.
+	/// The surface is recreated only when the capacity changes, otherwise only the changed range is uploaded.
+	struct LinesMesh {
+		std::vector<float> vertexes;
+		std::vector<uint32_t> colors;
+		size_t surface_capacity = 0;
+		size_t prev_used_vertexes = 0;
+		size_t dirty_begin = 0;
+		size_t dirty_end = 0;
+		double time_used_less_then_quarter = 0;
+		AABB aabb;
+	} lines_mesh;
+	PackedByteArray lines_upload_buffer;
+
+	// Stats of each InstanceType and the lines in the last frame
+	size_t stat_visible_by_type[FILL_TASKS_COUNT] = {};
+	size_t stat_uploaded_bytes[FILL_TASKS_COUNT] = {};
 	uint64_t stat_visible_instances = 0;
 	uint64_t stat_visible_lines = 0;
 	int64_t time_spent_to_fill_buffers_of_instances = 0;
 	int64_t time_spent_to_fill_buffers_of_lines = 0;
 	int64_t time_spent_to_cull_instances = 0;
 	int64_t time_spent_to_cull_lines = 0;
+	int64_t time_spent_to_run_fill_tasks = 0;
+	int64_t time_spent_to_fill_task_max = 0;
 
 	// Internal use of raw pointer to avoid ref/unref
 	Color _scoped_config_to_custom(const DebugDraw3DScopeConfig::Data *p_cfg);
@@ -224,9 +501,14 @@ private:
 	GeometryType _scoped_config_get_geometry_type(const DebugDraw3DScopeConfig::Data *p_cfg);
 
 	bool _is_viewport_empty(Viewport *vp);
+	_FORCE_INLINE_ void _mark_viewport_used(const DebugDraw3DScopeConfig::DebugContainerDependent &p_dcd);
 
-	void fill_instance_data(const std::vector<Ref<MultiMesh> *> &p_meshes, std::unordered_map<Viewport *, std::shared_ptr<GeometryPoolCullingData> > &p_culling_data);
-	void fill_lines_data(Ref<ArrayMesh> p_ig, std::unordered_map<Viewport *, std::shared_ptr<GeometryPoolCullingData> > &p_culling_data);
+	// Can be called from any thread, but only once per type at the same time.
+	void fill_instance_data(int p_type);
+	void fill_lines_data();
+	// Must be called from the thread that owns the meshes.
+	void update_instance_mesh(int p_type, Ref<MultiMesh> &p_mesh);
+	void update_lines_mesh(Ref<ArrayMesh> p_ig);
 
 public:
 	GeometryPool() {}
@@ -236,19 +518,25 @@ public:
 
 	void set_no_depth_test_info(bool p_no_depth_test);
 
+	/// Returns the viewports with geometry and removes the empty ones. Deleted viewports must be removed with `remove_viewport`.
 	std::vector<Viewport *> get_and_validate_viewports();
+	/// Drops all the geometry of the viewport.
+	void remove_viewport(Viewport *p_vp);
 
-	void fill_mesh_data(const std::vector<Ref<MultiMesh> *> &p_meshes, Ref<ArrayMesh> p_ig, std::unordered_map<Viewport *, std::shared_ptr<GeometryPoolCullingData> > &p_culling_data);
+	void fill_mesh_data(const std::vector<Ref<MultiMesh> *> &p_meshes, Ref<ArrayMesh> p_ig, std::unordered_map<Viewport *, std::shared_ptr<GeometryPoolCullingData> > &p_culling_data, const ParallelForFunc &p_parallel_for);
 	void reset_counter(const double &p_delta, const ProcessType &p_proc = ProcessType::MAX);
 	void reset_visible_objects();
 	void set_stats(Ref<DebugDraw3DStats> &p_stats) const;
 	void clear_pool();
-	void for_each_instance(const std::function<void(DelayedRendererInstance *)> &p_func);
-	void for_each_line(const std::function<void(DelayedRendererLine *)> &p_func);
+	/// Removes the lines surface. It will be created again on the next update.
+	void clear_lines_mesh(Ref<ArrayMesh> p_ig);
+	void for_each_instance(const std::function<void(const DelayedRenderer &, const AABBMinMax &, GeometryPoolData3DInstance &)> &p_func);
+	void for_each_line(const std::function<void(const DelayedRenderer &, const AABBMinMax &, DelayedRendererLine &)> &p_func);
 	void update_expiration_delta(const double &p_delta, const ProcessType &p_proc);
-	void add_or_update_instance(const DebugDraw3DScopeConfig::Data *p_cfg, ConvertableInstanceType p_type, const real_t &p_exp_time, const Transform3D &p_transform, const Color &p_col, const SphereBounds &p_bounds, const Color *p_custom_col = nullptr);
-	void add_or_update_instance(const DebugDraw3DScopeConfig::Data *p_cfg, InstanceType p_type, const real_t &p_exp_time, const Transform3D &p_transform, const Color &p_col, const SphereBounds &p_bounds, const Color *p_custom_col = nullptr);
-	void add_or_update_line(const DebugDraw3DScopeConfig::Data *p_cfg, const real_t &p_exp_time, std::unique_ptr<Vector3[]> p_lines, const size_t p_line_count, const Color &p_col, const AABB &p_aabb);
+	void add_or_update_instance(const DebugDraw3DScopeConfig::Data *p_cfg, const ProcessType &p_proc, ConvertableInstanceType p_type, const real_t &p_exp_time, const Transform3D &p_transform, const Color &p_col, const SphereBounds &p_bounds, const Color *p_custom_col = nullptr);
+	void add_or_update_instance(const DebugDraw3DScopeConfig::Data *p_cfg, const ProcessType &p_proc, InstanceType p_type, const real_t &p_exp_time, const Transform3D &p_transform, const Color &p_col, const SphereBounds &p_bounds, const Color *p_custom_col = nullptr);
+	/// Copies `p_lines` into the pooled memory and returns the copy.
+	Vector3 *add_or_update_line(const DebugDraw3DScopeConfig::Data *p_cfg, const ProcessType &p_proc, const real_t &p_exp_time, const Vector3 *p_lines, const size_t p_line_count, const Color &p_col, const AABB &p_aabb);
 };
 
 #endif
\ No newline at end of file
@@ -1,5 +1,41 @@
 #include "stats_3d.h"
 
+#include "utils/profiler.h"
+
+#include <algorithm>
+
+#ifdef TRACY_ENABLE
+#include <array>
+#include <string>
+#include <unordered_map>
+#endif
+
+const char *const DebugDraw3DStats::GEOMETRY_TYPE_NAMES[GEOMETRY_TYPES_COUNT] = {
+	"cube",
+	"cube_centered",
+	"arrowhead",
+	"position",
+	"sphere",
+	"sphere_hd",
+	"cylinder",
+	"cylinder_ab",
+
+	"line_volumetric",
+	"cube_volumetric",
+	"cube_centered_volumetric",
+	"arrowhead_volumetric",
+	"position_volumetric",
+	"sphere_volumetric",
+	"sphere_hd_volumetric",
+	"cylinder_volumetric",
+	"cylinder_ab_volumetric",
+
+	"billboard_square",
+	"plane",
+
+	"lines",
+};
+
 void DebugDraw3DStats::_bind_methods() {
 #define REG_PROPERTY_NO_SET(name, type)                                                         \
 	ClassDB::bind_method(D_METHOD(NAMEOF(get_##name)), &DebugDraw3DStats::get_##name);          \
@@ -27,32 +63,163 @@ void DebugDraw3DStats::_bind_methods() {
 	REG_PROPERTY_NO_SET(time_culling_lines_usec, Variant::INT);
 	REG_PROPERTY_NO_SET(total_time_culling_usec, Variant::INT);
 
+	REG_PROPERTY_NO_SET(time_filling_tasks_usec, Variant::INT);
+	REG_PROPERTY_NO_SET(time_filling_task_max_usec, Variant::INT);
+
+	REG_PROPERTY_NO_SET(lines_arena_high_water_bytes, Variant::INT);
+	REG_PROPERTY_NO_SET(lines_slab_high_water_bytes, Variant::INT);
+
 	REG_PROPERTY_NO_SET(total_time_spent_usec, Variant::INT);
 
 	REG_PROPERTY_NO_SET(created_scoped_configs, Variant::INT);
 	REG_PROPERTY_NO_SET(orphan_scoped_configs, Variant::INT);
 
+	REG_PROPERTY_NO_SET(draw_lock_contentions, Variant::INT);
+	REG_PROPERTY_NO_SET(deferred_draw_commands, Variant::INT);
+	REG_PROPERTY_NO_SET(thread_command_buffers, Variant::INT);
+
 	REG_PROPERTY_NO_SET(nodes_label3d_visible, Variant::INT);
 	REG_PROPERTY_NO_SET(nodes_label3d_visible_physics, Variant::INT);
 	REG_PROPERTY_NO_SET(nodes_label3d_exists, Variant::INT);
 	REG_PROPERTY_NO_SET(nodes_label3d_exists_physics, Variant::INT);
 	REG_PROPERTY_NO_SET(nodes_label3d_exists_total, Variant::INT);
+	REG_PROPERTY_NO_SET(nodes_label3d_reshapes, Variant::INT);
+
+	REG_PROPERTY_NO_SET(glyph_text_visible, Variant::INT);
+	REG_PROPERTY_NO_SET(glyph_text_visible_physics, Variant::INT);
+	REG_PROPERTY_NO_SET(glyph_text_quads, Variant::INT);
+	REG_PROPERTY_NO_SET(glyph_text_batches, Variant::INT);
 
 #undef REG_PROPERTY_NO_SET
 #pragma endregion
+
+	ClassDB::bind_method(D_METHOD(NAMEOF(get_geometry_type_names)), &DebugDraw3DStats::get_geometry_type_names);
+	ClassDB::bind_method(D_METHOD(NAMEOF(get_geometry_capacity)), &DebugDraw3DStats::get_geometry_capacity);
+	ClassDB::bind_method(D_METHOD(NAMEOF(get_geometry_used)), &DebugDraw3DStats::get_geometry_used);
+	ClassDB::bind_method(D_METHOD(NAMEOF(get_geometry_visible)), &DebugDraw3DStats::get_geometry_visible);
+	ClassDB::bind_method(D_METHOD(NAMEOF(get_geometry_uploaded_bytes)), &DebugDraw3DStats::get_geometry_uploaded_bytes);
+	ClassDB::bind_method(D_METHOD(NAMEOF(get_viewport_ids)), &DebugDraw3DStats::get_viewport_ids);
+	ClassDB::bind_method(D_METHOD(NAMEOF(get_viewport_culling_usec)), &DebugDraw3DStats::get_viewport_culling_usec);
+}
+
+PackedInt64Array DebugDraw3DStats::_get_types_field(int64_t GeometryTypeStats::*p_field) const {
+	PackedInt64Array res;
+	res.resize(GEOMETRY_TYPES_COUNT);
+	int64_t *w = res.ptrw();
+	for (int i = 0; i < GEOMETRY_TYPES_COUNT; i++) {
+		w[i] = breakdown.types[i].*p_field;
+	}
+	return res;
 }
 
+PackedStringArray DebugDraw3DStats::get_geometry_type_names() const {
+	PackedStringArray res;
+	for (const char *name : GEOMETRY_TYPE_NAMES) {
+		res.push_back(name);
+	}
+	return res;
+}
+
+PackedInt64Array DebugDraw3DStats::get_geometry_capacity() const {
+	return _get_types_field(&GeometryTypeStats::capacity);
+}
+
+PackedInt64Array DebugDraw3DStats::get_geometry_used() const {
+	return _get_types_field(&GeometryTypeStats::used);
+}
+
+PackedInt64Array DebugDraw3DStats::get_geometry_visible() const {
+	return _get_types_field(&GeometryTypeStats::visible);
+}
+
+PackedInt64Array DebugDraw3DStats::get_geometry_uploaded_bytes() const {
+	return _get_types_field(&GeometryTypeStats::uploaded_bytes);
+}
+
+PackedInt64Array DebugDraw3DStats::get_viewport_ids() const {
+	PackedInt64Array res;
+	res.resize(breakdown.viewports.size());
+	int64_t *w = res.ptrw();
+	for (size_t i = 0; i < breakdown.viewports.size(); i++) {
+		w[i] = (int64_t)breakdown.viewports[i].viewport_id;
+	}
+	return res;
+}
+
+PackedInt64Array DebugDraw3DStats::get_viewport_culling_usec() const {
+	PackedInt64Array res;
+	res.resize(breakdown.viewports.size());
+	int64_t *w = res.ptrw();
+	for (size_t i = 0; i < breakdown.viewports.size(); i++) {
+		w[i] = breakdown.viewports[i].culling_usec;
+	}
+	return res;
+}
+
+void DebugDraw3DStats::set_breakdown_stats(const GeometryBreakdown &p_breakdown) {
+	breakdown = p_breakdown;
+}
+
+#ifdef TRACY_ENABLE
+void DebugDraw3DStats::plot_breakdown() const {
+	ZoneScoped;
+
+	// Tracy keeps the pointers to the names, so the strings must never be freed
+	static const auto type_plots = [] {
+		std::array<std::array<std::string, 4>, GEOMETRY_TYPES_COUNT> names;
+		for (int i = 0; i < GEOMETRY_TYPES_COUNT; i++) {
+			names[i][0] = std::string("DD3D capacity ") + GEOMETRY_TYPE_NAMES[i];
+			names[i][1] = std::string("DD3D used ") + GEOMETRY_TYPE_NAMES[i];
+			names[i][2] = std::string("DD3D visible ") + GEOMETRY_TYPE_NAMES[i];
+			names[i][3] = std::string("DD3D uploaded bytes ") + GEOMETRY_TYPE_NAMES[i];
+		}
+		return names;
+	}();
+	static std::unordered_map<uint64_t, std::string> viewport_plots;
+
+	for (int i = 0; i < GEOMETRY_TYPES_COUNT; i++) {
+		const GeometryTypeStats &t = breakdown.types[i];
+		TracyPlot(type_plots[i][0].c_str(), t.capacity);
+		TracyPlot(type_plots[i][1].c_str(), t.used);
+		TracyPlot(type_plots[i][2].c_str(), t.visible);
+		TracyPlot(type_plots[i][3].c_str(), t.uploaded_bytes);
+	}
+
+	for (const ViewportStats &vp : breakdown.viewports) {
+		auto it = viewport_plots.find(vp.viewport_id);
+		if (it == viewport_plots.end()) {
+			it = viewport_plots.emplace(vp.viewport_id, "DD3D culling usec viewport " + std::to_string(vp.viewport_id)).first;
+		}
+		TracyPlot(it->second.c_str(), vp.culling_usec);
+	}
+}
+#endif
+
 void DebugDraw3DStats::set_nodes_stats(
 		const int64_t &p_nodes_label3d_visible,
 		const int64_t &p_nodes_label3d_visible_physics,
 		const int64_t &p_nodes_label3d_exists,
-		const int64_t &p_nodes_label3d_exists_physics) {
+		const int64_t &p_nodes_label3d_exists_physics,
+		const int64_t &p_nodes_label3d_reshapes) {
 
 	nodes_label3d_visible = p_nodes_label3d_visible;
 	nodes_label3d_visible_physics = p_nodes_label3d_visible_physics;
 	nodes_label3d_exists = p_nodes_label3d_exists;
 	nodes_label3d_exists_physics = p_nodes_label3d_exists_physics;
 	nodes_label3d_exists_total = nodes_label3d_exists + nodes_label3d_exists_physics;
+	nodes_label3d_reshapes = p_nodes_label3d_reshapes;
+}
+
+void DebugDraw3DStats::set_glyph_text_stats(
+		const int64_t &p_glyph_text_visible,
+		const int64_t &p_glyph_text_visible_physics,
+		const int64_t &p_glyph_text_quads,
+		const int64_t &p_glyph_text_batches) {
+
+	glyph_text_visible = p_glyph_text_visible;
+	glyph_text_visible_physics = p_glyph_text_visible_physics;
+	glyph_text_quads = p_glyph_text_quads;
+	glyph_text_batches = p_glyph_text_batches;
 }
 
 void DebugDraw3DStats::set_scoped_config_stats(
@@ -63,6 +230,32 @@ void DebugDraw3DStats::set_scoped_config_stats(
 	orphan_scoped_configs = p_orphan_scoped_configs;
 }
 
+void DebugDraw3DStats::set_threading_stats(
+		const int64_t &p_draw_lock_contentions,
+		const int64_t &p_deferred_draw_commands,
+		const int64_t &p_thread_command_buffers) {
+
+	draw_lock_contentions = p_draw_lock_contentions;
+	deferred_draw_commands = p_deferred_draw_commands;
+	thread_command_buffers = p_thread_command_buffers;
+}
+
+void DebugDraw3DStats::set_filling_tasks_stats(
+		const int64_t &p_time_filling_tasks_usec,
+		const int64_t &p_time_filling_task_max_usec) {
+
+	time_filling_tasks_usec = p_time_filling_tasks_usec;
+	time_filling_task_max_usec = p_time_filling_task_max_usec;
+}
+
+void DebugDraw3DStats::set_lines_memory_stats(
+		const int64_t &p_lines_arena_high_water_bytes,
+		const int64_t &p_lines_slab_high_water_bytes) {
+
+	lines_arena_high_water_bytes = p_lines_arena_high_water_bytes;
+	lines_slab_high_water_bytes = p_lines_slab_high_water_bytes;
+}
+
 void DebugDraw3DStats::set_render_stats(
 		const int64_t &p_instances,
 		const int64_t &p_lines,
@@ -123,14 +316,49 @@ void DebugDraw3DStats::combine_with(const Ref<DebugDraw3DStats> p_other) {
 	time_culling_lines_usec += p_other->time_culling_lines_usec;
 	total_time_culling_usec += p_other->total_time_culling_usec;
 
+	time_filling_tasks_usec += p_other->time_filling_tasks_usec;
+	time_filling_task_max_usec = Math::max(time_filling_task_max_usec, p_other->time_filling_task_max_usec);
+
+	lines_arena_high_water_bytes += p_other->lines_arena_high_water_bytes;
+	lines_slab_high_water_bytes += p_other->lines_slab_high_water_bytes;
+
 	total_time_spent_usec += p_other->total_time_spent_usec;
 
 	created_scoped_configs += p_other->created_scoped_configs;
 	orphan_scoped_configs += p_other->orphan_scoped_configs;
 
+	draw_lock_contentions += p_other->draw_lock_contentions;
+	deferred_draw_commands += p_other->deferred_draw_commands;
+	thread_command_buffers += p_other->thread_command_buffers;
+
 	nodes_label3d_visible += p_other->nodes_label3d_visible;
 	nodes_label3d_visible_physics += p_other->nodes_label3d_visible_physics;
 	nodes_label3d_exists += p_other->nodes_label3d_exists;
 	nodes_label3d_exists_physics += p_other->nodes_label3d_exists_physics;
 	nodes_label3d_exists_total += p_other->nodes_label3d_exists_total;
+	nodes_label3d_reshapes += p_other->nodes_label3d_reshapes;
+
+	glyph_text_visible += p_other->glyph_text_visible;
+	glyph_text_visible_physics += p_other->glyph_text_visible_physics;
+	glyph_text_quads += p_other->glyph_text_quads;
+	glyph_text_batches += p_other->glyph_text_batches;
+
+	for (int i = 0; i < GEOMETRY_TYPES_COUNT; i++) {
+		GeometryTypeStats &t = breakdown.types[i];
+		const GeometryTypeStats &o = p_other->breakdown.types[i];
+		t.capacity += o.capacity;
+		t.used += o.used;
+		t.visible += o.visible;
+		t.uploaded_bytes += o.uploaded_bytes;
+	}
+
+	// The same Viewport can be drawn by several containers, e.g. with and without the depth test
+	for (const ViewportStats &o : p_other->breakdown.viewports) {
+		auto it = std::find_if(breakdown.viewports.begin(), breakdown.viewports.end(), [&o](const ViewportStats &vp) { return vp.viewport_id == o.viewport_id; });
+		if (it != breakdown.viewports.end()) {
+			it->culling_usec += o.culling_usec;
+		} else {
+			breakdown.viewports.push_back(o);
+		}
+	}
 }
\ No newline at end of file
@@ -1,7 +1,10 @@
 #pragma once
 
+#include "render_instances_enums.h"
 #include "utils/compiler.h"
 
+#include <vector>
+
 GODOT_WARNING_DISABLE()
 #include <godot_cpp/classes/ref_counted.hpp>
 GODOT_WARNING_RESTORE()
@@ -20,6 +23,29 @@ using namespace godot;
  * `instances_physics` reports how many instances were created inside `_physics_process`.
  *
  * `total_time_spent_usec` reports the time in microseconds spent to process everything and display the geometry on the screen.
+ *
+ * `draw_lock_contentions` reports how many times `draw_*` calls had to wait for another thread in the last frame.
+ *
+ * `deferred_draw_commands` reports how many `draw_*` calls were made outside the main thread in the last frame.
+ * These calls do not lock the geometry storage and are merged into it at the end of the frame.
+ *
+ * `time_filling_tasks_usec` reports the time spent to cull and fill the buffers of all types of geometry,
+ * and `time_filling_task_max_usec` reports the slowest of these tasks.
+ * With `rendering/geometry_fill_threads` enabled, the tasks run in parallel.
+ *
+ * `lines_arena_high_water_bytes` reports the peak memory used by the vertices of instant lines in one frame,
+ * and `lines_slab_high_water_bytes` reports the peak memory used by the vertices of lines with a duration.
+ *
+ * `nodes_label3d_reshapes` reports how many Label3D nodes had to change their text, font, font size or outline size in the last frame.
+ * Other Label3D nodes were reused with the same text and only moved.
+ *
+ * `glyph_text_*` are the same as `nodes_label3d_*`, but for the text drawn with DebugDraw3DConfig.set_use_glyph_atlas_for_text.
+ * `glyph_text_quads` reports how many glyphs are drawn, and `glyph_text_batches` how many MultiMeshes are used to draw them.
+ *
+ * The totals above can be broken down by the type of geometry with `get_geometry_*` methods.
+ * Each of them returns an array with one value per name from get_geometry_type_names, where the lines are the last entry.
+ * get_viewport_ids and get_viewport_culling_usec report the time spent to cull the geometry of each Viewport.
+ * In builds with Tracy enabled, these values are also sent as plots every frame.
  */
 class DebugDraw3DStats : public RefCounted {
 	GDCLASS(DebugDraw3DStats, RefCounted)
@@ -56,33 +82,149 @@ public:                                      \
 	DEFINE_DEFAULT_PROP(time_culling_lines_usec, int64_t, 0);
 	DEFINE_DEFAULT_PROP(total_time_culling_usec, int64_t, 0);
 
+	DEFINE_DEFAULT_PROP(time_filling_tasks_usec, int64_t, 0);
+	DEFINE_DEFAULT_PROP(time_filling_task_max_usec, int64_t, 0);
+
+	DEFINE_DEFAULT_PROP(lines_arena_high_water_bytes, int64_t, 0);
+	DEFINE_DEFAULT_PROP(lines_slab_high_water_bytes, int64_t, 0);
+
 	DEFINE_DEFAULT_PROP(total_time_spent_usec, int64_t, 0);
 
 	DEFINE_DEFAULT_PROP(created_scoped_configs, int64_t, 0);
 	DEFINE_DEFAULT_PROP(orphan_scoped_configs, int64_t, 0);
 
+	DEFINE_DEFAULT_PROP(draw_lock_contentions, int64_t, 0);
+	DEFINE_DEFAULT_PROP(deferred_draw_commands, int64_t, 0);
+	DEFINE_DEFAULT_PROP(thread_command_buffers, int64_t, 0);
+
 	DEFINE_DEFAULT_PROP(nodes_label3d_visible, int64_t, 0);
 	DEFINE_DEFAULT_PROP(nodes_label3d_visible_physics, int64_t, 0);
 	DEFINE_DEFAULT_PROP(nodes_label3d_exists, int64_t, 0);
 	DEFINE_DEFAULT_PROP(nodes_label3d_exists_physics, int64_t, 0);
 	DEFINE_DEFAULT_PROP(nodes_label3d_exists_total, int64_t, 0);
+	DEFINE_DEFAULT_PROP(nodes_label3d_reshapes, int64_t, 0);
+
+	DEFINE_DEFAULT_PROP(glyph_text_visible, int64_t, 0);
+	DEFINE_DEFAULT_PROP(glyph_text_visible_physics, int64_t, 0);
+	DEFINE_DEFAULT_PROP(glyph_text_quads, int64_t, 0);
+	DEFINE_DEFAULT_PROP(glyph_text_batches, int64_t, 0);
 
 #undef DEFINE_DEFAULT_PROP
 
+public:
+	/// @private
+	/// All InstanceType and the lines as the last one
+	static constexpr int GEOMETRY_TYPES_COUNT = (int)InstanceType::MAX + 1;
+	/// @private
+	static const char *const GEOMETRY_TYPE_NAMES[GEOMETRY_TYPES_COUNT];
+
+	/// @private
+	struct GeometryTypeStats {
+		int64_t capacity = 0;
+		int64_t used = 0;
+		int64_t visible = 0;
+		int64_t uploaded_bytes = 0;
+	};
+
+	/// @private
+	struct ViewportStats {
+		uint64_t viewport_id = 0;
+		int64_t culling_usec = 0;
+	};
+
+	/// @private
+	/// Snapshot of the stats that are too detailed to be separate properties.
+	struct GeometryBreakdown {
+		GeometryTypeStats types[GEOMETRY_TYPES_COUNT] = {};
+		std::vector<ViewportStats> viewports;
+	};
+
+private:
+	GeometryBreakdown breakdown;
+
+	PackedInt64Array _get_types_field(int64_t GeometryTypeStats::*p_field) const;
+
+public:
 	DebugDraw3DStats(){};
 
+	/**
+	 * Names of the geometry types in the same order as the values of the `get_geometry_*` arrays.
+	 */
+	PackedStringArray get_geometry_type_names() const;
+	/**
+	 * Number of allocated slots in the pools of each geometry type.
+	 */
+	PackedInt64Array get_geometry_capacity() const;
+	/**
+	 * Number of used slots in the pools of each geometry type.
+	 */
+	PackedInt64Array get_geometry_used() const;
+	/**
+	 * Number of visible instances of each geometry type. For the lines, the number of visible line batches.
+	 */
+	PackedInt64Array get_geometry_visible() const;
+	/**
+	 * Number of bytes sent to the GPU buffers of each geometry type in the last frame.
+	 */
+	PackedInt64Array get_geometry_uploaded_bytes() const;
+	/**
+	 * Instance IDs of the viewports in the same order as get_viewport_culling_usec.
+	 */
+	PackedInt64Array get_viewport_ids() const;
+	/**
+	 * Time in microseconds spent to cull the geometry of each Viewport from get_viewport_ids.
+	 */
+	PackedInt64Array get_viewport_culling_usec() const;
+
+	/// @private
+	const GeometryBreakdown &get_breakdown() const {
+		return breakdown;
+	}
+
+	/// @private
+	void set_breakdown_stats(const GeometryBreakdown &p_breakdown);
+
+#ifdef TRACY_ENABLE
+	/// @private
+	void plot_breakdown() const;
+#endif
+
 	/// @private
 	void set_nodes_stats(
 			const int64_t &p_nodes_label3d_visible,
 			const int64_t &p_nodes_label3d_visible_physics,
 			const int64_t &p_nodes_label3d_exists,
-			const int64_t &p_nodes_label3d_exists_physics);
+			const int64_t &p_nodes_label3d_exists_physics,
+			const int64_t &p_nodes_label3d_reshapes);
+
+	/// @private
+	void set_glyph_text_stats(
+			const int64_t &p_glyph_text_visible,
+			const int64_t &p_glyph_text_visible_physics,
+			const int64_t &p_glyph_text_quads,
+			const int64_t &p_glyph_text_batches);
 
 	/// @private
 	void set_scoped_config_stats(
 			const int64_t &p_created_scoped_configs,
 			const int64_t &p_orphan_scoped_configs);
 
+	/// @private
+	void set_threading_stats(
+			const int64_t &p_draw_lock_contentions,
+			const int64_t &p_deferred_draw_commands,
+			const int64_t &p_thread_command_buffers);
+
+	/// @private
+	void set_filling_tasks_stats(
+			const int64_t &p_time_filling_tasks_usec,
+			const int64_t &p_time_filling_task_max_usec);
+
+	/// @private
+	void set_lines_memory_stats(
+			const int64_t &p_lines_arena_high_water_bytes,
+			const int64_t &p_lines_slab_high_water_bytes);
+
 	/// @private
 	void set_render_stats(
 			const int64_t &p_instances,
@@ -0,0 +1,460 @@
+#include "text_glyphs_container.h"
+
+#ifndef DISABLE_DEBUG_RENDERING
+#include "debug_draw_3d.h"
+#include "geometry_generators.h"
+
+#include <algorithm>
+
+GODOT_WARNING_DISABLE()
+#include <godot_cpp/classes/rendering_server.hpp>
+#include <godot_cpp/classes/text_server_manager.hpp>
+#include <godot_cpp/classes/theme_db.hpp>
+#include <godot_cpp/templates/hashfuncs.hpp>
+GODOT_WARNING_RESTORE()
+using namespace godot;
+
+// Transform, color and custom data
+constexpr int32_t GLYPH_INSTANCE_FLOAT_COUNT = 12 + 4 + 4;
+
+TextGlyphsContainer::TextGlyphsContainer(DebugDraw3D *p_owner, bool p_no_depth_test) {
+	ZoneScoped;
+	owner = p_owner;
+	no_depth_test = p_no_depth_test;
+
+	Ref<ShaderMaterial> mat = owner->get_material_variant(MeshMaterialType::Text, no_depth_test ? MeshMaterialVariant::NoDepth : MeshMaterialVariant::Normal);
+	if (mat.is_valid()) {
+		shader = mat->get_shader();
+		render_priority = mat->get_render_priority();
+	}
+
+	quad_mesh = GeometryGenerator::CreateMeshNative(Mesh::PrimitiveType::PRIMITIVE_TRIANGLES, GeometryGenerator::CenteredSquareVertexes, GeometryGenerator::SquareBackwardsIndexes);
+}
+
+TextGlyphsContainer::~TextGlyphsContainer() {
+	ZoneScoped;
+	clear();
+}
+
+size_t TextGlyphsContainer::LayoutKeyHasher::operator()(const LayoutKey &p_key) const {
+	uint32_t h = hash_murmur3_one_64((uint64_t)p_key.font);
+	h = hash_murmur3_one_32(p_key.size, h);
+	h = hash_murmur3_one_32(p_key.outline_size, h);
+	return (size_t)((uint64_t)h << 32 | p_key.text.hash());
+}
+
+TextGlyphsContainer::TextLayout *TextGlyphsContainer::_get_layout(const Ref<Font> &p_font, const String &p_text, int p_size, int p_outline_size) {
+	ZoneScoped;
+	auto [it, is_new] = layouts.try_emplace(LayoutKey{ p_font.ptr(), p_size, p_outline_size, p_text });
+	TextLayout &layout = it->second;
+	layout.last_used_frame = frame;
+
+	if (is_new) {
+		layout.font = p_font;
+		layout.text = p_text;
+		layout.size = p_size;
+		layout.outline_size = p_outline_size;
+		owner->_track_font(p_font);
+		_build_layout(layout);
+	}
+
+	return layout.is_supported ? &layout : nullptr;
+}
+
+void TextGlyphsContainer::_build_layout(TextLayout &p_layout) {
+	ZoneScoped;
+	TextServer *ts = TextServerManager::get_singleton()->get_primary_interface().ptr();
+
+	p_layout.is_supported = false;
+	if (!ts) {
+		return;
+	}
+
+	std::vector<RID> font_rids;
+	{
+		TypedArray<RID> rids = p_layout.font->get_rids();
+		font_rids.reserve(rids.size());
+		for (int64_t i = 0; i < rids.size(); i++) {
+			RID rid = rids[i];
+			// Distance fields require a different shader
+			if (ts->font_is_multichannel_signed_distance_field(rid)) {
+				return;
+			}
+			font_rids.push_back(rid);
+		}
+	}
+
+	if (font_rids.empty()) {
+		return;
+	}
+	p_layout.is_supported = true;
+
+	struct LineGlyph {
+		RID font;
+		int64_t index;
+		real_t advance;
+	};
+
+	Vector2 max_extents;
+	auto add_quad = [&](const LineGlyph &p_glyph, const Vector2 &p_pen, int p_outline) {
+		const Vector2i size_key(p_layout.size, p_outline);
+		// Also renders the glyph into the cache
+		RID texture = ts->font_get_glyph_texture_rid(p_glyph.font, size_key, p_glyph.index);
+		if (!texture.is_valid()) {
+			return;
+		}
+
+		const Vector2 texture_size = ts->font_get_glyph_texture_size(p_glyph.font, size_key, p_glyph.index);
+		if (texture_size.x <= 0 || texture_size.y <= 0) {
+			return;
+		}
+
+		const Rect2 uv = ts->font_get_glyph_uv_rect(p_glyph.font, size_key, p_glyph.index);
+		const Vector2 glyph_size = ts->font_get_glyph_size(p_glyph.font, size_key, p_glyph.index);
+		const Vector2 top_left = p_pen + ts->font_get_glyph_offset(p_glyph.font, size_key, p_glyph.index);
+
+		GlyphQuad q;
+		// Glyph metrics are in pixels with Y pointing down
+		q.offset = Vector2(top_left.x, -(top_left.y + glyph_size.y)) * PIXEL_SIZE;
+		q.size = glyph_size * PIXEL_SIZE;
+		q.uv = Vector4(uv.position.x / texture_size.x, uv.position.y / texture_size.y, uv.get_end().x / texture_size.x, uv.get_end().y / texture_size.y);
+		q.batch = _get_batch(texture, p_outline > 0);
+
+		if (std::find(p_layout.batches.begin(), p_layout.batches.end(), q.batch) == p_layout.batches.end()) {
+			p_layout.batches.push_back(q.batch);
+			q.batch->layouts_count++;
+		}
+
+		const Vector2 end = q.offset + q.size;
+		max_extents.x = Math::max(max_extents.x, Math::max(Math::abs(q.offset.x), Math::abs(end.x)));
+		max_extents.y = Math::max(max_extents.y, Math::max(Math::abs(q.offset.y), Math::abs(end.y)));
+		p_layout.quads.push_back(q);
+	};
+
+	const RID primary = font_rids[0];
+	const real_t ascent = (real_t)ts->font_get_ascent(primary, p_layout.size);
+	const real_t line_height = ascent + (real_t)ts->font_get_descent(primary, p_layout.size);
+
+	PackedStringArray lines = p_layout.text.split("\n");
+	const real_t total_height = line_height * lines.size();
+
+	std::vector<LineGlyph> line_glyphs;
+	for (int64_t l = 0; l < lines.size(); l++) {
+		const String &line = lines[l];
+		line_glyphs.clear();
+		line_glyphs.reserve(line.length());
+
+		real_t width = 0;
+		for (int64_t i = 0; i < line.length(); i++) {
+			LineGlyph g = { primary, 0, 0 };
+			for (const RID &rid : font_rids) {
+				int64_t index = ts->font_get_glyph_index(rid, p_layout.size, line[i], 0);
+				if (index) {
+					g.font = rid;
+					g.index = index;
+					break;
+				}
+			}
+
+			g.advance = ts->font_get_glyph_advance(g.font, p_layout.size, g.index).x;
+			width += g.advance;
+			line_glyphs.push_back(g);
+		}
+
+		// Centered like Label3D with the default alignment
+		Vector2 pen(-width * 0.5f, line_height * l - total_height * 0.5f + ascent);
+		for (const LineGlyph &g : line_glyphs) {
+			if (p_layout.outline_size > 0) {
+				add_quad(g, pen, p_layout.outline_size);
+			}
+			add_quad(g, pen, 0);
+			pen.x += g.advance;
+		}
+	}
+
+	p_layout.radius = max_extents.length();
+}
+
+void TextGlyphsContainer::_release_layout(TextLayout &p_layout) {
+	for (GlyphsBatch *b : p_layout.batches) {
+		b->layouts_count--;
+	}
+	p_layout.batches.clear();
+	p_layout.quads.clear();
+	p_layout.radius = 0;
+}
+
+void TextGlyphsContainer::_rebuild_layouts() {
+	ZoneScoped;
+	// Labels keep pointers to the layouts, so they are rebuilt in place
+	for (auto &l : layouts) {
+		_release_layout(l.second);
+		_build_layout(l.second);
+	}
+
+	// Textures of the old glyphs may no longer exist
+	for (auto it = batches.begin(); it != batches.end();) {
+		GlyphsBatch &b = **it;
+		if (!b.layouts_count) {
+			_free_batch(b);
+			it = batches.erase(it);
+		} else {
+			it++;
+		}
+	}
+	fonts_generation = owner->fonts_generation;
+}
+
+TextGlyphsContainer::GlyphsBatch *TextGlyphsContainer::_get_batch(const RID &p_texture, bool p_is_outline) {
+	for (auto &b : batches) {
+		if (b->texture == p_texture && b->is_outline == p_is_outline) {
+			return b.get();
+		}
+	}
+
+	ZoneScopedN("Create batch");
+	RenderingServer *rs = RenderingServer::get_singleton();
+	auto b = std::make_unique<GlyphsBatch>();
+	b->texture = p_texture;
+	b->is_outline = p_is_outline;
+	b->last_used_frame = frame;
+
+	b->material = rs->material_create();
+	rs->material_set_shader(b->material, shader->get_rid());
+	rs->material_set_param(b->material, "glyph_atlas", p_texture);
+	// The text is drawn over the outline
+	rs->material_set_render_priority(b->material, Math::clamp(render_priority + (p_is_outline ? 0 : 1), (int)RenderingServer::MATERIAL_RENDER_PRIORITY_MIN, (int)RenderingServer::MATERIAL_RENDER_PRIORITY_MAX));
+
+	b->multimesh = rs->multimesh_create();
+	rs->multimesh_set_mesh(b->multimesh, quad_mesh->get_rid());
+
+	b->instance = rs->instance_create();
+	rs->instance_set_base(b->instance, b->multimesh);
+	rs->instance_set_scenario(b->instance, scenario);
+	rs->instance_set_layer_mask(b->instance, render_layers);
+	rs->instance_geometry_set_material_override(b->instance, b->material);
+	rs->instance_geometry_set_cast_shadows_setting(b->instance, RenderingServer::SHADOW_CASTING_SETTING_OFF);
+	rs->instance_geometry_set_flag(b->instance, RenderingServer::INSTANCE_FLAG_USE_DYNAMIC_GI, false);
+	rs->instance_geometry_set_flag(b->instance, RenderingServer::INSTANCE_FLAG_USE_BAKED_LIGHT, false);
+
+	batches.push_back(std::move(b));
+	return batches.back().get();
+}
+
+void TextGlyphsContainer::_free_batch(GlyphsBatch &p_batch) {
+	ZoneScoped;
+	RenderingServer *rs = RenderingServer::get_singleton();
+	rs->free_rid(p_batch.instance);
+	rs->free_rid(p_batch.multimesh);
+	rs->free_rid(p_batch.material);
+}
+
+void TextGlyphsContainer::_update_batch(GlyphsBatch &p_batch) {
+	ZoneScoped;
+	if (!p_batch.count && !p_batch.prev_count) {
+		return;
+	}
+
+	RenderingServer *rs = RenderingServer::get_singleton();
+	const int32_t buffer_capacity = (int32_t)(p_batch.buffer.size() / GLYPH_INSTANCE_FLOAT_COUNT);
+	if (p_batch.capacity != buffer_capacity) {
+		ZoneScopedN("Allocate instances");
+		p_batch.capacity = buffer_capacity;
+		rs->multimesh_allocate_data(p_batch.multimesh, p_batch.capacity, RenderingServer::MULTIMESH_TRANSFORM_3D, true, true);
+	}
+
+	rs->multimesh_set_visible_instances(p_batch.multimesh, p_batch.count);
+	if (p_batch.count) {
+		rs->multimesh_set_buffer(p_batch.multimesh, p_batch.buffer);
+		rs->instance_set_custom_aabb(p_batch.instance, p_batch.bounds);
+	}
+	p_batch.prev_count = p_batch.count;
+}
+
+void TextGlyphsContainer::set_world(Ref<World3D> p_new_world) {
+	ZoneScoped;
+	scenario = p_new_world.is_valid() ? p_new_world->get_scenario() : RID();
+
+	RenderingServer *rs = RenderingServer::get_singleton();
+	for (auto &b : batches) {
+		rs->instance_set_scenario(b->instance, scenario);
+	}
+}
+
+void TextGlyphsContainer::set_render_layer_mask(int32_t p_layers) {
+	ZoneScoped;
+	if (render_layers != p_layers) {
+		RenderingServer *rs = RenderingServer::get_singleton();
+		for (auto &b : batches) {
+			rs->instance_set_layer_mask(b->instance, p_layers);
+		}
+		render_layers = p_layers;
+	}
+}
+
+bool TextGlyphsContainer::add_or_update_text(const DebugDraw3DScopeConfig::Data *p_cfg, const Vector3 &p_position, const String &p_text, int p_size, const Color &p_color, const real_t &p_duration, ProcessType p_proc) {
+	ZoneScoped;
+	if (shader.is_null()) {
+		return false;
+	}
+
+	Ref<Font> font = p_cfg->text_font.is_valid() ? p_cfg->text_font : ThemeDB::get_singleton()->get_fallback_font();
+	if (font.is_null()) {
+		return false;
+	}
+
+	LOCK_GUARD(owner->datalock);
+	TextLayout *layout = _get_layout(font, p_text, p_size, p_cfg->text_outline_size);
+	if (!layout) {
+		return false;
+	}
+
+	items[(int)p_proc].push_back({ p_position, p_color, p_cfg->text_outline_color, layout, p_duration, false });
+	return true;
+}
+
+void TextGlyphsContainer::update_expiration(double p_delta, ProcessType p_proc) {
+	ZoneScoped;
+	LOCK_GUARD(owner->datalock);
+
+	auto &list = items[(int)p_proc];
+	const bool is_physics = p_proc == ProcessType::PHYSICS_PROCESS;
+
+	size_t last = 0;
+	for (size_t i = 0; i < list.size(); i++) {
+		TextItem &item = list[i];
+		if (is_physics ? item.is_expired_physics() : item.is_expired()) {
+			continue;
+		}
+
+		item.expiration_time -= p_delta;
+		item.is_used_one_time = true;
+		if (last != i) {
+			list[last] = item;
+		}
+		last++;
+	}
+	list.resize(last);
+}
+
+void TextGlyphsContainer::update_geometry() {
+	ZoneScoped;
+	LOCK_GUARD(owner->datalock);
+	frame++;
+
+	if (fonts_generation != owner->fonts_generation) {
+		_rebuild_layouts();
+	}
+
+	for (auto &b : batches) {
+		b->count = 0;
+		b->bounds = AABB();
+		b->buffer_w = b->buffer.ptrw();
+	}
+
+	{
+		ZoneScopedN("Fill buffers");
+		visible_quads = 0;
+
+		for (int p = 0; p < (int)ProcessType::MAX; p++) {
+			visible_count[p] = items[p].size();
+
+			for (const TextItem &item : items[p]) {
+				TextLayout *layout = item.layout;
+				layout->last_used_frame = frame;
+
+				const AABB label_bounds(item.position - Vector3(layout->radius, layout->radius, layout->radius), Vector3(layout->radius, layout->radius, layout->radius) * 2);
+				for (GlyphsBatch *b : layout->batches) {
+					b->bounds = b->count ? b->bounds.merge(label_bounds) : label_bounds;
+					b->last_used_frame = frame;
+				}
+
+				for (const GlyphQuad &q : layout->quads) {
+					GlyphsBatch &b = *q.batch;
+					if ((int64_t)(b.count + 1) * GLYPH_INSTANCE_FLOAT_COUNT > b.buffer.size()) {
+						b.buffer.resize((int64_t)Math::max(b.count * 2, 64) * GLYPH_INSTANCE_FLOAT_COUNT);
+						b.buffer_w = b.buffer.ptrw();
+					}
+
+					// The shader reads the quad size from the diagonal of the basis and the offset from its third column
+					const Color &c = b.is_outline ? item.outline_color : item.color;
+					float *w = b.buffer_w + (int64_t)b.count++ * GLYPH_INSTANCE_FLOAT_COUNT;
+					w[0] = (float)q.size.x;
+					w[1] = 0;
+					w[2] = (float)q.offset.x;
+					w[3] = (float)item.position.x;
+					w[4] = 0;
+					w[5] = (float)q.size.y;
+					w[6] = (float)q.offset.y;
+					w[7] = (float)item.position.y;
+					w[8] = 0;
+					w[9] = 0;
+					w[10] = 1;
+					w[11] = (float)item.position.z;
+					w[12] = c.r;
+					w[13] = c.g;
+					w[14] = c.b;
+					w[15] = c.a;
+					w[16] = (float)q.uv.x;
+					w[17] = (float)q.uv.y;
+					w[18] = (float)q.uv.z;
+					w[19] = (float)q.uv.w;
+				}
+				visible_quads += layout->quads.size();
+			}
+		}
+	}
+
+	{
+		ZoneScopedN("Remove unused layouts");
+		for (auto it = layouts.begin(); it != layouts.end();) {
+			if (frame - it->second.last_used_frame > FRAMES_TO_KEEP_UNUSED_LAYOUT) {
+				_release_layout(it->second);
+				it = layouts.erase(it);
+			} else {
+				it++;
+			}
+		}
+
+		for (auto it = batches.begin(); it != batches.end();) {
+			GlyphsBatch &b = **it;
+			if (!b.layouts_count && frame - b.last_used_frame > FRAMES_TO_KEEP_UNUSED_BATCH) {
+				_free_batch(b);
+				it = batches.erase(it);
+			} else {
+				it++;
+			}
+		}
+	}
+
+	for (auto &b : batches) {
+		_update_batch(*b);
+		b->buffer_w = nullptr;
+	}
+}
+
+void TextGlyphsContainer::clear() {
+	ZoneScoped;
+	LOCK_GUARD(owner->datalock);
+
+	for (auto &i : items) {
+		i.clear();
+	}
+
+	for (auto &l : layouts) {
+		_release_layout(l.second);
+	}
+	layouts.clear();
+
+	for (auto &b : batches) {
+		_free_batch(*b);
+	}
+	batches.clear();
+
+	for (auto &c : visible_count) {
+		c = 0;
+	}
+	visible_quads = 0;
+}
+
+#endif
@@ -0,0 +1,167 @@
+#pragma once
+#ifndef DISABLE_DEBUG_RENDERING
+
+#include "config_scope_3d.h"
+#include "render_instances_enums.h"
+#include "utils/utils.h"
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+GODOT_WARNING_DISABLE()
+#include <godot_cpp/classes/array_mesh.hpp>
+#include <godot_cpp/classes/font.hpp>
+#include <godot_cpp/classes/shader.hpp>
+#include <godot_cpp/classes/world3d.hpp>
+GODOT_WARNING_RESTORE()
+using namespace godot;
+
+/**
+ * Draws 3D text without nodes.
+ *
+ * Glyphs are taken from the textures of the font cache, which already serve as atlases,
+ * and every glyph is drawn as a billboard quad. All quads that use the same texture are drawn by one MultiMesh.
+ * Layouts of the same text with the same font options are shared between labels.
+ * All layouts are rebuilt when any of the used fonts is changed, e.g. when its cache is cleared.
+ */
+class TextGlyphsContainer {
+	class DebugDraw3D *owner;
+
+	/// Same as the default `Label3D.pixel_size`.
+	static constexpr real_t PIXEL_SIZE = 0.005f;
+	enum : uint32_t {
+		FRAMES_TO_KEEP_UNUSED_LAYOUT = 60,
+		FRAMES_TO_KEEP_UNUSED_BATCH = 300,
+	};
+
+	/// Quads of all glyphs that are in the same texture.
+	struct GlyphsBatch {
+		RID texture;
+		bool is_outline;
+
+		RID material;
+		RID multimesh;
+		RID instance;
+		PackedFloat32Array buffer;
+		float *buffer_w = nullptr;
+		int32_t capacity = 0;
+		int32_t count = 0;
+		int32_t prev_count = 0;
+		AABB bounds;
+
+		// Number of layouts that have quads in this batch
+		size_t layouts_count = 0;
+		uint64_t last_used_frame = 0;
+	};
+
+	struct GlyphQuad {
+		// Bottom left corner relative to the label position
+		Vector2 offset;
+		Vector2 size;
+		// Normalized UV of the top left and bottom right corners
+		Vector4 uv;
+		GlyphsBatch *batch;
+	};
+
+	/// Layouts are shared only if all of these are equal, not just their hashes.
+	struct LayoutKey {
+		// The layout holds a reference to the font, so the pointer cannot be reused while the key exists
+		const Font *font;
+		int size;
+		int outline_size;
+		String text;
+
+		bool operator==(const LayoutKey &p_other) const {
+			return font == p_other.font && size == p_other.size && outline_size == p_other.outline_size && text == p_other.text;
+		}
+	};
+
+	struct LayoutKeyHasher {
+		size_t operator()(const LayoutKey &p_key) const;
+	};
+
+	struct TextLayout {
+		Ref<Font> font;
+		String text;
+		int size = 0;
+		int outline_size = 0;
+
+		std::vector<GlyphQuad> quads;
+		std::vector<GlyphsBatch *> batches;
+		real_t radius = 0;
+		bool is_supported = true;
+		uint64_t last_used_frame = 0;
+	};
+
+	struct TextItem {
+		Vector3 position;
+		Color color;
+		Color outline_color;
+		TextLayout *layout;
+		double expiration_time;
+		bool is_used_one_time;
+
+		_FORCE_INLINE_ bool is_expired() const {
+			return expiration_time < 0 ? is_used_one_time : false;
+		}
+
+		_FORCE_INLINE_ bool is_expired_physics() const {
+			return expiration_time <= 0;
+		}
+	};
+
+	bool no_depth_test = false;
+	int32_t render_layers = 1;
+	int render_priority = 0;
+	RID scenario;
+	Ref<Shader> shader;
+	Ref<ArrayMesh> quad_mesh;
+
+	uint64_t frame = 0;
+	// `DebugDraw3D::fonts_generation` the layouts were built with
+	uint64_t fonts_generation = 0;
+	std::unordered_map<LayoutKey, TextLayout, LayoutKeyHasher> layouts;
+	std::vector<std::unique_ptr<GlyphsBatch> > batches;
+	std::vector<TextItem> items[(int)ProcessType::MAX];
+
+	size_t visible_count[(int)ProcessType::MAX] = {};
+	size_t visible_quads = 0;
+
+	TextLayout *_get_layout(const Ref<Font> &p_font, const String &p_text, int p_size, int p_outline_size);
+	void _build_layout(TextLayout &p_layout);
+	void _release_layout(TextLayout &p_layout);
+	void _rebuild_layouts();
+	GlyphsBatch *_get_batch(const RID &p_texture, bool p_is_outline);
+	void _free_batch(GlyphsBatch &p_batch);
+	void _update_batch(GlyphsBatch &p_batch);
+
+public:
+	TextGlyphsContainer(class DebugDraw3D *p_owner, bool p_no_depth_test);
+	~TextGlyphsContainer();
+
+	void set_world(Ref<World3D> p_new_world);
+	void set_render_layer_mask(int32_t p_layers);
+
+	/// Returns false if the text cannot be drawn with glyph quads, e.g. with MSDF fonts.
+	bool add_or_update_text(const DebugDraw3DScopeConfig::Data *p_cfg, const Vector3 &p_position, const String &p_text, int p_size, const Color &p_color, const real_t &p_duration, ProcessType p_proc);
+	/// Removes the expired labels and advances the timers of the rest.
+	void update_expiration(double p_delta, ProcessType p_proc);
+	/// Fills the buffers of all batches with the quads of the existing labels.
+	void update_geometry();
+	void clear();
+
+	_FORCE_INLINE_ size_t get_visible_count(ProcessType p_proc) const {
+		return visible_count[(int)p_proc];
+	}
+
+	_FORCE_INLINE_ size_t get_visible_quads() const {
+		return visible_quads;
+	}
+
+	_FORCE_INLINE_ size_t get_batches_count() const {
+		return batches.size();
+	}
+};
+
+#endif
@@ -0,0 +1,208 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <memory>
+
+/**
+ * Unbounded single-producer/single-consumer buffer.
+ *
+ * The producer thread only appends to the tail chunk and the consumer thread only reads from the head chunk,
+ * so neither side needs a lock. Fully consumed chunks are recycled through a single spare slot.
+ */
+template <typename TValue, size_t CHUNK_SIZE = 256>
+class AppendOnlyBuffer {
+	struct Chunk {
+		std::array<TValue, CHUNK_SIZE> items;
+		std::atomic<size_t> count;
+		std::atomic<Chunk *> next;
+
+		Chunk() :
+				items(),
+				count(0),
+				next(nullptr) {
+		}
+	};
+
+	// Consumer side
+	Chunk *head;
+	size_t head_read;
+
+	// Producer side
+	Chunk *tail;
+
+	// Shared
+	std::atomic<Chunk *> spare;
+
+public:
+	AppendOnlyBuffer() :
+			head(new Chunk()),
+			head_read(0),
+			spare(nullptr) {
+		tail = head;
+	}
+
+	~AppendOnlyBuffer() {
+		while (head) {
+			Chunk *next = head->next.load(std::memory_order_relaxed);
+			delete head;
+			head = next;
+		}
+		delete spare.load(std::memory_order_relaxed);
+	}
+
+	AppendOnlyBuffer(const AppendOnlyBuffer &) = delete;
+	AppendOnlyBuffer &operator=(const AppendOnlyBuffer &) = delete;
+
+	/// Must be called only from the producer thread.
+	void push(TValue &&p_v) {
+		size_t c = tail->count.load(std::memory_order_relaxed);
+		if (c == CHUNK_SIZE) {
+			Chunk *n = spare.exchange(nullptr, std::memory_order_acquire);
+			if (!n) {
+				n = new Chunk();
+			}
+			tail->next.store(n, std::memory_order_release);
+			tail = n;
+			c = 0;
+		}
+
+		tail->items[c] = std::move(p_v);
+		tail->count.store(c + 1, std::memory_order_release);
+	}
+
+	/// Must be called only from the consumer thread. Returns the number of consumed values.
+	template <typename TFunc>
+	size_t consume(TFunc p_func) {
+		size_t consumed = 0;
+		while (true) {
+			const size_t c = head->count.load(std::memory_order_acquire);
+			for (; head_read < c; head_read++) {
+				p_func(head->items[head_read]);
+				head->items[head_read] = TValue();
+				consumed++;
+			}
+
+			if (head_read != CHUNK_SIZE) {
+				break;
+			}
+
+			Chunk *next = head->next.load(std::memory_order_acquire);
+			if (!next) {
+				break;
+			}
+
+			// The producer has already moved to the next chunk, so this one can be recycled.
+			Chunk *old = head;
+			head = next;
+			head_read = 0;
+
+			old->count.store(0, std::memory_order_relaxed);
+			old->next.store(nullptr, std::memory_order_relaxed);
+			delete spare.exchange(old, std::memory_order_release);
+		}
+		return consumed;
+	}
+};
+
+/**
+ * Single-producer/single-consumer storage for the arrays referenced by the values of an AppendOnlyBuffer.
+ *
+ * The producer copies arrays into the tail chunk, so pushing an array does not allocate memory in most cases.
+ * The consumer must consume the arrays in the order they were pushed and call `release_before` for each of them,
+ * which recycles the chunks that are no longer referenced. Arrays larger than a chunk get their own chunk.
+ */
+template <typename TValue, size_t CHUNK_SIZE = 4096>
+class AppendOnlyArena {
+public:
+	struct Chunk {
+		std::unique_ptr<TValue[]> items;
+		size_t capacity;
+		size_t used;
+		std::atomic<Chunk *> next;
+
+		Chunk(size_t p_capacity) :
+				items(new TValue[p_capacity]),
+				capacity(p_capacity),
+				used(0),
+				next(nullptr) {
+		}
+	};
+
+private:
+	// Consumer side
+	Chunk *head;
+
+	// Producer side
+	Chunk *tail;
+
+	// Shared
+	std::atomic<Chunk *> spare;
+
+	void _recycle(Chunk *p_chunk) {
+		if (p_chunk->capacity != CHUNK_SIZE) {
+			delete p_chunk;
+			return;
+		}
+
+		p_chunk->used = 0;
+		p_chunk->next.store(nullptr, std::memory_order_relaxed);
+		delete spare.exchange(p_chunk, std::memory_order_release);
+	}
+
+public:
+	AppendOnlyArena() :
+			head(new Chunk(CHUNK_SIZE)),
+			spare(nullptr) {
+		tail = head;
+	}
+
+	~AppendOnlyArena() {
+		while (head) {
+			Chunk *next = head->next.load(std::memory_order_relaxed);
+			delete head;
+			head = next;
+		}
+		delete spare.load(std::memory_order_relaxed);
+	}
+
+	AppendOnlyArena(const AppendOnlyArena &) = delete;
+	AppendOnlyArena &operator=(const AppendOnlyArena &) = delete;
+
+	/// Must be called only from the producer thread. Returns the copy of `p_values` and its chunk in `r_chunk`.
+	/// The copy is visible to the consumer after the value that references it is pushed to the AppendOnlyBuffer.
+	TValue *push(const TValue *p_values, size_t p_count, Chunk **r_chunk) {
+		if (tail->capacity - tail->used < p_count) {
+			Chunk *n = nullptr;
+			if (p_count <= CHUNK_SIZE) {
+				n = spare.exchange(nullptr, std::memory_order_acquire);
+			}
+			if (!n) {
+				n = new Chunk(p_count > CHUNK_SIZE ? p_count : CHUNK_SIZE);
+			}
+			tail->next.store(n, std::memory_order_release);
+			tail = n;
+		}
+
+		TValue *res = tail->items.get() + tail->used;
+		std::copy(p_values, p_values + p_count, res);
+		tail->used += p_count;
+		*r_chunk = tail;
+		return res;
+	}
+
+	/// Must be called only from the consumer thread. Recycles all the chunks pushed before `p_chunk`.
+	void release_before(Chunk *p_chunk) {
+		while (head != p_chunk) {
+			Chunk *next = head->next.load(std::memory_order_acquire);
+			if (!next) {
+				break;
+			}
+
+			Chunk *old = head;
+			head = next;
+			_recycle(old);
+		}
+	}
+};
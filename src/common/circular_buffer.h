@@ -67,21 +67,27 @@ public:
 		buffer[end++] = p_v;
 
 		if (end == buf_size) {
-			_is_filled = true;
 			end = 0;
 		}
+		// The oldest value is always right after the newest one in a filled buffer
 		if (_is_filled) {
-			if (++start == buf_size) {
-				start = 0;
-			}
+			start = end;
+		} else if (end == start) {
+			_is_filled = true;
 		}
 	}
 
+	/// Returns the value that will be overwritten by the next `add`, if the buffer is filled.
+	TValue get_oldest() const {
+		return buffer[start];
+	}
+
 	TValue get(const size_t &p_idx) const {
 		const size_t pos = start + p_idx;
 		return buffer[pos >= buf_size ? pos - buf_size : pos];
 	}
 
+	/// Scans the whole buffer. RollingStats gives the same values without scanning.
 	void get_min_max_avg(TValue *p_min, TValue *p_max, TValue *p_avg) {
 		if (size()) {
 			TValue sum = get(0);
@@ -92,7 +98,8 @@ public:
 				TValue v = get(i);
 				if (v < *p_min) {
 					*p_min = v;
-				} else if (v > *p_max) {
+				}
+				if (v > *p_max) {
 					*p_max = v;
 				}
 				sum += v;
@@ -0,0 +1,322 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/**
+ * Linear allocator for data that lives until the end of a frame.
+ *
+ * Allocation only moves the offset in the current chunk. `reset` frees everything at once,
+ * and if more than one chunk was needed, they are merged so that the next frame fits into a single chunk.
+ */
+template <class T, size_t MIN_CHUNK_ITEMS = 4096>
+class FrameArena {
+	struct Chunk {
+		std::unique_ptr<T[]> items;
+		size_t capacity;
+	};
+
+	std::vector<Chunk> chunks;
+	size_t current_chunk = 0;
+	size_t offset = 0;
+	size_t used = 0;
+	size_t high_water = 0;
+
+public:
+	FrameArena() = default;
+	FrameArena(const FrameArena &) = delete;
+	FrameArena &operator=(const FrameArena &) = delete;
+
+	T *alloc(size_t p_count) {
+		used += p_count;
+		high_water = std::max(high_water, used);
+
+		while (current_chunk < chunks.size()) {
+			Chunk &c = chunks[current_chunk];
+			if (c.capacity - offset >= p_count) {
+				T *res = c.items.get() + offset;
+				offset += p_count;
+				return res;
+			}
+			current_chunk++;
+			offset = 0;
+		}
+
+		size_t capacity = std::max(std::max(MIN_CHUNK_ITEMS, p_count), get_capacity());
+		chunks.push_back({ std::unique_ptr<T[]>(new T[capacity]), capacity });
+		current_chunk = chunks.size() - 1;
+		offset = p_count;
+		return chunks.back().items.get();
+	}
+
+	/// Invalidates all allocations.
+	void reset() {
+		if (chunks.size() > 1) {
+			size_t capacity = get_capacity();
+			chunks.clear();
+			chunks.push_back({ std::unique_ptr<T[]>(new T[capacity]), capacity });
+		}
+		current_chunk = 0;
+		offset = 0;
+		used = 0;
+	}
+
+	/// Invalidates all allocations and releases the memory.
+	void clear() {
+		chunks.clear();
+		current_chunk = 0;
+		offset = 0;
+		used = 0;
+		high_water = 0;
+	}
+
+	size_t get_capacity() const {
+		size_t res = 0;
+		for (const Chunk &c : chunks) {
+			res += c.capacity;
+		}
+		return res;
+	}
+
+	/// The largest number of items allocated between two resets.
+	size_t get_high_water() const {
+		return high_water;
+	}
+};
+
+/**
+ * Pool of blocks with power-of-two capacities.
+ *
+ * Small blocks are carved out of large slabs. Released blocks are kept in per-size free lists
+ * and reused, so the memory is returned to the system only by `clear`.
+ */
+template <class T, size_t SLAB_ITEMS = 16384>
+class SlabPool {
+	static constexpr size_t MIN_BLOCK_ITEMS = 2;
+	static constexpr int SIZE_CLASSES = 48;
+	// Bigger blocks get their own slab
+	static constexpr size_t MAX_CARVED_ITEMS = SLAB_ITEMS / 8;
+
+	std::vector<std::unique_ptr<T[]> > slabs;
+	std::vector<T *> free_blocks[SIZE_CLASSES];
+	T *current_slab = nullptr;
+	size_t current_slab_offset = SLAB_ITEMS;
+
+	size_t used = 0;
+	size_t high_water = 0;
+
+	static uint8_t _get_size_class(size_t p_count) {
+		uint8_t size_class = 0;
+		while ((MIN_BLOCK_ITEMS << size_class) < p_count) {
+			size_class++;
+		}
+		return size_class;
+	}
+
+	void _release(T *p_ptr, uint8_t p_size_class) {
+		free_blocks[p_size_class].push_back(p_ptr);
+		used -= MIN_BLOCK_ITEMS << p_size_class;
+	}
+
+public:
+	/// Owning handle of a block. Returns the block to the pool when destroyed.
+	class Block {
+		friend class SlabPool;
+
+		SlabPool *pool = nullptr;
+		T *ptr = nullptr;
+		uint8_t size_class = 0;
+
+		Block(SlabPool *p_pool, T *p_ptr, uint8_t p_size_class) :
+				pool(p_pool),
+				ptr(p_ptr),
+				size_class(p_size_class) {}
+
+	public:
+		Block() = default;
+		Block(const Block &) = delete;
+		Block &operator=(const Block &) = delete;
+
+		Block(Block &&p_other) noexcept :
+				pool(p_other.pool),
+				ptr(p_other.ptr),
+				size_class(p_other.size_class) {
+			p_other.pool = nullptr;
+			p_other.ptr = nullptr;
+		}
+
+		Block &operator=(Block &&p_other) noexcept {
+			if (this != &p_other) {
+				reset();
+				pool = p_other.pool;
+				ptr = p_other.ptr;
+				size_class = p_other.size_class;
+				p_other.pool = nullptr;
+				p_other.ptr = nullptr;
+			}
+			return *this;
+		}
+
+		~Block() {
+			reset();
+		}
+
+		void reset() {
+			if (ptr) {
+				pool->_release(ptr, size_class);
+				pool = nullptr;
+				ptr = nullptr;
+			}
+		}
+
+		T *get() const {
+			return ptr;
+		}
+
+		size_t capacity() const {
+			return ptr ? MIN_BLOCK_ITEMS << size_class : 0;
+		}
+	};
+
+	SlabPool() = default;
+	SlabPool(const SlabPool &) = delete;
+	SlabPool &operator=(const SlabPool &) = delete;
+
+	Block alloc(size_t p_count) {
+		uint8_t size_class = _get_size_class(p_count);
+		size_t capacity = MIN_BLOCK_ITEMS << size_class;
+
+		used += capacity;
+		high_water = std::max(high_water, used);
+
+		auto &free_list = free_blocks[size_class];
+		if (free_list.size()) {
+			T *ptr = free_list.back();
+			free_list.pop_back();
+			return Block(this, ptr, size_class);
+		}
+
+		if (capacity > MAX_CARVED_ITEMS) {
+			slabs.push_back(std::unique_ptr<T[]>(new T[capacity]));
+			return Block(this, slabs.back().get(), size_class);
+		}
+
+		if (SLAB_ITEMS - current_slab_offset < capacity) {
+			slabs.push_back(std::unique_ptr<T[]>(new T[SLAB_ITEMS]));
+			current_slab = slabs.back().get();
+			current_slab_offset = 0;
+		}
+
+		T *ptr = current_slab + current_slab_offset;
+		current_slab_offset += capacity;
+		return Block(this, ptr, size_class);
+	}
+
+	/// Releases all slabs. All blocks must be destroyed before this call.
+	void clear() {
+		slabs.clear();
+		for (auto &f : free_blocks) {
+			f.clear();
+		}
+		current_slab = nullptr;
+		current_slab_offset = SLAB_ITEMS;
+		used = 0;
+		high_water = 0;
+	}
+
+	/// The largest number of items in the blocks that were in use at the same time.
+	size_t get_high_water() const {
+		return high_water;
+	}
+};
+
+/**
+ * STL allocator that keeps released single objects in a per-thread free list.
+ *
+ * It is intended for small objects that are created and destroyed very often, e.g. with `std::allocate_shared`.
+ * An object can be released on any thread, and each thread keeps at most `MAX_CACHED` blocks.
+ */
+template <class T, size_t MAX_CACHED = 64>
+class ThreadCachedAllocator {
+	// Trivially destructible, so it stays valid while the other thread_local objects are destroyed.
+	// Blocks that are released after the thread has freed its cache go straight to `::operator delete`.
+	struct Cache {
+		T *blocks[MAX_CACHED];
+		size_t count;
+		bool is_destroyed;
+	};
+
+	// Frees the cached blocks when the thread exits
+	struct CacheGuard {
+		~CacheGuard() {
+			Cache &cache = _get_cache_storage();
+			for (size_t i = 0; i < cache.count; i++) {
+				::operator delete(cache.blocks[i]);
+			}
+			cache.count = 0;
+			cache.is_destroyed = true;
+		}
+	};
+
+	static Cache &_get_cache_storage() {
+		thread_local Cache cache = {};
+		return cache;
+	}
+
+	/// Returns nullptr if the cache of this thread has already been destroyed.
+	static Cache *_get_cache() {
+		Cache &cache = _get_cache_storage();
+		if (cache.is_destroyed)
+			return nullptr;
+
+		thread_local CacheGuard guard;
+		(void)guard;
+		return &cache;
+	}
+
+public:
+	using value_type = T;
+
+	template <class U>
+	struct rebind {
+		using other = ThreadCachedAllocator<U, MAX_CACHED>;
+	};
+
+	ThreadCachedAllocator() = default;
+
+	template <class U>
+	ThreadCachedAllocator(const ThreadCachedAllocator<U, MAX_CACHED> &) {}
+
+	T *allocate(size_t p_count) {
+		if (p_count == 1) {
+			Cache *cache = _get_cache();
+			if (cache && cache->count) {
+				return cache->blocks[--cache->count];
+			}
+		}
+		return static_cast<T *>(::operator new(p_count * sizeof(T)));
+	}
+
+	void deallocate(T *p_ptr, size_t p_count) {
+		if (p_count == 1) {
+			Cache *cache = _get_cache();
+			if (cache && cache->count < MAX_CACHED) {
+				cache->blocks[cache->count++] = p_ptr;
+				return;
+			}
+		}
+		::operator delete(p_ptr);
+	}
+
+	template <class U>
+	bool operator==(const ThreadCachedAllocator<U, MAX_CACHED> &) const {
+		return true;
+	}
+
+	template <class U>
+	bool operator!=(const ThreadCachedAllocator<U, MAX_CACHED> &) const {
+		return false;
+	}
+};
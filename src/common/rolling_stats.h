@@ -0,0 +1,320 @@
+#pragma once
+
+#include "circular_buffer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <deque>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/**
+ * Histogram with logarithmic buckets for approximate quantiles.
+ *
+ * The relative error of a quantile is not greater than `RELATIVE_ACCURACY`.
+ * Unlike most streaming sketches, values can also be removed, so it works for a sliding window.
+ * Bucket counts are stored in a Fenwick tree, so adding, removing and finding a quantile take O(log n) of the buckets count.
+ */
+class QuantileSketch {
+	static constexpr double RELATIVE_ACCURACY = 0.01;
+	// Values closer to zero are counted in the zero bucket
+	static constexpr double MIN_MAGNITUDE = 1e-9;
+	// Greater values are counted in the last bucket, so the number of buckets is limited
+	static constexpr double MAX_MAGNITUDE = 1e15;
+
+	double gamma;
+	double log_gamma;
+	// Makes the keys of all positive values greater than 0
+	int64_t key_offset;
+
+	// Key of the first bucket
+	int64_t key_low = 0;
+	std::vector<uint32_t> counts;
+	// 1-based Fenwick tree over `counts`
+	std::vector<uint32_t> tree;
+	size_t total = 0;
+
+	int64_t _get_index(const double &p_magnitude) const {
+		return (int64_t)std::ceil(std::log(std::min(p_magnitude, MAX_MAGNITUDE)) / log_gamma);
+	}
+
+	// Keys grow with values, including negative ones
+	int64_t _get_key(const double &p_value) const {
+		if (p_value > MIN_MAGNITUDE)
+			return _get_index(p_value) + key_offset;
+		if (p_value < -MIN_MAGNITUDE)
+			return -(_get_index(-p_value) + key_offset);
+		return 0;
+	}
+
+	double _get_value(const int64_t &p_key) const {
+		if (p_key == 0)
+			return 0;
+
+		const double magnitude = 2 * std::pow(gamma, (double)(std::abs(p_key) - key_offset)) / (1 + gamma);
+		return p_key > 0 ? magnitude : -magnitude;
+	}
+
+	void _tree_add(size_t p_idx, int32_t p_delta) {
+		for (size_t i = p_idx + 1; i < tree.size(); i += i & (~i + 1)) {
+			tree[i] += p_delta;
+		}
+	}
+
+	void _rebuild_tree() {
+		tree.assign(counts.size() + 1, 0);
+		for (size_t i = 1; i < tree.size(); i++) {
+			tree[i] += counts[i - 1];
+			size_t parent = i + (i & (~i + 1));
+			if (parent < tree.size()) {
+				tree[parent] += tree[i];
+			}
+		}
+	}
+
+	// Grows the range of buckets at least twice, so adding new keys is amortized O(1)
+	void _ensure_key(const int64_t &p_key) {
+		const int64_t key_high = key_low + (int64_t)counts.size();
+		if (counts.size() && p_key >= key_low && p_key < key_high)
+			return;
+
+		if (counts.empty()) {
+			key_low = p_key - 16;
+			counts.assign(32, 0);
+			_rebuild_tree();
+			return;
+		}
+
+		const int64_t needed = std::max(key_high, p_key + 1) - std::min(key_low, p_key);
+		const int64_t new_size = std::max(needed, (int64_t)counts.size() * 2);
+		const int64_t new_low = p_key < key_low ? key_high - new_size : key_low;
+
+		std::vector<uint32_t> new_counts(new_size, 0);
+		std::copy(counts.begin(), counts.end(), new_counts.begin() + (key_low - new_low));
+		counts = std::move(new_counts);
+		key_low = new_low;
+		_rebuild_tree();
+	}
+
+public:
+	QuantileSketch() {
+		gamma = (1 + RELATIVE_ACCURACY) / (1 - RELATIVE_ACCURACY);
+		log_gamma = std::log(gamma);
+		key_offset = 1 - _get_index(MIN_MAGNITUDE);
+	}
+
+	void clear() {
+		key_low = 0;
+		counts.clear();
+		tree.clear();
+		total = 0;
+	}
+
+	size_t size() const {
+		return total;
+	}
+
+	/// NaN is ignored.
+	void add(const double &p_value) {
+		if (std::isnan(p_value))
+			return;
+
+		const int64_t key = _get_key(p_value);
+		_ensure_key(key);
+
+		const size_t idx = (size_t)(key - key_low);
+		counts[idx]++;
+		_tree_add(idx, 1);
+		total++;
+	}
+
+	/// The value must be added before.
+	void remove(const double &p_value) {
+		if (std::isnan(p_value))
+			return;
+
+		const int64_t key = _get_key(p_value);
+		if (key < key_low || key >= key_low + (int64_t)counts.size())
+			return;
+
+		const size_t idx = (size_t)(key - key_low);
+		if (!counts[idx])
+			return;
+
+		counts[idx]--;
+		_tree_add(idx, -1);
+		total--;
+	}
+
+	/// Returns the approximate value at `p_quantile` in the range [0, 1].
+	double get_quantile(const double &p_quantile) const {
+		if (!total)
+			return 0;
+
+		size_t rank = (size_t)(std::clamp(p_quantile, 0.0, 1.0) * (double)(total - 1));
+
+		// Find the first bucket with the prefix sum greater than `rank`
+		size_t pos = 0;
+		size_t step = 1;
+		while (step * 2 < tree.size()) {
+			step *= 2;
+		}
+		for (; step; step /= 2) {
+			if (pos + step < tree.size() && tree[pos + step] <= rank) {
+				pos += step;
+				rank -= tree[pos];
+			}
+		}
+		return _get_value(key_low + (int64_t)pos);
+	}
+};
+
+/**
+ * Statistics of the last samples in a sliding window.
+ *
+ * The samples are kept in a CircularBuffer. Min and max are tracked by monotonic queues,
+ * the mean by a running sum and the percentiles by a QuantileSketch,
+ * so adding a sample is amortized O(1) for all but the percentiles, which are O(log n).
+ */
+template <typename TValue>
+class RollingStats {
+	CircularBuffer<TValue> samples;
+	// Pairs of the sample index and value, the oldest first
+	std::deque<std::pair<uint64_t, TValue> > min_queue;
+	std::deque<std::pair<uint64_t, TValue> > max_queue;
+	uint64_t next_index = 0;
+
+	double sum = 0;
+	size_t adds_since_sum_update = 0;
+
+	QuantileSketch sketch;
+
+	void _update_sum() {
+		sum = 0;
+		for (size_t i = 0; i < samples.size(); i++) {
+			sum += (double)samples.get(i);
+		}
+		adds_since_sum_update = 0;
+	}
+
+public:
+	RollingStats() {}
+
+	RollingStats(size_t p_window_size) :
+			samples(p_window_size) {
+	}
+
+	void reset() {
+		samples.reset();
+		min_queue.clear();
+		max_queue.clear();
+		next_index = 0;
+		sum = 0;
+		adds_since_sum_update = 0;
+		sketch.clear();
+	}
+
+	void resize(size_t p_window_size) {
+		reset();
+		samples.resize(p_window_size);
+	}
+
+	size_t size() const {
+		return samples.size();
+	}
+
+	size_t window_size() const {
+		return samples.buffer_size();
+	}
+
+	const CircularBuffer<TValue> &get_samples() const {
+		return samples;
+	}
+
+	/// Infinite and NaN samples are ignored.
+	void add(TValue p_v) {
+		if (!samples.buffer_size() || !std::isfinite((double)p_v))
+			return;
+
+		if (samples.is_filled()) {
+			TValue oldest = samples.get_oldest();
+			sum -= (double)oldest;
+			sketch.remove((double)oldest);
+		}
+		samples.add(p_v);
+
+		// Index of the oldest sample that is still in the window
+		const uint64_t first_index = next_index + 1 - samples.size();
+
+		while (min_queue.size() && !(min_queue.back().second < p_v)) {
+			min_queue.pop_back();
+		}
+		min_queue.emplace_back(next_index, p_v);
+		while (min_queue.front().first < first_index) {
+			min_queue.pop_front();
+		}
+
+		while (max_queue.size() && !(p_v < max_queue.back().second)) {
+			max_queue.pop_back();
+		}
+		max_queue.emplace_back(next_index, p_v);
+		while (max_queue.front().first < first_index) {
+			max_queue.pop_front();
+		}
+
+		sum += (double)p_v;
+		sketch.add((double)p_v);
+		next_index++;
+
+		// Recalculate the sum once per window so that rounding errors do not accumulate
+		if (++adds_since_sum_update >= samples.buffer_size()) {
+			_update_sum();
+		}
+	}
+
+	TValue get_min() const {
+		return min_queue.size() ? min_queue.front().second : TValue(0);
+	}
+
+	TValue get_max() const {
+		return max_queue.size() ? max_queue.front().second : TValue(0);
+	}
+
+	TValue get_avg() const {
+		return samples.size() ? (TValue)(sum / (double)samples.size()) : TValue(0);
+	}
+
+	/// Returns the approximate percentile in the range [0, 100]. The result is always between min and max.
+	TValue get_percentile(const double &p_percentile) const {
+		if (!samples.size())
+			return TValue(0);
+
+		double v = std::clamp(sketch.get_quantile(p_percentile / 100.0), (double)get_min(), (double)get_max());
+		if constexpr (std::is_integral_v<TValue>) {
+			return (TValue)std::llround(v);
+		} else {
+			return (TValue)v;
+		}
+	}
+
+	TValue get_p50() const {
+		return get_percentile(50);
+	}
+
+	TValue get_p95() const {
+		return get_percentile(95);
+	}
+
+	TValue get_p99() const {
+		return get_percentile(99);
+	}
+
+	/// Same as CircularBuffer::get_min_max_avg, but without scanning the samples.
+	void get_min_max_avg(TValue *p_min, TValue *p_max, TValue *p_avg) const {
+		*p_min = get_min();
+		*p_max = get_max();
+		*p_avg = get_avg();
+	}
+};
@@ -95,6 +95,7 @@ void GenerateCSharpBindingsPlugin::generate() {
 			"DebugDraw2D",
 			"DebugDraw2DStats",
 			"DebugDraw2DConfig",
+			"DebugDraw2DGraph",
 			"DebugDraw3D",
 			"DebugDraw3DStats",
 			"DebugDraw3DConfig",
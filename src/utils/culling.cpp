@@ -0,0 +1,429 @@
+#include "culling.h"
+
+#include "utils.h"
+
+#include <cstddef>
+#include <vector>
+
+#ifdef DEV_ENABLED
+GODOT_WARNING_DISABLE()
+#include <godot_cpp/classes/time.hpp>
+GODOT_WARNING_RESTORE()
+#endif
+
+#ifndef REAL_T_IS_DOUBLE
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CULLING_SSE2
+#include <emmintrin.h>
+#if !defined(__EMSCRIPTEN__) && (defined(__GNUC__) || defined(__clang__) || defined(_MSC_VER))
+#define CULLING_AVX2
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#define CULLING_NEON
+#include <arm_neon.h>
+#endif
+#endif
+
+#if defined(CULLING_AVX2) && !defined(_MSC_VER)
+#define CULLING_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define CULLING_TARGET_AVX2
+#endif
+
+#pragma region Scalar
+
+static _FORCE_INLINE_ bool _is_visible_scalar(const AABBMinMax &p_bounds, const AABBMinMax *p_boxes, size_t p_boxes_count, const std::array<Plane, 6> *p_frustums, size_t p_frustums_count) {
+	bool in_box = false;
+	for (size_t b = 0; b < p_boxes_count; b++) {
+		if (p_boxes[b].intersects(p_bounds)) {
+			in_box = true;
+			break;
+		}
+	}
+
+	if (!in_box) {
+		return false;
+	}
+
+	if (!p_frustums_count) {
+		return true;
+	}
+
+	for (size_t f = 0; f < p_frustums_count; f++) {
+		if (MathUtils::is_bounds_partially_inside_convex_shape(p_bounds, p_frustums[f])) {
+			return true;
+		}
+	}
+	return false;
+}
+
+void CullingKernel::cull_scalar(const AABBMinMax *p_bounds, size_t p_count, const AABBMinMax *p_boxes, size_t p_boxes_count, const std::array<Plane, 6> *p_frustums, size_t p_frustums_count, uint8_t *r_visible) {
+	for (size_t i = 0; i < p_count; i++) {
+		r_visible[i] = _is_visible_scalar(p_bounds[i], p_boxes, p_boxes_count, p_frustums, p_frustums_count);
+	}
+}
+
+#pragma endregion // Scalar
+
+#if defined(CULLING_SSE2) || defined(CULLING_NEON)
+// The vector paths read `AABBMinMax` as a flat array of floats:
+// [center.x, center.y, center.z, radius, min.x, min.y, min.z, max.x, max.y, max.z]
+static_assert(offsetof(AABBMinMax, center) == 0, "Unexpected AABBMinMax layout");
+static_assert(offsetof(AABBMinMax, radius) == 3 * sizeof(float), "Unexpected AABBMinMax layout");
+static_assert(offsetof(AABBMinMax, min) == 4 * sizeof(float), "Unexpected AABBMinMax layout");
+static_assert(offsetof(AABBMinMax, max) == 7 * sizeof(float), "Unexpected AABBMinMax layout");
+static_assert(sizeof(AABBMinMax) == 10 * sizeof(float), "Unexpected AABBMinMax layout");
+#endif
+
+#ifdef CULLING_SSE2
+#pragma region SSE2
+
+struct Bounds4 {
+	__m128 cx, cy, cz, r;
+	__m128 min_x, min_y, min_z;
+	__m128 max_x, max_y, max_z;
+};
+
+static _FORCE_INLINE_ void _load_bounds4(const AABBMinMax *p_bounds, Bounds4 &r_b) {
+	const float *b0 = reinterpret_cast<const float *>(p_bounds);
+	const float *b1 = b0 + 10;
+	const float *b2 = b0 + 20;
+	const float *b3 = b0 + 30;
+
+	// center.xyz, radius
+	r_b.cx = _mm_loadu_ps(b0);
+	r_b.cy = _mm_loadu_ps(b1);
+	r_b.cz = _mm_loadu_ps(b2);
+	r_b.r = _mm_loadu_ps(b3);
+	_MM_TRANSPOSE4_PS(r_b.cx, r_b.cy, r_b.cz, r_b.r);
+
+	// min.xyz, max.x
+	r_b.min_x = _mm_loadu_ps(b0 + 4);
+	r_b.min_y = _mm_loadu_ps(b1 + 4);
+	r_b.min_z = _mm_loadu_ps(b2 + 4);
+	r_b.max_x = _mm_loadu_ps(b3 + 4);
+	_MM_TRANSPOSE4_PS(r_b.min_x, r_b.min_y, r_b.min_z, r_b.max_x);
+
+	// min.z, max.xyz
+	__m128 t0 = _mm_loadu_ps(b0 + 6);
+	__m128 t1 = _mm_loadu_ps(b1 + 6);
+	r_b.max_y = _mm_loadu_ps(b2 + 6);
+	r_b.max_z = _mm_loadu_ps(b3 + 6);
+	_MM_TRANSPOSE4_PS(t0, t1, r_b.max_y, r_b.max_z);
+}
+
+static _FORCE_INLINE_ __m128 _cull4_sse2(const Bounds4 &b, const AABBMinMax *p_boxes, size_t p_boxes_count, const std::array<Plane, 6> *p_frustums, size_t p_frustums_count) {
+	__m128 in_box = _mm_setzero_ps();
+	for (size_t i = 0; i < p_boxes_count; i++) {
+		const AABBMinMax &box = p_boxes[i];
+		__m128 m = _mm_and_ps(_mm_cmplt_ps(_mm_set1_ps(box.min.x), b.max_x), _mm_cmpgt_ps(_mm_set1_ps(box.max.x), b.min_x));
+		m = _mm_and_ps(m, _mm_and_ps(_mm_cmplt_ps(_mm_set1_ps(box.min.y), b.max_y), _mm_cmpgt_ps(_mm_set1_ps(box.max.y), b.min_y)));
+		m = _mm_and_ps(m, _mm_and_ps(_mm_cmplt_ps(_mm_set1_ps(box.min.z), b.max_z), _mm_cmpgt_ps(_mm_set1_ps(box.max.z), b.min_z)));
+		in_box = _mm_or_ps(in_box, m);
+	}
+
+	if (!p_frustums_count || !_mm_movemask_ps(in_box)) {
+		return in_box;
+	}
+
+	__m128 in_frustum = _mm_setzero_ps();
+	for (size_t f = 0; f < p_frustums_count; f++) {
+		__m128 m = in_box;
+		for (const Plane &p : p_frustums[f]) {
+			__m128 dist = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(p.normal.x), b.cx), _mm_mul_ps(_mm_set1_ps(p.normal.y), b.cy)), _mm_mul_ps(_mm_set1_ps(p.normal.z), b.cz));
+			dist = _mm_sub_ps(dist, _mm_set1_ps(p.d));
+			// Same as `!(radius < distance)` in the scalar path
+			m = _mm_and_ps(m, _mm_cmpnlt_ps(b.r, dist));
+			if (!_mm_movemask_ps(m)) {
+				break;
+			}
+		}
+		in_frustum = _mm_or_ps(in_frustum, m);
+	}
+	return in_frustum;
+}
+
+static _FORCE_INLINE_ void _store_mask4(int p_mask, uint8_t *r_visible) {
+	r_visible[0] = (uint8_t)(p_mask & 1);
+	r_visible[1] = (uint8_t)((p_mask >> 1) & 1);
+	r_visible[2] = (uint8_t)((p_mask >> 2) & 1);
+	r_visible[3] = (uint8_t)((p_mask >> 3) & 1);
+}
+
+static void _cull_sse2(const AABBMinMax *p_bounds, size_t p_count, const AABBMinMax *p_boxes, size_t p_boxes_count, const std::array<Plane, 6> *p_frustums, size_t p_frustums_count, uint8_t *r_visible) {
+	size_t i = 0;
+	Bounds4 b;
+	for (; i + 4 <= p_count; i += 4) {
+		_load_bounds4(p_bounds + i, b);
+		_store_mask4(_mm_movemask_ps(_cull4_sse2(b, p_boxes, p_boxes_count, p_frustums, p_frustums_count)), r_visible + i);
+	}
+	CullingKernel::cull_scalar(p_bounds + i, p_count - i, p_boxes, p_boxes_count, p_frustums, p_frustums_count, r_visible + i);
+}
+
+#pragma endregion // SSE2
+#endif
+
+#ifdef CULLING_AVX2
+#pragma region AVX2
+
+static _FORCE_INLINE_ CULLING_TARGET_AVX2 __m256 _combine_m128(__m128 p_lo, __m128 p_hi) {
+	return _mm256_insertf128_ps(_mm256_castps128_ps256(p_lo), p_hi, 1);
+}
+
+static CULLING_TARGET_AVX2 void _cull_avx2(const AABBMinMax *p_bounds, size_t p_count, const AABBMinMax *p_boxes, size_t p_boxes_count, const std::array<Plane, 6> *p_frustums, size_t p_frustums_count, uint8_t *r_visible) {
+	size_t i = 0;
+	Bounds4 lo, hi;
+	for (; i + 8 <= p_count; i += 8) {
+		_load_bounds4(p_bounds + i, lo);
+		_load_bounds4(p_bounds + i + 4, hi);
+
+		const __m256 cx = _combine_m128(lo.cx, hi.cx);
+		const __m256 cy = _combine_m128(lo.cy, hi.cy);
+		const __m256 cz = _combine_m128(lo.cz, hi.cz);
+		const __m256 r = _combine_m128(lo.r, hi.r);
+		const __m256 min_x = _combine_m128(lo.min_x, hi.min_x);
+		const __m256 min_y = _combine_m128(lo.min_y, hi.min_y);
+		const __m256 min_z = _combine_m128(lo.min_z, hi.min_z);
+		const __m256 max_x = _combine_m128(lo.max_x, hi.max_x);
+		const __m256 max_y = _combine_m128(lo.max_y, hi.max_y);
+		const __m256 max_z = _combine_m128(lo.max_z, hi.max_z);
+
+		__m256 in_box = _mm256_setzero_ps();
+		for (size_t bi = 0; bi < p_boxes_count; bi++) {
+			const AABBMinMax &box = p_boxes[bi];
+			__m256 m = _mm256_and_ps(_mm256_cmp_ps(_mm256_set1_ps(box.min.x), max_x, _CMP_LT_OQ), _mm256_cmp_ps(_mm256_set1_ps(box.max.x), min_x, _CMP_GT_OQ));
+			m = _mm256_and_ps(m, _mm256_and_ps(_mm256_cmp_ps(_mm256_set1_ps(box.min.y), max_y, _CMP_LT_OQ), _mm256_cmp_ps(_mm256_set1_ps(box.max.y), min_y, _CMP_GT_OQ)));
+			m = _mm256_and_ps(m, _mm256_and_ps(_mm256_cmp_ps(_mm256_set1_ps(box.min.z), max_z, _CMP_LT_OQ), _mm256_cmp_ps(_mm256_set1_ps(box.max.z), min_z, _CMP_GT_OQ)));
+			in_box = _mm256_or_ps(in_box, m);
+		}
+
+		__m256 res = in_box;
+		if (p_frustums_count && _mm256_movemask_ps(in_box)) {
+			res = _mm256_setzero_ps();
+			for (size_t f = 0; f < p_frustums_count; f++) {
+				__m256 m = in_box;
+				for (const Plane &p : p_frustums[f]) {
+					__m256 dist = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(p.normal.x), cx), _mm256_mul_ps(_mm256_set1_ps(p.normal.y), cy)), _mm256_mul_ps(_mm256_set1_ps(p.normal.z), cz));
+					dist = _mm256_sub_ps(dist, _mm256_set1_ps(p.d));
+					m = _mm256_and_ps(m, _mm256_cmp_ps(r, dist, _CMP_NLT_UQ));
+					if (!_mm256_movemask_ps(m)) {
+						break;
+					}
+				}
+				res = _mm256_or_ps(res, m);
+			}
+		}
+
+		const int mask = _mm256_movemask_ps(res);
+		_store_mask4(mask, r_visible + i);
+		_store_mask4(mask >> 4, r_visible + i + 4);
+	}
+	_cull_sse2(p_bounds + i, p_count - i, p_boxes, p_boxes_count, p_frustums, p_frustums_count, r_visible + i);
+}
+
+static bool _is_avx2_supported() {
+#ifdef _MSC_VER
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7) {
+		return false;
+	}
+
+	__cpuid(info, 1);
+	const bool osxsave = (info[2] & (1 << 27)) != 0;
+	const bool avx = (info[2] & (1 << 28)) != 0;
+	if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6) {
+		return false;
+	}
+
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+#else
+	return __builtin_cpu_supports("avx2");
+#endif
+}
+
+#pragma endregion // AVX2
+#endif
+
+#ifdef CULLING_NEON
+#pragma region NEON
+
+// Transposes four rows of [x, y, z, w] into four columns.
+static _FORCE_INLINE_ void _transpose4_neon(float32x4_t p_a, float32x4_t p_b, float32x4_t p_c, float32x4_t p_d, float32x4_t &r_x, float32x4_t &r_y, float32x4_t &r_z, float32x4_t &r_w) {
+	float32x4x2_t t0 = vzipq_f32(p_a, p_c);
+	float32x4x2_t t1 = vzipq_f32(p_b, p_d);
+	float32x4x2_t u0 = vzipq_f32(t0.val[0], t1.val[0]);
+	float32x4x2_t u1 = vzipq_f32(t0.val[1], t1.val[1]);
+	r_x = u0.val[0];
+	r_y = u0.val[1];
+	r_z = u1.val[0];
+	r_w = u1.val[1];
+}
+
+static void _cull_neon(const AABBMinMax *p_bounds, size_t p_count, const AABBMinMax *p_boxes, size_t p_boxes_count, const std::array<Plane, 6> *p_frustums, size_t p_frustums_count, uint8_t *r_visible) {
+	size_t i = 0;
+	for (; i + 4 <= p_count; i += 4) {
+		const float *b0 = reinterpret_cast<const float *>(p_bounds + i);
+		const float *b1 = b0 + 10;
+		const float *b2 = b0 + 20;
+		const float *b3 = b0 + 30;
+
+		float32x4_t cx, cy, cz, r;
+		_transpose4_neon(vld1q_f32(b0), vld1q_f32(b1), vld1q_f32(b2), vld1q_f32(b3), cx, cy, cz, r);
+		float32x4_t min_x, min_y, min_z, max_x;
+		_transpose4_neon(vld1q_f32(b0 + 4), vld1q_f32(b1 + 4), vld1q_f32(b2 + 4), vld1q_f32(b3 + 4), min_x, min_y, min_z, max_x);
+		float32x4_t unused_0, unused_1, max_y, max_z;
+		_transpose4_neon(vld1q_f32(b0 + 6), vld1q_f32(b1 + 6), vld1q_f32(b2 + 6), vld1q_f32(b3 + 6), unused_0, unused_1, max_y, max_z);
+
+		uint32x4_t in_box = vdupq_n_u32(0);
+		for (size_t bi = 0; bi < p_boxes_count; bi++) {
+			const AABBMinMax &box = p_boxes[bi];
+			uint32x4_t m = vandq_u32(vcltq_f32(vdupq_n_f32(box.min.x), max_x), vcgtq_f32(vdupq_n_f32(box.max.x), min_x));
+			m = vandq_u32(m, vandq_u32(vcltq_f32(vdupq_n_f32(box.min.y), max_y), vcgtq_f32(vdupq_n_f32(box.max.y), min_y)));
+			m = vandq_u32(m, vandq_u32(vcltq_f32(vdupq_n_f32(box.min.z), max_z), vcgtq_f32(vdupq_n_f32(box.max.z), min_z)));
+			in_box = vorrq_u32(in_box, m);
+		}
+
+		uint32x4_t res = in_box;
+		if (p_frustums_count) {
+			res = vdupq_n_u32(0);
+			for (size_t f = 0; f < p_frustums_count; f++) {
+				uint32x4_t m = in_box;
+				for (const Plane &p : p_frustums[f]) {
+					float32x4_t dist = vaddq_f32(vaddq_f32(vmulq_f32(vdupq_n_f32(p.normal.x), cx), vmulq_f32(vdupq_n_f32(p.normal.y), cy)), vmulq_f32(vdupq_n_f32(p.normal.z), cz));
+					dist = vsubq_f32(dist, vdupq_n_f32(p.d));
+					m = vandq_u32(m, vmvnq_u32(vcltq_f32(r, dist)));
+				}
+				res = vorrq_u32(res, m);
+			}
+		}
+
+		r_visible[i + 0] = (uint8_t)(vgetq_lane_u32(res, 0) & 1);
+		r_visible[i + 1] = (uint8_t)(vgetq_lane_u32(res, 1) & 1);
+		r_visible[i + 2] = (uint8_t)(vgetq_lane_u32(res, 2) & 1);
+		r_visible[i + 3] = (uint8_t)(vgetq_lane_u32(res, 3) & 1);
+	}
+	CullingKernel::cull_scalar(p_bounds + i, p_count - i, p_boxes, p_boxes_count, p_frustums, p_frustums_count, r_visible + i);
+}
+
+#pragma endregion // NEON
+#endif
+
+const CullingKernel::Selected &CullingKernel::_get_selected() {
+	static const Selected selected = []() -> Selected {
+#if defined(CULLING_AVX2)
+		if (_is_avx2_supported()) {
+			return { Backend::AVX2, &_cull_avx2 };
+		}
+#endif
+#if defined(CULLING_SSE2)
+		return { Backend::SSE2, &_cull_sse2 };
+#elif defined(CULLING_NEON)
+		return { Backend::NEON, &_cull_neon };
+#else
+		return { Backend::SCALAR, &CullingKernel::cull_scalar };
+#endif
+	}();
+	return selected;
+}
+
+void CullingKernel::cull(const AABBMinMax *p_bounds, size_t p_count, const AABBMinMax *p_boxes, size_t p_boxes_count, const std::array<Plane, 6> *p_frustums, size_t p_frustums_count, uint8_t *r_visible) {
+	if (!p_count) {
+		return;
+	}
+	_get_selected().func(p_bounds, p_count, p_boxes, p_boxes_count, p_frustums, p_frustums_count, r_visible);
+}
+
+CullingKernel::Backend CullingKernel::get_backend() {
+	return _get_selected().backend;
+}
+
+const char *CullingKernel::get_backend_name() {
+	switch (get_backend()) {
+		case Backend::SSE2:
+			return "SSE2";
+		case Backend::AVX2:
+			return "AVX2";
+		case Backend::NEON:
+			return "NEON";
+		case Backend::SCALAR:
+		default:
+			return "Scalar";
+	}
+}
+
+#ifdef DEV_ENABLED
+static bool _dev_compare_with_scalar(size_t p_count, int p_iterations, bool p_print_timings) {
+	ZoneScoped;
+
+	uint32_t seed = 12345;
+	auto rand_f = [&seed](real_t p_min, real_t p_max) {
+		seed = seed * 1664525u + 1013904223u;
+		return p_min + (p_max - p_min) * (real_t)((seed >> 8) & 0xFFFFFF) / (real_t)0xFFFFFF;
+	};
+
+	std::vector<AABBMinMax> bounds;
+	bounds.reserve(p_count);
+	for (size_t i = 0; i < p_count; i++) {
+		bounds.push_back(AABBMinMax(SphereBounds(Vector3(rand_f(-200, 200), rand_f(-200, 200), rand_f(-200, 200)), rand_f(0, 5))));
+	}
+
+	// A camera at the origin looking along -Z
+	std::array<Plane, 6> frustum = {
+		Plane(Vector3(0, 0, 1), -0.05f),
+		Plane(Vector3(0, 0, -1), 150),
+		Plane(Vector3(-1, 0, 1).normalized(), 0),
+		Plane(Vector3(0, 1, 1).normalized(), 0),
+		Plane(Vector3(1, 0, 1).normalized(), 0),
+		Plane(Vector3(0, -1, 1).normalized(), 0),
+	};
+	AABBMinMax box(AABB(Vector3(-150, -150, -150), Vector3(300, 300, 150)));
+
+	std::vector<uint8_t> expected(p_count);
+	std::vector<uint8_t> result(p_count);
+
+	auto time = Time::get_singleton();
+	uint64_t start = time->get_ticks_usec();
+	for (int i = 0; i < p_iterations; i++) {
+		CullingKernel::cull_scalar(bounds.data(), p_count, &box, 1, &frustum, 1, expected.data());
+	}
+	uint64_t scalar_time = time->get_ticks_usec() - start;
+
+	start = time->get_ticks_usec();
+	for (int i = 0; i < p_iterations; i++) {
+		CullingKernel::cull(bounds.data(), p_count, &box, 1, &frustum, 1, result.data());
+	}
+	uint64_t kernel_time = time->get_ticks_usec() - start;
+
+	size_t mismatches = 0;
+	size_t visible = 0;
+	for (size_t i = 0; i < p_count; i++) {
+		mismatches += expected[i] != result[i];
+		visible += expected[i];
+	}
+
+	if (p_print_timings) {
+		DEV_PRINT_STD("%s: %s backend, %" PRIu64 " objects (%" PRIu64 " visible). Scalar: %" PRIu64 " usec, vectorized: %" PRIu64 " usec, mismatches: %" PRIu64 "\n",
+				NAMEOF(CullingKernel), CullingKernel::get_backend_name(), (uint64_t)p_count, (uint64_t)visible, scalar_time / p_iterations, kernel_time / p_iterations, (uint64_t)mismatches);
+	}
+
+	if (mismatches) {
+		PRINT_ERROR("{0} produced {1} results that differ from the scalar path.", CullingKernel::get_backend_name(), (int64_t)mismatches);
+	}
+	return mismatches == 0;
+}
+
+bool CullingKernel::dev_self_check() {
+	// Not a multiple of the batch size to cover the tail
+	return _dev_compare_with_scalar(1027, 1, false);
+}
+
+bool CullingKernel::dev_benchmark(size_t p_count, int p_iterations) {
+	return _dev_compare_with_scalar(p_count, p_iterations, true);
+}
+#endif
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "math_utils.h"
+
+#include <array>
+#include <cstdint>
+
+/**
+ * Batched visibility tests for contiguous arrays of `AABBMinMax`.
+ *
+ * The vectorized path is selected once at runtime: AVX2 or SSE2 on x86, NEON on ARM.
+ * Builds with `precision=double` always use the scalar path.
+ */
+class CullingKernel {
+public:
+	enum class Backend : char {
+		SCALAR,
+		SSE2,
+		AVX2,
+		NEON,
+	};
+
+	typedef void (*CullFunc)(const AABBMinMax *p_bounds, size_t p_count, const AABBMinMax *p_boxes, size_t p_boxes_count, const std::array<Plane, 6> *p_frustums, size_t p_frustums_count, uint8_t *r_visible);
+
+private:
+	struct Selected {
+		Backend backend;
+		CullFunc func;
+	};
+
+	static const Selected &_get_selected();
+
+public:
+	/// Writes 1 to `r_visible[i]` if `p_bounds[i]` intersects any of `p_boxes` and is partially inside any of `p_frustums`, otherwise 0.
+	/// If there are no frustums, only the boxes are checked.
+	static void cull(const AABBMinMax *p_bounds, size_t p_count, const AABBMinMax *p_boxes, size_t p_boxes_count, const std::array<Plane, 6> *p_frustums, size_t p_frustums_count, uint8_t *r_visible);
+	/// Reference implementation. Produces the same results as `cull`.
+	static void cull_scalar(const AABBMinMax *p_bounds, size_t p_count, const AABBMinMax *p_boxes, size_t p_boxes_count, const std::array<Plane, 6> *p_frustums, size_t p_frustums_count, uint8_t *r_visible);
+
+	static Backend get_backend();
+	static const char *get_backend_name();
+
+#ifdef DEV_ENABLED
+	/// Compares the selected backend with the scalar path on a small set of random bounds. Returns false on mismatches.
+	static bool dev_self_check();
+	/// Same as `dev_self_check`, but runs `p_iterations` times on `p_count` bounds and prints the timings of both paths.
+	static bool dev_benchmark(size_t p_count = 100003, int p_iterations = 20);
+#endif
+};
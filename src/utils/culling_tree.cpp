@@ -0,0 +1,489 @@
+#include "culling_tree.h"
+
+#include "culling.h"
+#include "utils.h"
+
+#include <algorithm>
+
+enum class Overlap : char {
+	OUTSIDE,
+	PARTIAL,
+	INSIDE,
+};
+
+enum TestFlags : uint8_t {
+	TEST_BOXES = 1 << 0,
+	TEST_FRUSTUMS = 1 << 1,
+};
+
+// Uses the same strict comparisons as `AABBMinMax::intersects`,
+// so an `OUTSIDE` node cannot contain an item that intersects any of the boxes.
+static _FORCE_INLINE_ Overlap _test_boxes(const Vector3 &p_min, const Vector3 &p_max, const AABBMinMax *p_boxes, size_t p_boxes_count) {
+	Overlap res = Overlap::OUTSIDE;
+	for (size_t b = 0; b < p_boxes_count; b++) {
+		const AABBMinMax &box = p_boxes[b];
+		if (p_min.x < box.max.x && p_max.x > box.min.x &&
+				p_min.y < box.max.y && p_max.y > box.min.y &&
+				p_min.z < box.max.z && p_max.z > box.min.z) {
+			if (box.min.x < p_min.x && p_max.x < box.max.x &&
+					box.min.y < p_min.y && p_max.y < box.max.y &&
+					box.min.z < p_min.z && p_max.z < box.max.z) {
+				return Overlap::INSIDE;
+			}
+			res = Overlap::PARTIAL;
+		}
+	}
+	return res;
+}
+
+// Nodes contain the boxes around the bounding spheres of the items.
+// If such a box is behind a plane, so are all the spheres in it.
+// If it is in front of all the planes, so are the centers of all the spheres.
+static _FORCE_INLINE_ Overlap _test_frustums(const Vector3 &p_min, const Vector3 &p_max, const std::array<Plane, 6> *p_frustums, const std::array<Vector3, 6> *p_abs_normals, size_t p_frustums_count) {
+	const Vector3 center = (p_min + p_max) * 0.5f;
+	const Vector3 extents = (p_max - p_min) * 0.5f;
+
+	Overlap res = Overlap::OUTSIDE;
+	for (size_t f = 0; f < p_frustums_count; f++) {
+		bool is_inside = true;
+		bool is_outside = false;
+
+		for (int i = 0; i < 6; i++) {
+			const Plane &p = p_frustums[f][i];
+			real_t dist = p.distance_to(center);
+			real_t r = p_abs_normals[f][i].dot(extents);
+			if (dist - r > 0) {
+				is_outside = true;
+				break;
+			}
+			if (dist + r > 0) {
+				is_inside = false;
+			}
+		}
+
+		if (is_outside) {
+			continue;
+		}
+		if (is_inside) {
+			return Overlap::INSIDE;
+		}
+		res = Overlap::PARTIAL;
+	}
+	return res;
+}
+
+int32_t CullingTree::_alloc_node() {
+	int32_t idx;
+	if (free_list != -1) {
+		idx = free_list;
+		free_list = nodes[idx].parent;
+	} else {
+		idx = (int32_t)nodes.size();
+		nodes.push_back({});
+	}
+
+	Node &n = nodes[idx];
+	n.parent = -1;
+	n.child1 = -1;
+	n.child2 = -1;
+	n.height = 0;
+	n.item = 0;
+	return idx;
+}
+
+void CullingTree::_free_node(int32_t p_node) {
+	nodes[p_node].parent = free_list;
+	nodes[p_node].height = -1;
+	free_list = p_node;
+}
+
+void CullingTree::_refit(int32_t p_node) {
+	Node &n = nodes[p_node];
+	const Node &c1 = nodes[n.child1];
+	const Node &c2 = nodes[n.child2];
+	n.height = 1 + Math::max(c1.height, c2.height);
+	n.min = c1.min.min(c2.min);
+	n.max = c1.max.max(c2.max);
+}
+
+void CullingTree::_fix_upwards(int32_t p_node) {
+	while (p_node != -1) {
+		p_node = _balance(p_node);
+		_refit(p_node);
+		p_node = nodes[p_node].parent;
+	}
+}
+
+int32_t CullingTree::_build_recursive(BuildItem *p_items, size_t p_count, int32_t p_parent, const AABBMinMax *p_bounds) {
+	const int32_t idx = _alloc_node();
+	nodes[idx].parent = p_parent;
+
+	if (p_count == 1) {
+		Node &n = nodes[idx];
+		const AABBMinMax &b = p_bounds[p_items[0].item];
+		const Vector3 r = Vector3(b.radius, b.radius, b.radius);
+		n.min = b.center - r;
+		n.max = b.center + r;
+		n.item = p_items[0].item;
+		item_leaves[n.item] = idx;
+		return idx;
+	}
+
+	// Split in the middle of the longest axis of the centers
+	Vector3 c_min = p_items[0].center;
+	Vector3 c_max = p_items[0].center;
+	for (size_t i = 1; i < p_count; i++) {
+		c_min = c_min.min(p_items[i].center);
+		c_max = c_max.max(p_items[i].center);
+	}
+	const Vector3 size = c_max - c_min;
+	const int axis = size.x > size.y ? (size.x > size.z ? 0 : 2) : (size.y > size.z ? 1 : 2);
+	const real_t split = (c_min[axis] + c_max[axis]) * 0.5f;
+
+	size_t mid = std::partition(p_items, p_items + p_count, [axis, split](const BuildItem &p_item) {
+		return p_item.center[axis] < split;
+	}) - p_items;
+
+	// All the centers are in the same place
+	if (mid == 0 || mid == p_count) {
+		mid = p_count / 2;
+	}
+
+	const int32_t child1 = _build_recursive(p_items, mid, idx, p_bounds);
+	const int32_t child2 = _build_recursive(p_items + mid, p_count - mid, idx, p_bounds);
+
+	Node &n = nodes[idx];
+	n.child1 = child1;
+	n.child2 = child2;
+	_refit(idx);
+	return idx;
+}
+
+void CullingTree::_remove_leaf(int32_t p_leaf) {
+	if (p_leaf == root) {
+		root = -1;
+		return;
+	}
+
+	const int32_t parent = nodes[p_leaf].parent;
+	const int32_t grand_parent = nodes[parent].parent;
+	const int32_t sibling = nodes[parent].child1 == p_leaf ? nodes[parent].child2 : nodes[parent].child1;
+
+	_free_node(parent);
+	nodes[sibling].parent = grand_parent;
+
+	if (grand_parent != -1) {
+		Node &gp = nodes[grand_parent];
+		if (gp.child1 == parent) {
+			gp.child1 = sibling;
+		} else {
+			gp.child2 = sibling;
+		}
+		_fix_upwards(grand_parent);
+	} else {
+		root = sibling;
+	}
+}
+
+// Rotates the higher child up if the subtree is unbalanced. Returns the new root of the subtree.
+int32_t CullingTree::_balance(int32_t p_node) {
+	const int32_t ia = p_node;
+	if (nodes[ia].is_leaf() || nodes[ia].height < 2) {
+		return ia;
+	}
+
+	const int32_t ib = nodes[ia].child1;
+	const int32_t ic = nodes[ia].child2;
+	const int32_t balance = nodes[ic].height - nodes[ib].height;
+
+	if (balance > -2 && balance < 2) {
+		return ia;
+	}
+
+	// `up` replaces `ia`, `ia` takes the lower child of `up`
+	const int32_t up = balance > 0 ? ic : ib;
+	const int32_t stay = balance > 0 ? ib : ic;
+	const int32_t f = nodes[up].child1;
+	const int32_t g = nodes[up].child2;
+
+	Node &a = nodes[ia];
+	Node &u = nodes[up];
+
+	u.child1 = ia;
+	u.parent = a.parent;
+	a.parent = up;
+
+	if (u.parent != -1) {
+		Node &p = nodes[u.parent];
+		if (p.child1 == ia) {
+			p.child1 = up;
+		} else {
+			p.child2 = up;
+		}
+	} else {
+		root = up;
+	}
+
+	const bool keep_f = nodes[f].height > nodes[g].height;
+	const int32_t kept = keep_f ? f : g;
+	const int32_t moved = keep_f ? g : f;
+
+	u.child2 = kept;
+	if (balance > 0) {
+		a.child2 = moved;
+	} else {
+		a.child1 = moved;
+	}
+	nodes[moved].parent = ia;
+
+	a.min = nodes[stay].min.min(nodes[moved].min);
+	a.max = nodes[stay].max.max(nodes[moved].max);
+	a.height = 1 + Math::max(nodes[stay].height, nodes[moved].height);
+
+	u.min = a.min.min(nodes[kept].min);
+	u.max = a.max.max(nodes[kept].max);
+	u.height = 1 + Math::max(a.height, nodes[kept].height);
+
+	return up;
+}
+
+void CullingTree::build(const std::vector<size_t> &p_items, const AABBMinMax *p_bounds) {
+	ZoneScoped;
+	clear();
+	if (p_items.empty()) {
+		return;
+	}
+
+	thread_local std::vector<BuildItem> build_items;
+	build_items.resize(p_items.size());
+
+	size_t max_item = 0;
+	for (size_t i = 0; i < p_items.size(); i++) {
+		build_items[i] = { p_bounds[p_items[i]].center, p_items[i] };
+		max_item = Math::max(max_item, p_items[i]);
+	}
+
+	item_leaves.assign(max_item + 1, -1);
+	nodes.reserve(p_items.size() * 2);
+	leaves_count = p_items.size();
+	root = _build_recursive(build_items.data(), build_items.size(), -1, p_bounds);
+}
+
+void CullingTree::remove(size_t p_item) {
+	if (p_item >= item_leaves.size() || item_leaves[p_item] == -1) {
+		return;
+	}
+
+	const int32_t leaf = item_leaves[p_item];
+	_remove_leaf(leaf);
+	_free_node(leaf);
+	item_leaves[p_item] = -1;
+	leaves_count--;
+}
+
+void CullingTree::clear() {
+	nodes.clear();
+	item_leaves.clear();
+	root = -1;
+	free_list = -1;
+	leaves_count = 0;
+}
+
+void CullingTree::cull(const AABBMinMax *p_bounds, const AABBMinMax *p_boxes, size_t p_boxes_count, const std::array<Plane, 6> *p_frustums, size_t p_frustums_count, std::vector<size_t> &r_visible) const {
+	ZoneScoped;
+	if (root == -1 || !p_boxes_count) {
+		return;
+	}
+
+	struct StackItem {
+		int32_t node;
+		uint8_t tests;
+	};
+
+	thread_local std::vector<StackItem> stack;
+	// Items of the partially visible leaves are tested by the kernel in one batch
+	thread_local std::vector<size_t> candidates;
+	thread_local std::vector<AABBMinMax> candidate_bounds;
+	thread_local std::vector<uint8_t> candidate_mask;
+
+	thread_local std::vector<std::array<Vector3, 6> > abs_normals;
+	abs_normals.resize(p_frustums_count);
+	for (size_t f = 0; f < p_frustums_count; f++) {
+		for (int i = 0; i < 6; i++) {
+			const Vector3 &n = p_frustums[f][i].normal;
+			abs_normals[f][i] = Vector3(Math::abs(n.x), Math::abs(n.y), Math::abs(n.z));
+		}
+	}
+
+	stack.clear();
+	candidates.clear();
+	stack.push_back({ root, (uint8_t)(TEST_BOXES | (p_frustums_count ? TEST_FRUSTUMS : 0)) });
+
+	while (!stack.empty()) {
+		const StackItem si = stack.back();
+		stack.pop_back();
+
+		const Node &n = nodes[si.node];
+		uint8_t tests = si.tests;
+
+		if (tests & TEST_BOXES) {
+			Overlap o = _test_boxes(n.min, n.max, p_boxes, p_boxes_count);
+			if (o == Overlap::OUTSIDE) {
+				continue;
+			} else if (o == Overlap::INSIDE) {
+				tests &= ~TEST_BOXES;
+			}
+		}
+
+		if (tests & TEST_FRUSTUMS) {
+			Overlap o = _test_frustums(n.min, n.max, p_frustums, abs_normals.data(), p_frustums_count);
+			if (o == Overlap::OUTSIDE) {
+				continue;
+			} else if (o == Overlap::INSIDE) {
+				tests &= ~TEST_FRUSTUMS;
+			}
+		}
+
+		if (n.is_leaf()) {
+			if (tests) {
+				candidates.push_back(n.item);
+			} else {
+				r_visible.push_back(n.item);
+			}
+			continue;
+		}
+
+		stack.push_back({ n.child2, tests });
+		stack.push_back({ n.child1, tests });
+	}
+
+	if (candidates.size()) {
+		candidate_bounds.resize(candidates.size());
+		candidate_mask.resize(candidates.size());
+		for (size_t i = 0; i < candidates.size(); i++) {
+			candidate_bounds[i] = p_bounds[candidates[i]];
+		}
+
+		CullingKernel::cull(candidate_bounds.data(), candidate_bounds.size(), p_boxes, p_boxes_count, p_frustums, p_frustums_count, candidate_mask.data());
+
+		for (size_t i = 0; i < candidates.size(); i++) {
+			if (candidate_mask[i]) {
+				r_visible.push_back(candidates[i]);
+			}
+		}
+	}
+}
+
+void CullingIndex::_rebuild_tree(const AABBMinMax *p_bounds) {
+	ZoneScoped;
+	temp_items.clear();
+	temp_items.reserve(items_count);
+	for (size_t i = 0; i < slots.size(); i++) {
+		if (slots[i] != NOT_TRACKED) {
+			temp_items.push_back(i);
+			slots[i] = IN_TREE;
+		}
+	}
+
+	recent.clear();
+	tree.build(temp_items, p_bounds);
+	is_tree_used = true;
+}
+
+void CullingIndex::_drop_tree() {
+	ZoneScoped;
+	tree.clear();
+	for (size_t i = 0; i < slots.size(); i++) {
+		if (slots[i] == IN_TREE) {
+			slots[i] = (int64_t)recent.size();
+			recent.push_back(i);
+		}
+	}
+	is_tree_used = false;
+}
+
+void CullingIndex::add(size_t p_item) {
+	if (p_item >= slots.size()) {
+		slots.resize(p_item + 1, NOT_TRACKED);
+	} else if (slots[p_item] != NOT_TRACKED) {
+		remove(p_item);
+	}
+
+	slots[p_item] = (int64_t)recent.size();
+	recent.push_back(p_item);
+	items_count++;
+}
+
+void CullingIndex::remove(size_t p_item) {
+	if (p_item >= slots.size() || slots[p_item] == NOT_TRACKED) {
+		return;
+	}
+
+	const int64_t slot = slots[p_item];
+	if (slot == IN_TREE) {
+		tree.remove(p_item);
+	} else {
+		size_t last = recent.back();
+		recent[slot] = last;
+		slots[last] = slot;
+		recent.pop_back();
+	}
+
+	slots[p_item] = NOT_TRACKED;
+	items_count--;
+}
+
+void CullingIndex::clear() {
+	tree.clear();
+	is_tree_used = false;
+	slots.clear();
+	recent.clear();
+	items_count = 0;
+	prev_visible_count = 0;
+}
+
+void CullingIndex::cull(const AABBMinMax *p_bounds, size_t p_bounds_count, const AABBMinMax *p_boxes, size_t p_boxes_count, const std::array<Plane, 6> *p_frustums, size_t p_frustums_count, std::vector<size_t> &r_visible) {
+	ZoneScoped;
+	const size_t visible_before = r_visible.size();
+
+	// The tree pays off only when most of the items can be skipped
+	if (is_tree_used) {
+		if (items_count < MIN_ITEMS_FOR_TREE / 2 || prev_visible_count * 16 > items_count) {
+			_drop_tree();
+		} else if (recent.size() * 4 > tree.size()) {
+			_rebuild_tree(p_bounds);
+		}
+	} else if (items_count >= MIN_ITEMS_FOR_TREE && prev_visible_count * 32 < items_count) {
+		_rebuild_tree(p_bounds);
+	}
+
+	if (is_tree_used) {
+		tree.cull(p_bounds, p_boxes, p_boxes_count, p_frustums, p_frustums_count, r_visible);
+
+		if (recent.size()) {
+			temp_bounds.resize(recent.size());
+			temp_mask.resize(recent.size());
+			for (size_t i = 0; i < recent.size(); i++) {
+				temp_bounds[i] = p_bounds[recent[i]];
+			}
+
+			CullingKernel::cull(temp_bounds.data(), temp_bounds.size(), p_boxes, p_boxes_count, p_frustums, p_frustums_count, temp_mask.data());
+			for (size_t i = 0; i < recent.size(); i++) {
+				if (temp_mask[i]) {
+					r_visible.push_back(recent[i]);
+				}
+			}
+		}
+	} else if (items_count) {
+		const size_t count = Math::min(p_bounds_count, slots.size());
+		temp_mask.resize(count);
+		CullingKernel::cull(p_bounds, count, p_boxes, p_boxes_count, p_frustums, p_frustums_count, temp_mask.data());
+		for (size_t i = 0; i < count; i++) {
+			if (temp_mask[i] && slots[i] != NOT_TRACKED) {
+				r_visible.push_back(i);
+			}
+		}
+	}
+
+	prev_visible_count = r_visible.size() - visible_before;
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include "math_utils.h"
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Bounding volume hierarchy for frustum culling of long-lived objects.
+ *
+ * Each leaf is one item. Nodes store the box around the bounding spheres of their items,
+ * so whole subtrees can be rejected or accepted without testing the items.
+ * The tree is built at once and then only shrinks: removed leaves are unlinked and the tree is rebalanced with rotations.
+ */
+class CullingTree {
+	struct Node {
+		Vector3 min;
+		Vector3 max;
+		int32_t parent;
+		int32_t child1;
+		int32_t child2;
+		// 0 for leaves, -1 for free nodes
+		int32_t height;
+		size_t item;
+
+		_FORCE_INLINE_ bool is_leaf() const {
+			return child1 == -1;
+		}
+	};
+
+	struct BuildItem {
+		Vector3 center;
+		size_t item;
+	};
+
+	std::vector<Node> nodes;
+	int32_t root = -1;
+	// Free nodes are linked through `parent`
+	int32_t free_list = -1;
+	size_t leaves_count = 0;
+	// Leaf of each item or -1
+	std::vector<int32_t> item_leaves;
+
+	int32_t _alloc_node();
+	void _free_node(int32_t p_node);
+	int32_t _build_recursive(BuildItem *p_items, size_t p_count, int32_t p_parent, const AABBMinMax *p_bounds);
+	void _remove_leaf(int32_t p_leaf);
+	int32_t _balance(int32_t p_node);
+	void _refit(int32_t p_node);
+	void _fix_upwards(int32_t p_node);
+
+public:
+	/// Replaces the tree with the `p_items`. Their bounds are taken from `p_bounds[item]`.
+	void build(const std::vector<size_t> &p_items, const AABBMinMax *p_bounds);
+	void remove(size_t p_item);
+	void clear();
+
+	_FORCE_INLINE_ size_t size() const {
+		return leaves_count;
+	}
+
+	/// Appends to `r_visible` the items whose `p_bounds[item]` pass the same test as `CullingKernel::cull`.
+	void cull(const AABBMinMax *p_bounds, const AABBMinMax *p_boxes, size_t p_boxes_count, const std::array<Plane, 6> *p_frustums, size_t p_frustums_count, std::vector<size_t> &r_visible) const;
+};
+
+/**
+ * Set of items that chooses how to cull them.
+ *
+ * Small sets and sets with a large visible part are culled in one flat pass over all the bounds.
+ * Large sets with a small visible part use a `CullingTree`. Items added after the tree was built
+ * are culled separately until there are enough of them to rebuild the tree.
+ */
+class CullingIndex {
+	enum : int64_t {
+		NOT_TRACKED = -1,
+		IN_TREE = -2,
+	};
+
+	CullingTree tree;
+	bool is_tree_used = false;
+	// Position in `recent`, `IN_TREE` or `NOT_TRACKED` for each item
+	std::vector<int64_t> slots;
+	// Items that are not in the tree
+	std::vector<size_t> recent;
+	size_t items_count = 0;
+	size_t prev_visible_count = 0;
+
+	std::vector<uint8_t> temp_mask;
+	std::vector<AABBMinMax> temp_bounds;
+	std::vector<size_t> temp_items;
+
+	void _rebuild_tree(const AABBMinMax *p_bounds);
+	void _drop_tree();
+
+public:
+	static constexpr size_t MIN_ITEMS_FOR_TREE = 4096;
+
+	void add(size_t p_item);
+	void remove(size_t p_item);
+	void clear();
+
+	_FORCE_INLINE_ size_t size() const {
+		return items_count;
+	}
+
+	_FORCE_INLINE_ bool is_using_tree() const {
+		return is_tree_used;
+	}
+
+	/// Appends to `r_visible` the visible items. `p_bounds` must contain the bounds of all items.
+	void cull(const AABBMinMax *p_bounds, size_t p_bounds_count, const AABBMinMax *p_boxes, size_t p_boxes_count, const std::array<Plane, 6> *p_frustums, size_t p_frustums_count, std::vector<size_t> &r_visible);
+};
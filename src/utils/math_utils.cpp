@@ -6,6 +6,32 @@ const float MathUtils::CylinderRadiusForSphere = 0.7071067691f; // "%.10f" % (Ve
 const float MathUtils::AxisRadiusForSphere = 0.5000000000f; // "%.10f" % (Vector3(1,0,0) * 0.5).length()
 const float MathUtils::ArrowRadiusForSphere = 0.5153881907f; // "%.10f" % (Vector3(1,0.25,0) * 0.5).length()
 
+std::array<Plane, 6> MathUtils::get_projection_planes(const Projection &p_projection, const Transform3D &p_transform) {
+	const Vector4 *c = p_projection.columns;
+
+	// `p_row` is added or subtracted from the last row of the matrix
+	auto get_plane = [&](int p_row, real_t p_sign) {
+		Plane plane(
+				c[0][3] + c[0][p_row] * p_sign,
+				c[1][3] + c[1][p_row] * p_sign,
+				c[2][3] + c[2][p_row] * p_sign,
+				c[3][3] + c[3][p_row] * p_sign);
+		plane.normal = -plane.normal;
+		plane.normalize();
+		return p_transform.xform(plane);
+	};
+
+	//  near, far, left, top, right, bottom
+	return std::array<Plane, 6>{
+		get_plane(2, 1),
+		get_plane(2, -1),
+		get_plane(0, 1),
+		get_plane(1, -1),
+		get_plane(0, -1),
+		get_plane(1, 1),
+	};
+}
+
 SphereBounds::SphereBounds() :
 		position(),
 		radius() {}
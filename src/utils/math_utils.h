@@ -30,6 +30,8 @@ public:
 
 	_FORCE_INLINE_ static std::array<Vector3, 8> get_frustum_cube(const std::array<Plane, 6> p_frustum);
 	_FORCE_INLINE_ static void scale_frustum_far_plane_distance(std::array<Plane, 6> &p_frustum, const Transform3D &p_camera_xf, const real_t &p_scale);
+	/// Same as `Projection.get_projection_planes`, but without an Array of Variants.
+	static std::array<Plane, 6> get_projection_planes(const Projection &p_projection, const Transform3D &p_transform);
 };
 
 struct SphereBounds {
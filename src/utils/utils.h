@@ -94,10 +94,20 @@ static String get_file_name_in_repository(const String &name) {
 
 #ifndef TRACY_ENABLE
 #define LOCK_GUARD(_mutex) std::lock_guard<std::recursive_mutex> __guard(_mutex)
+#define _UNIQUE_LOCK_TYPE std::unique_lock<std::recursive_mutex>
 #else
 #define LOCK_GUARD(_mutex) std::lock_guard<LockableBase(std::recursive_mutex)> __guard(_mutex)
+#define _UNIQUE_LOCK_TYPE std::unique_lock<LockableBase(std::recursive_mutex)>
 #endif
 
+// Same as LOCK_GUARD, but increments `_counter` if the mutex was already locked by another thread
+#define LOCK_GUARD_COUNTED(_mutex, _counter)             \
+	_UNIQUE_LOCK_TYPE __guard(_mutex, std::try_to_lock); \
+	if (!__guard.owns_lock()) {                          \
+		_counter++;                                      \
+		__guard.lock();                                  \
+	}
+
 #define PS() ProjectSettings::get_singleton()
 #define DEFINE_SETTING(path, def, type)     \
 	{                                       \